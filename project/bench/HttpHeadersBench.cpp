@@ -0,0 +1,176 @@
+// Mikrobenchmark sestaveni hlavicky odpovedi (GET resource a status page 404)
+// Porovnava se puvodni sestaveni po jednotlivych fieldech (gmtime + strftime pro Date, Last-Modified a Expires),
+// soucasne sestaveni bez predpripravenych fieldu a doplneni Date/Expires do predpripravenych fieldu
+// Spusteni: make bench && build/bench/HttpHeadersBench [pocet hlavicek]
+#include "HttpPacketBuilder.hpp"
+#include "HttpClock.hpp"
+#include "Configuration.hpp"
+#include <time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <chrono>
+#include <memory>
+#include <string>
+
+
+static volatile size_t sink;
+
+bool getFileSuffix(const std::string& uri, std::string& suffix);  // HttpPacketBuilder.cpp
+
+// Puvodni HttpPacketBuilder::createCommonHeaders (pred predpripravenymi fieldy a HttpClock)
+static void legacyCommonHeaders(HttpPacket& packet, const Config::RParams* rparam, const HttpStatusCode status_code,
+	const bool status_code_page)
+{
+	HttpPacket::Header& pheader = packet.header();
+	packet.body().addFile(rparam->resource_path, rparam->resource_size, ((status_code_page) ? -1 : rparam->resource_fd));
+
+	pheader.statusLine(pheader.httpVer(), status_code);
+	pheader.server(Config::params().web_server_name);
+
+	time_t cas = time(nullptr);
+	struct tm* gmt = gmtime(&cas);
+	char datum[100];
+	strftime(datum, sizeof(datum), HTTP_DATE_FORMAT, gmt);
+	pheader.date(datum);
+
+	std::string file_suffix;
+	if (!getFileSuffix(rparam->resource_path, file_suffix)) {
+		abort();
+	}
+	const HttpContentTypeS* content_type = httpContentType(file_suffix);
+	if (content_type == nullptr) {
+		abort();
+	}
+	pheader.contentType(content_type->content_type_label);
+	pheader.contentLength(packet.body().data().content_length_);
+
+	if (pheader.httpVer() == HttpVersion::HTTP_1_1) {
+		pheader.connection("keep-alive");
+	}
+	if (status_code_page)
+	{
+		pheader.end();
+		return;
+	}
+
+	pheader.vary();
+
+	time_t mod_cas = rparam->last_modified;
+	gmt = gmtime(&mod_cas);
+	strftime(datum, sizeof(datum), HTTP_DATE_FORMAT, gmt);
+	pheader.lastModified(datum);
+
+	if (rparam->expires > 0)
+	{
+		time_t exp = cas + rparam->expires;
+		gmt = gmtime(&exp);
+		strftime(datum, sizeof(datum), HTTP_DATE_FORMAT, gmt);
+		pheader.expires(datum);
+	}
+
+	pheader.cacheControl(rparam->cache_type, rparam->expires);
+	if (pheader.httpVer() == HttpVersion::HTTP_1_1)
+	{
+		pheader.etag(rparam->etag);
+		pheader.acceptRanges(rparam->accept_ranges.c_str());
+	}
+	pheader.end();
+}
+
+// Stejne kroky jako HttpPacketBuilder::createStatusPage (status page v pameti)
+static void statusPageHeaders(HttpPacket& packet, const Config::StatusPage& page, const size_t version_index)
+{
+	HttpPacket::Header& pheader = packet.header();
+	HttpClock::Date date;
+	HttpClock::now(date);
+	const size_t fields_offset = pheader.data().size();
+	pheader.fields(page.headers[version_index]);
+	pheader.patch(fields_offset + page.date_offsets[version_index], date, HTTP_DATE_SIZE);
+	pheader.setStatusCode(page.status_code);
+	pheader.connection("keep-alive");
+	packet.body().addData(page.body);
+	pheader.end();
+}
+
+static void setResource(Config::RParams& rparam, const std::string& path)
+{
+	rparam.resource_path = path;
+	rparam.resource_size = 18342;
+	rparam.last_modified = 1715674351;
+	rparam.etag = Config::RParams::generateETag(1715674351, 123456789);
+	rparam.expires = 3600;
+	rparam.cache_type = "public";
+	rparam.accept_ranges = "bytes";
+}
+
+// Paket se pouziva opakovane (jako paket obsluhy spojeni), reset() nastavi i nepodporovanou verzi HTTP
+template <typename Func>
+static double measureNs(const uint64_t count, HttpPacket& packet, const HttpVersion version, Func build)
+{
+	const auto start = std::chrono::steady_clock::now();
+	for (uint64_t i = 0; i < count; ++i)
+	{
+		packet.reset();
+		packet.header().setHttpVersion(version);
+		build();
+		sink = packet.header().data().size();
+	}
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+}
+
+static void report(const char* name, const double ns)
+{
+	printf("  %-34s %8.1f ns %8.2f M headers/s\n", name, ns, 1000.0 / ns);
+}
+
+
+int main(int argc, char** argv)
+{
+	const uint64_t count = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 500000;
+
+	Config::RParams plain;  // Bez predpripravenych fieldu (zaloha, kdyz sablonu nelze sestavit)
+	Config::RParams prerendered;
+	setResource(plain, "index.html");
+	setResource(prerendered, "index.html");
+	prerendered.updateHeaderTemplates();
+
+	for (const HttpVersion version : { HttpVersion::HTTP_1_1, HttpVersion::HTTP_1_0 })
+	{
+		printf("GET /index.html, %s response header\n", ((version == HttpVersion::HTTP_1_1) ? "HTTP/1.1" : "HTTP/1.0"));
+
+		HttpPacketBuilder builder(version);
+		HttpPacket& packet = builder.packet();
+		report("field by field (gmtime + strftime)", measureNs(count, packet, version, [&]() {
+			legacyCommonHeaders(packet, &plain, HttpStatusCode::OK, false);
+		}));
+		report("field by field (HttpClock)", measureNs(count, packet, version, [&]() {
+			builder.createCommonHeaders(&plain, HttpStatusCode::OK);
+		}));
+		report("prerendered, Date/Expires patched", measureNs(count, packet, version, [&]() {
+			builder.createCommonHeaders(&prerendered, HttpStatusCode::OK);
+		}));
+	}
+
+	// Status page 404 (hlavicky po fieldech k souboru vs cela odpoved v pameti), jen pokud jsou resources nainstalovane
+	const std::shared_ptr<const Config::StatusPage> page = HttpPacketBuilder::loadStatusPage(HttpStatusCode::NOT_FOUND,
+		NOT_FOUND_WEB_PAGE);
+	printf("404 status page, HTTP/1.1 response header\n");
+	if (!page)
+	{
+		printf("  %s not readable, skipped\n", RESOURCES_DIR "/" NOT_FOUND_WEB_PAGE);
+		return 0;
+	}
+	Config::RParams status_rparam;
+	setResource(status_rparam, NOT_FOUND_WEB_PAGE);
+	status_rparam.resource_size = page->body->size();
+	HttpPacket packet;
+	report("field by field (gmtime + strftime)", measureNs(count, packet, HttpVersion::HTTP_1_1, [&]() {
+		legacyCommonHeaders(packet, &status_rparam, HttpStatusCode::NOT_FOUND, true);
+	}));
+	report("in memory, Date patched", measureNs(count, packet, HttpVersion::HTTP_1_1, [&]() {
+		statusPageHeaders(packet, *page, 1);
+	}));
+
+	return 0;
+}
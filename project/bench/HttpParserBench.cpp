@@ -0,0 +1,282 @@
+// Mikrobenchmark parseru hlavicky HTTP requestu na realnych hlavickach prohlizecu
+// Porovnava se puvodni zpracovani (httpparser: dve parsovani po znacich do std::string + kopie requestu)
+// a puvodni vyhledani header fieldu (find_if + strcasecmp) s vyhledanim podle slotu
+// Spusteni: make bench && build/bench/HttpParserBench [pocet requestu]
+#include "HttpRequestParser.hpp"
+#include <strings.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+
+
+// Pocitadlo alokaci
+static std::atomic<uint64_t> allocations(0);
+
+void* operator new(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void* ptr = malloc(size);
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+static volatile size_t sink;
+
+
+// Puvodni parser (httpparser::HttpRequestParser): stavovy automat po znacich, kazdy znak push_back do std::string
+class LegacyParser
+{
+	public:
+		struct Request
+		{
+			struct HeaderItem
+			{
+				std::string name;
+				std::string value;
+			};
+
+			std::string method;
+			std::string uri;
+			int versionMajor = 0;
+			int versionMinor = 0;
+			std::vector<HeaderItem> headers;
+			bool keepAlive = false;
+		};
+
+		static bool parse(Request& req, const std::string& data)
+		{
+			enum { METHOD, URI, VERSION, LINE_LF, HEADER_START, NAME, VALUE_START, VALUE, VALUE_LF, END_LF } state = METHOD;
+			std::string version;
+			for (const char input : data)
+			{
+				switch (state)
+				{
+					case METHOD:
+						if (input == ' ') { state = URI; }
+						else if (isControl(input)) { return false; }
+						else { req.method.push_back(input); }
+						break;
+					case URI:
+						if (input == ' ') { state = VERSION; }
+						else if (isControl(input)) { return false; }
+						else { req.uri.push_back(input); }
+						break;
+					case VERSION:
+						if (input == '\r') { state = LINE_LF; }
+						else { version.push_back(input); }
+						break;
+					case LINE_LF:
+					case VALUE_LF:
+						if (input != '\n') { return false; }
+						state = HEADER_START;
+						break;
+					case HEADER_START:
+						if (input == '\r')
+						{
+							state = END_LF;
+							break;
+						}
+						req.headers.push_back(Request::HeaderItem());
+						req.headers.back().name.push_back(input);
+						state = NAME;
+						break;
+					case NAME:
+						if (input == ':') { state = VALUE_START; }
+						else if (isControl(input)) { return false; }
+						else { req.headers.back().name.push_back(input); }
+						break;
+					case VALUE_START:
+						if (input == ' ') { break; }
+						state = VALUE;
+						req.headers.back().value.push_back(input);
+						break;
+					case VALUE:
+						if (input == '\r') { state = VALUE_LF; }
+						else { req.headers.back().value.push_back(input); }
+						break;
+					case END_LF:
+						if (input != '\n' || version.size() != 8) {
+							return false;
+						}
+						req.versionMajor = version[5] - '0';
+						req.versionMinor = version[7] - '0';
+						// Jako httpparser: Connection a Content-Length se hledaji po konci hlavicky
+						req.keepAlive = (find(req, "Connection") == nullptr);
+						find(req, "Content-Length");
+						return true;
+				}
+			}
+			return false;
+		}
+
+		static const Request::HeaderItem* find(const Request& req, const char* name)
+		{
+			const auto it = std::find_if(req.headers.cbegin(), req.headers.cend(), [name](const Request::HeaderItem& item) {
+				return (strcasecmp(name, item.name.c_str()) == 0);
+			});
+			return ((it != req.headers.cend()) ? &*it : nullptr);
+		}
+
+	private:
+		static bool isControl(const char c) { return ((c >= 0 && c <= 31) || c == 127); }
+};
+
+
+// Chrome a Firefox (GET stranky, podminene GET obrazku), curl
+static const char* const requests[] = {
+	"GET /index.html HTTP/1.1\r\n"
+	"Host: www.example.com\r\n"
+	"Connection: keep-alive\r\n"
+	"Cache-Control: max-age=0\r\n"
+	"sec-ch-ua: \"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\", \"Not-A.Brand\";v=\"99\"\r\n"
+	"sec-ch-ua-mobile: ?0\r\n"
+	"sec-ch-ua-platform: \"Linux\"\r\n"
+	"Upgrade-Insecure-Requests: 1\r\n"
+	"User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+	"Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,image/apng,*/*;q=0.8,application/signed-exchange;v=b3;q=0.7\r\n"
+	"Sec-Fetch-Site: none\r\n"
+	"Sec-Fetch-Mode: navigate\r\n"
+	"Sec-Fetch-User: ?1\r\n"
+	"Sec-Fetch-Dest: document\r\n"
+	"Accept-Encoding: gzip, deflate, br, zstd\r\n"
+	"Accept-Language: cs-CZ,cs;q=0.9,en;q=0.8\r\n"
+	"\r\n",
+
+	"GET /images/logo.png HTTP/1.1\r\n"
+	"Host: www.example.com\r\n"
+	"User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:125.0) Gecko/20100101 Firefox/125.0\r\n"
+	"Accept: image/avif,image/webp,*/*\r\n"
+	"Accept-Language: cs,en-US;q=0.7,en;q=0.3\r\n"
+	"Accept-Encoding: gzip, deflate, br\r\n"
+	"Connection: keep-alive\r\n"
+	"Referer: https://www.example.com/index.html\r\n"
+	"If-Modified-Since: Tue, 14 May 2024 08:12:31 GMT\r\n"
+	"If-None-Match: \"6643c8af-3a1c\"\r\n"
+	"Sec-Fetch-Dest: image\r\n"
+	"Sec-Fetch-Mode: no-cors\r\n"
+	"Sec-Fetch-Site: same-origin\r\n"
+	"\r\n",
+
+	"GET /data.json HTTP/1.1\r\n"
+	"Host: localhost:8080\r\n"
+	"User-Agent: curl/8.5.0\r\n"
+	"Accept: */*\r\n"
+	"\r\n"
+};
+
+// Header fieldy, ktere obsluha GET requestu zjistuje (Http1_0 + Http1_1)
+static const HttpHeaderField lookups[] = {
+	HttpHeaderField::CONTENT_LENGTH, HttpHeaderField::CONTENT_TYPE, HttpHeaderField::CONTENT_ENCODING,
+	HttpHeaderField::ACCEPT_ENCODING, HttpHeaderField::IF_MODIFIED_SINCE, HttpHeaderField::IF_UNMODIFIED_SINCE,
+	HttpHeaderField::IF_MATCH, HttpHeaderField::IF_NONE_MATCH, HttpHeaderField::IF_RANGE, HttpHeaderField::RANGE,
+	HttpHeaderField::EXPECT
+};
+static const char* const lookup_names[] = {
+	"Content-Length", "Content-Type", "Content-Encoding", "Accept-Encoding", "If-Modified-Since",
+	"If-Unmodified-Since", "If-Match", "If-None-Match", "If-Range", "Range", "Expect"
+};
+
+static double elapsedNs(const std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char* name, const double ns, const uint64_t allocs, const uint64_t count)
+{
+	printf("  %-36s %8.1f ns %6.2f allocations/request\n", name, ns / count, static_cast<double>(allocs) / count);
+}
+
+
+int main(int argc, char** argv)
+{
+	const uint64_t count = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 500000;
+
+	for (const char* const request : requests)
+	{
+		const std::string data(request);
+		const size_t header_count = static_cast<size_t>(std::count(data.begin(), data.end(), '\n')) - 2;
+		printf("%zu B, %zu header fields (%s)\n", data.size(), header_count, data.substr(0, data.find('\r')).c_str());
+
+		// Puvodne: kopie pri urceni verze + parsovani, znovu prijeti + parsovani, kopie do request_
+		uint64_t before = allocations;
+		auto start = std::chrono::steady_clock::now();
+		for (uint64_t i = 0; i < count; ++i)
+		{
+			const std::string peeked = data;
+			LegacyParser::Request version_request;
+			LegacyParser::parse(version_request, peeked);
+			std::string received = data;
+			LegacyParser::Request request;
+			LegacyParser::parse(request, received);
+			const LegacyParser::Request copy = request;
+			sink = copy.headers.size();
+		}
+		report("httpparser (2 passes + copy)", elapsedNs(start), allocations - before, count);
+
+		// Nyni: jeden pruchod nad prijimacim bufferem, parser se pouziva opakovane (jako v obsluze spojeni)
+		// Prijeti do bufferu = kopie dat do existujici kapacity (bind() prepisuje konce hodnot na '\0')
+		HttpRequestParser parser;
+		std::string buffer = data;
+		before = allocations;
+		start = std::chrono::steady_clock::now();
+		for (uint64_t i = 0; i < count; ++i)
+		{
+			buffer.assign(data);
+			parser.reset();
+			if (parser.parse(buffer) != HttpRequestParser::Result::COMPLETED) {
+				abort();
+			}
+			parser.bind(buffer);
+			sink = parser.request().headers.size();
+		}
+		report("HttpRequestParser", elapsedNs(start), allocations - before, count);
+
+		// Hlavicka prijata po castech (segmenty po 100 B), parsovani pokracuje po kazdem prijeti
+		buffer.assign(data);
+		before = allocations;
+		start = std::chrono::steady_clock::now();
+		for (uint64_t i = 0; i < count; ++i)
+		{
+			parser.reset();
+			HttpRequestParser::Result result = HttpRequestParser::Result::INCOMPLETE;
+			for (size_t received = 100; result == HttpRequestParser::Result::INCOMPLETE; received += 100) {
+				result = parser.parse(std::string_view(buffer.data(), std::min(received, buffer.size())));
+			}
+			sink = parser.request().headers.size();
+		}
+		report("HttpRequestParser (100 B segments)", elapsedNs(start), allocations - before, count);
+
+		// Vyhledani vsech header fieldu, ktere obsluha GET cte
+		LegacyParser::Request legacy_request;
+		LegacyParser::parse(legacy_request, data);
+		start = std::chrono::steady_clock::now();
+		for (uint64_t i = 0; i < count; ++i)
+		{
+			for (const char* const name : lookup_names) {
+				sink = reinterpret_cast<uintptr_t>(LegacyParser::find(legacy_request, name));
+			}
+		}
+		report("11 lookups, find_if + strcasecmp", elapsedNs(start), 0, count);
+
+		start = std::chrono::steady_clock::now();
+		for (uint64_t i = 0; i < count; ++i)
+		{
+			for (const HttpHeaderField field : lookups) {
+				sink = reinterpret_cast<uintptr_t>(parser.request().header(field));
+			}
+		}
+		report("11 lookups, slot", elapsedNs(start), 0, count);
+	}
+
+	return 0;
+}
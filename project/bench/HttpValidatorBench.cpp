@@ -0,0 +1,192 @@
+// Mikrobenchmark kontroly a parsovani hlavicky Range a Content-Disposition casti multipart/form-data
+// Porovnava se puvodni zpracovani (regcomp + regexec na kazdy request, pak druhy pruchod strtok_r/strtoull),
+// regex prelozeny jen jednou a rucne psane parsery z HttpGlobal
+// Spusteni: make bench && build/bench/HttpValidatorBench [pocet requestu]
+#include "HttpGlobal.hpp"
+#include <regex.h>
+#include <string.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// Pocitadlo alokaci pres new (malloc uvnitr regcomp a regexec se nepocita)
+static std::atomic<uint64_t> allocations(0);
+
+void* operator new(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void* ptr = malloc(size);
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+static volatile uint64_t sink;
+
+
+// Puvodni vzory (HttpGlobal.hpp pred nahrazenim)
+#define LEGACY_RANGE_PATTERN "^bytes=(-[0-9]+|[0-9]+-[0-9]*)(,[[:space:]](-[0-9]+|[0-9]+-[0-9]*))*$"
+#define LEGACY_CONTENT_DISPOSITION_PATTERN "^Content-Disposition:\\s*form-data;\\s*name=\"([^\"]+)\"\\s*;\\s*filename=\"([^\"]+)\"$"
+
+// Puvodni Http1_1::headersRange: kontrola regexem, pak rozdeleni strtok_r a prevod strtoull
+// (puvodni httpCheckRangeHeader nevolal regfree, tady se uvolnuje, aby benchmark nerostl v pameti)
+static bool legacyRange(const regex_t* compiled, const std::string& value, std::vector<HttpRange>& ranges)
+{
+	regex_t regex;
+	if (!compiled)
+	{
+		if (regcomp(&regex, LEGACY_RANGE_PATTERN, REG_EXTENDED) != 0) {
+			return false;
+		}
+		compiled = &regex;
+	}
+	const bool matched = (regexec(compiled, value.c_str(), 0, NULL, 0) == 0);
+	if (compiled == &regex) {
+		regfree(&regex);
+	}
+	if (!matched) {
+		return false;
+	}
+
+	std::vector<std::string> ranges_str;
+	const char* bytes_str = "bytes=";
+	std::string ranges_cpy = value.substr(strlen(bytes_str));
+	char* saveptr = nullptr;
+	for (char* token = strtok_r(&ranges_cpy[0], ", ", &saveptr); token; token = strtok_r(nullptr, ", ", &saveptr)) {
+		ranges_str.push_back(token);
+	}
+
+	ranges.resize(ranges_str.size());
+	for (size_t i = 0; i < ranges_str.size(); ++i)
+	{
+		const std::string& rstr = ranges_str[i];
+		HttpRange& range = ranges[i];
+		if (rstr.front() == '-')
+		{
+			range.end = strtoull(rstr.substr(1).c_str(), NULL, 10);
+			range.type = HttpRangeType::SUFFIX_LENGTH;
+		}
+		else if (rstr.back() == '-')
+		{
+			range.start = strtoull(rstr.substr(0, rstr.size() - 1).c_str(), NULL, 10);
+			range.type = HttpRangeType::START_INF;
+		}
+		else
+		{
+			const size_t range_ind = rstr.find('-');
+			range.start = strtoull(rstr.substr(0, range_ind).c_str(), NULL, 10);
+			range.end = strtoull(rstr.substr(range_ind + 1).c_str(), NULL, 10);
+			range.type = HttpRangeType::START_END;
+		}
+	}
+	return true;
+}
+
+// Puvodni Http1_0::receiveRequestBodyPostMethod: kopie radku, kontrola regexem, pak hledani jmena souboru
+static bool legacyContentDisposition(const regex_t* compiled, const std::string& part, std::string& file_name)
+{
+	const std::string content_disp = part.substr(0, part.find("\r\n"));
+	regex_t regex;
+	if (!compiled)
+	{
+		if (regcomp(&regex, LEGACY_CONTENT_DISPOSITION_PATTERN, REG_EXTENDED) != 0) {
+			return false;
+		}
+		compiled = &regex;
+	}
+	const bool matched = (regexec(compiled, content_disp.c_str(), 0, NULL, 0) == 0);
+	if (compiled == &regex) {
+		regfree(&regex);
+	}
+	if (!matched) {
+		return false;
+	}
+
+	const size_t filename_ind = part.find("filename=");
+	const size_t quote1_ind = part.find('"', filename_ind);
+	const size_t quote2_ind = part.find('"', quote1_ind + 1);
+	file_name = part.substr(quote1_ind + 1, quote2_ind - quote1_ind - 1);
+	return true;
+}
+
+static double elapsedNs(const std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Func>
+static void measure(const char* name, const uint64_t count, Func func)
+{
+	const uint64_t before = allocations;
+	const auto start = std::chrono::steady_clock::now();
+	for (uint64_t i = 0; i < count; ++i)
+	{
+		if (!func()) {
+			abort();
+		}
+	}
+	printf("  %-28s %9.1f ns %6.2f new/request\n", name, elapsedNs(start) / count,
+		static_cast<double>(allocations - before) / count);
+}
+
+
+int main(int argc, char** argv)
+{
+	const uint64_t count = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 100000;
+
+	regex_t range_regex;
+	regex_t disposition_regex;
+	if (regcomp(&range_regex, LEGACY_RANGE_PATTERN, REG_EXTENDED) != 0 ||
+		regcomp(&disposition_regex, LEGACY_CONTENT_DISPOSITION_PATTERN, REG_EXTENDED) != 0)
+	{
+		printf("Failed to compile legacy patterns\n");
+		return 1;
+	}
+
+	// Navazani stahovani (jeden rozsah) a prehravac videa / PDF prohlizec (vice rozsahu)
+	for (const char* const value : { "bytes=1048576-", "bytes=0-1023, 4096-8191, -512" })
+	{
+		const std::string range_value(value);
+		std::vector<HttpRange> ranges;
+		printf("Range: %s\n", range_value.c_str());
+		measure("regcomp + regexec + strtok_r", count, [&]() { return legacyRange(nullptr, range_value, ranges); });
+		measure("precompiled regex + strtok_r", count, [&]() { return legacyRange(&range_regex, range_value, ranges); });
+		measure("httpParseRangeHeader", count, [&]() {
+			const bool parsed = httpParseRangeHeader(range_value, &ranges);
+			sink = ranges.back().end;
+			return parsed;
+		});
+	}
+
+	const std::string part = "Content-Disposition: form-data; name=\"upload\"; filename=\"report-2024-05.pdf\"\r\n"
+		"Content-Type: application/pdf\r\n\r\n";
+	std::string file_name;
+	printf("Content-Disposition (multipart part header)\n");
+	measure("regcomp + regexec + find", count, [&]() {
+		return legacyContentDisposition(nullptr, part, file_name);
+	});
+	measure("precompiled regex + find", count, [&]() {
+		return legacyContentDisposition(&disposition_regex, part, file_name);
+	});
+	measure("httpParseContentDisposition", count, [&]() {
+		std::string_view name;
+		std::string_view filename;
+		const bool parsed = httpParseContentDisposition(std::string_view(part).substr(0, part.find("\r\n")), name, filename);
+		file_name.assign(filename);
+		return parsed;
+	});
+
+	regfree(&range_regex);
+	regfree(&disposition_regex);
+	return 0;
+}
@@ -0,0 +1,211 @@
+// Mikrobenchmark registru spojeni: otevreni, vyhledani a zavreni spojeni pri 1k-100k otevrenych spojenich
+// (SlotMap vs puvodni std::vector + find_if) a skalovani podle poctu shardu (kazdy shard = SlotMap + mutex)
+// Spusteni: make bench && build/bench/SlotMapBench [pocet vlaken]
+#include "SlotMap.hpp"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Zastupce TcpServer::Connection (registr drzi shared_ptr, puvodni verze hledala podle socketu)
+struct Connection
+{
+	int socket;
+};
+
+static double elapsedNs(const std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Otevreni + vyhledani (udalost event loopu) + zavreni pri population otevrenych spojenich
+static double slotMapCycleNs(const size_t population, const size_t iterations)
+{
+	SlotMap<std::shared_ptr<Connection>> connections;
+	std::mutex mutex;
+	std::vector<SlotMap<std::shared_ptr<Connection>>::Handle> handles;
+	for (size_t i = 0; i < population; ++i) {
+		handles.push_back(connections.insert(std::make_shared<Connection>(Connection{ static_cast<int>(i) })));
+	}
+
+	std::shared_ptr<Connection> connection = std::make_shared<Connection>(Connection{ -1 });
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		SlotMap<std::shared_ptr<Connection>>::Handle handle;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			handle = connections.insert(connection);
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!connections.find(handle)) {
+				abort();
+			}
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			connections.erase(handle);
+		}
+	}
+	return elapsedNs(start) / iterations;
+}
+
+// Puvodni registr: push_back pri otevreni, find_if podle socketu pri udalosti i pri zavreni (erase posouva zbytek)
+static double vectorCycleNs(const size_t population, const size_t iterations)
+{
+	std::vector<std::shared_ptr<Connection>> connections;
+	std::vector<int> open_sockets;  // Pro vyber nahodneho otevreneho spojeni
+	std::mutex mutex;
+	for (size_t i = 0; i < population; ++i)
+	{
+		connections.push_back(std::make_shared<Connection>(Connection{ static_cast<int>(i) }));
+		open_sockets.push_back(static_cast<int>(i));
+	}
+
+	const auto by_socket = [](const int socket) {
+		return [socket](const std::shared_ptr<Connection>& conn) { return (conn->socket == socket); };
+	};
+	int next_socket = static_cast<int>(population);
+	uint32_t random = 12345;
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			connections.push_back(std::make_shared<Connection>(Connection{ next_socket }));
+		}
+		open_sockets.push_back(next_socket++);
+
+		// Udalost a zavreni libovolneho otevreneho spojeni (ne nutne naposledy otevreneho)
+		random = random * 1103515245 + 12345;
+		const size_t victim = random % open_sockets.size();
+		const int socket = open_sockets[victim];
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (std::find_if(connections.begin(), connections.end(), by_socket(socket)) == connections.end()) {
+				abort();
+			}
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			connections.erase(std::find_if(connections.begin(), connections.end(), by_socket(socket)));
+		}
+		open_sockets[victim] = open_sockets.back();
+		open_sockets.pop_back();
+	}
+	return elapsedNs(start) / iterations;
+}
+
+// Systemova volani, ktera otevreni a zavreni spojeni provazi vzdy (registrace socketu v epoll)
+static double epollCycleNs(const size_t iterations)
+{
+	int sockets[2];
+	const int epoll_fd = epoll_create1(0);
+	if (epoll_fd == -1 || socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == -1) {
+		return 0;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		epoll_event event = {};
+		event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+		epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sockets[0], &event);
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, sockets[0], nullptr);
+	}
+	const double ns = elapsedNs(start) / iterations;
+
+	close(sockets[0]);
+	close(sockets[1]);
+	close(epoll_fd);
+	return ns;
+}
+
+// Vlakna rozdelena mezi shardy, kazde otevira, vyhledava a zavira spojeni ve svem shardu
+static double shardedMops(const size_t shards, const size_t threads, const size_t iterations)
+{
+	struct Shard
+	{
+		SlotMap<std::shared_ptr<Connection>> connections;
+		std::mutex mutex;
+	};
+	std::vector<std::unique_ptr<Shard>> shard_list;
+	for (size_t i = 0; i < shards; ++i)
+	{
+		shard_list.emplace_back(new Shard());
+		for (size_t j = 0; j < 10000; ++j) {
+			shard_list.back()->connections.insert(std::make_shared<Connection>(Connection{ static_cast<int>(j) }));
+		}
+	}
+
+	std::atomic<bool> go(false);
+	std::vector<std::thread> workers;
+	for (size_t t = 0; t < threads; ++t)
+	{
+		workers.emplace_back([&, t]()
+		{
+			Shard& shard = *shard_list[t % shards];
+			std::shared_ptr<Connection> connection = std::make_shared<Connection>(Connection{ -1 });
+			while (!go) {
+				std::this_thread::yield();
+			}
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				SlotMap<std::shared_ptr<Connection>>::Handle handle;
+				{
+					std::lock_guard<std::mutex> lock(shard.mutex);
+					handle = shard.connections.insert(connection);
+				}
+				{
+					std::lock_guard<std::mutex> lock(shard.mutex);
+					shard.connections.find(handle);
+				}
+				{
+					std::lock_guard<std::mutex> lock(shard.mutex);
+					shard.connections.erase(handle);
+				}
+			}
+		});
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	go = true;
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	return (threads * iterations) / (elapsedNs(start) / 1000.0);
+}
+
+
+int main(int argc, char** argv)
+{
+	const size_t threads = (argc > 1) ? strtoull(argv[1], nullptr, 10) : std::max(2u, std::thread::hardware_concurrency());
+
+	printf("Open + lookup + close, ns per connection (each step under the registry mutex)\n");
+	printf("%12s %12s %16s\n", "connections", "SlotMap", "vector+find_if");
+	for (const size_t population : { 1000, 10000, 100000 })
+	{
+		printf("%12zu %12.1f %16.1f\n", population, slotMapCycleNs(population, 2000000),
+			vectorCycleNs(population, std::max<size_t>(200, 20000000 / population)));
+	}
+	printf("epoll_ctl ADD + DEL per connection: %.1f ns\n", epollCycleNs(200000));
+
+	printf("\nShard scaling (%zu threads, %u CPUs), million open+lookup+close cycles per second\n",
+		threads, std::thread::hardware_concurrency());
+	for (size_t shards = 1; shards <= threads; shards = ((shards * 2 > threads && shards < threads) ? threads : shards * 2)) {
+		printf("%4zu shards: %6.2f\n", shards, shardedMops(shards, threads, 1000000));
+	}
+
+	return 0;
+}
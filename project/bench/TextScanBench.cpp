@@ -0,0 +1,92 @@
+// Mikrobenchmark TextScan: kazda podporovana implementace na datech typickych pro server
+// (konec hlavicky, hranice multipart v tele, URI a hodnoty header fields)
+// Spusteni: make bench && build/bench/TextScanBench
+#include "TextScan.hpp"
+#include <cstdio>
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <string_view>
+
+
+static volatile size_t sink;
+
+struct Case
+{
+	const char* name;
+	std::string data;
+	std::string pattern;  // Prazdny -> skipVisible
+	bool allow_space = false;
+};
+
+static double measureNs(const TextScan::Kernel kernel, const Case& test)
+{
+	// Pocet opakovani podle velikosti dat (priblizne stejna doba pro vsechny pripady)
+	const size_t iterations = std::max<size_t>(1000, (size_t(1) << 28) / (test.data.size() + 64));
+	const std::string_view text(test.data);
+
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		if (test.pattern.empty()) {
+			sink = TextScan::skipVisible(kernel, test.data.data(), 0, test.data.size(), test.allow_space);
+		}
+		else {
+			sink = TextScan::find(kernel, text, test.pattern);
+		}
+	}
+	const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / iterations;
+}
+
+
+int main()
+{
+	const std::string header_line = "Accept-Language: cs-CZ,cs;q=0.9,en;q=0.8\r\n";
+	std::string small_header = "GET /index.html HTTP/1.1\r\nHost: www.example.com\r\n";
+	while (small_header.size() < 500) {
+		small_header += header_line;
+	}
+	std::string large_header = small_header;
+	while (large_header.size() < 4000) {
+		large_header += header_line;
+	}
+	const std::string boundary = "--------------------------d74496d66958873e";
+	std::string body(1 << 20, 'x');
+	for (size_t i = 0; i < body.size(); i += 61) {
+		body[i] = '-';  // Castecne shody prvniho znaku hranice
+	}
+
+	const Case cases[] = {
+		{ "header end (500 B)", small_header + "\r\n", "\r\n\r\n" },
+		{ "header end (4 kB)", large_header + "\r\n", "\r\n\r\n" },
+		{ "multipart boundary (1 MB)", body + "\r\n" + boundary, boundary },
+		{ "URI (100 B)", "/images/" + std::string(84, 'a') + ".png?v=12 ", "" },
+		{ "header value (200 B)", "session=" + std::string(190, 'b') + "; path=/\r", "", true },
+		{ "header value (4 kB)", "session=" + std::string(4000, 'c') + "\r", "", true }
+	};
+
+	printf("%-28s", "");
+	for (const TextScan::Kernel kernel : { TextScan::Kernel::SCALAR, TextScan::Kernel::SSE42, TextScan::Kernel::AVX2 }) {
+		printf("%22s", TextScan::kernelName(kernel));
+	}
+	printf("\n");
+
+	for (const Case& test : cases)
+	{
+		printf("%-28s", test.name);
+		for (const TextScan::Kernel kernel : { TextScan::Kernel::SCALAR, TextScan::Kernel::SSE42, TextScan::Kernel::AVX2 })
+		{
+			if (!TextScan::kernelSupported(kernel))
+			{
+				printf("%22s", "-");
+				continue;
+			}
+			const double ns = measureNs(kernel, test);
+			printf("%11.0f ns %5.1f GB/s", ns, test.data.size() / ns);
+		}
+		printf("\n");
+	}
+
+	return 0;
+}
@@ -0,0 +1,207 @@
+// Mikrobenchmark ThreadPool: alokace na heapu na jeden task a propustnost tasku
+// Porovnava se puvodni pool (std::list<std::function> pod jednim mutexem + sem_t)
+// Spusteni: make bench && build/bench/ThreadPoolBench [pocet tasku] [pocet vlaken]
+#include "ThreadPool.hpp"
+#include <semaphore.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+
+// Pocitadlo alokaci (vsechny new ve vsech vlaknech)
+static std::atomic<uint64_t> allocations(0);
+
+void* operator new(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void* ptr = malloc(size);
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+
+// Puvodni ThreadPool (pred work-stealing frontami)
+class LegacyPool
+{
+	public:
+		using Task = std::function<void()>;
+
+		LegacyPool(const size_t size)
+		{
+			sem_init(&semaphore_, 0, 0);
+			for (size_t i = 0; i < size; ++i) {
+				threads_.emplace_back(&LegacyPool::worker, this);
+			}
+		}
+		~LegacyPool()
+		{
+			run_ = false;
+			for (size_t i = 0; i < threads_.size(); ++i) {
+				sem_post(&semaphore_);
+			}
+			for (auto& thread : threads_) {
+				thread.join();
+			}
+			sem_destroy(&semaphore_);
+		}
+
+		bool queueTask(Task&& task)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			task_queue_.emplace_back(std::move(task));
+			return (sem_post(&semaphore_) == 0);
+		}
+
+	private:
+		void worker()
+		{
+			while (run_)
+			{
+				if (sem_wait(&semaphore_) == -1 || !run_) {
+					continue;
+				}
+
+				Task task;
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+					if (task_queue_.empty()) {
+						continue;
+					}
+					task = std::move(task_queue_.front());
+					task_queue_.pop_front();
+				}
+				task();
+			}
+		}
+
+	private:
+		std::atomic<bool> run_{true};
+		std::mutex mutex_;
+		sem_t semaphore_;
+		std::list<Task> task_queue_;
+		std::vector<std::thread> threads_;
+};
+
+
+// Stejne zachyceni jako obsluha spojeni z WebServer::createSession ([this, tcp_server, connection, http_client])
+struct Session
+{
+	std::atomic<uint64_t>* done;
+	std::shared_ptr<int> tcp_server;
+	std::shared_ptr<int> connection;
+	std::shared_ptr<int> http_client;
+};
+
+static double elapsedMs(const std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Ulozeni obsluhy spojeni do tasku, presun a spusteni -> alokace na jednu obsluhu
+template <typename Task>
+static double storageAllocations(const Session& session, const uint64_t count)
+{
+	const uint64_t before = allocations;
+	for (uint64_t i = 0; i < count; ++i)
+	{
+		Task task = [done = session.done, tcp_server = session.tcp_server, connection = session.connection,
+			http_client = session.http_client]() mutable { done->fetch_add(1, std::memory_order_relaxed); };
+		Task moved = std::move(task);
+		moved();
+	}
+	return static_cast<double>(allocations - before) / count;
+}
+
+// Tasky z jednoho vnejsiho vlakna (event loop) a z vlaken poolu (keep-alive, dalsi request spojeni)
+template <typename Pool>
+static void throughput(const char* name, Pool& pool, const Session& session, const uint64_t count)
+{
+	std::atomic<uint64_t>& done = *session.done;
+
+	// Nejvyse IN_FLIGHT cekajicich tasku (jako pri omezenem poctu spojeni, mene nez predalokovanych uzlu poolu)
+	static constexpr uint64_t IN_FLIGHT = 512;
+	done = 0;
+	uint64_t before = allocations;
+	auto start = std::chrono::steady_clock::now();
+	for (uint64_t i = 0; i < count; ++i)
+	{
+		while (i - done >= IN_FLIGHT) {
+			std::this_thread::yield();
+		}
+		while (!pool.queueTask([session]() mutable { session.done->fetch_add(1, std::memory_order_relaxed); })) {
+			std::this_thread::yield();
+		}
+	}
+	while (done < count) {
+		std::this_thread::yield();
+	}
+	double ms = elapsedMs(start);
+	printf("%-8s external: %8.0f tasks/ms, %.2f allocations/task\n", name, count / ms,
+		static_cast<double>(allocations - before) / count);
+
+	// Kazdy task zaradi dalsi (retezce jako requesty na keep-alive spojeni)
+	static constexpr uint64_t CHAINS = 64;
+	done = 0;
+	before = allocations;
+	start = std::chrono::steady_clock::now();
+	std::function<void(uint64_t)> chain = [&pool, &chain, &done](const uint64_t left)
+	{
+		done.fetch_add(1, std::memory_order_relaxed);
+		if (left > 1)
+		{
+			while (!pool.queueTask([&chain, left]() { chain(left - 1); })) {
+				std::this_thread::yield();
+			}
+		}
+	};
+	for (uint64_t i = 0; i < CHAINS; ++i) {
+		pool.queueTask([&chain, count]() { chain(count / CHAINS); });
+	}
+	while (done < (count / CHAINS) * CHAINS) {
+		std::this_thread::yield();
+	}
+	ms = elapsedMs(start);
+	printf("%-8s chained:  %8.0f tasks/ms, %.2f allocations/task\n", name, count / ms,
+		static_cast<double>(allocations - before) / count);
+}
+
+
+int main(int argc, char** argv)
+{
+	const uint64_t count = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 1000000;
+	const size_t threads = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 4;
+
+	std::atomic<uint64_t> done(0);
+	const Session session = { &done, std::make_shared<int>(0), std::make_shared<int>(0), std::make_shared<int>(0) };
+
+	printf("Task storage (%zu B capture, InplaceTask inline size %zu B)\n", sizeof(Session), InplaceTask::INLINE_SIZE);
+	printf("std::function: %.2f allocations/task\n", storageAllocations<std::function<void()>>(session, count));
+	printf("InplaceTask:   %.2f allocations/task\n", storageAllocations<InplaceTask>(session, count));
+
+	printf("Throughput (%llu tasks, %zu threads)\n", static_cast<unsigned long long>(count), threads);
+	{
+		LegacyPool pool(threads);
+		throughput("legacy", pool, session, count);
+	}
+	{
+		ThreadPool pool(threads);
+		pool.start();
+		throughput("current", pool, session, count);
+		pool.stop();
+	}
+
+	return 0;
+}
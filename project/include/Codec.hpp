@@ -4,7 +4,8 @@
 
 namespace Codec
 {
-    bool compress_data(std::string& compressed_data, const void* data, const size_t dataSize, const bool gzip);
+    // level: -1 (default of zlib), 1 (fastest) - 9 (best compression)
+    bool compress_data(std::string& compressed_data, const void* data, const size_t dataSize, const bool gzip, const int level = -1);
     bool decompress_data(std::string& decompressed_data, const void* data, const size_t data_size, const bool gzip);
     bool compress_string(std::string& compressed_data, const std::string& data, const bool gzip);
     bool decompress_string(std::string& decompressed_data, const std::string& data, const bool gzip);
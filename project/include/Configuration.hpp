@@ -2,13 +2,15 @@
 #define __CONFIGURATION_HPP__
 #include "Globals.hpp"
 #include "HttpGlobal2.hpp"
+#include "HttpGlobal.hpp"
 #include <string>
 #include <cstdint>
 #include <unordered_map>
 #include <vector>
 #include <mutex>
-#include <pthread.h>
+#include <condition_variable>
 #include <atomic>
+#include <memory>
 
 
 class Config
@@ -29,9 +31,23 @@ class Config
 			std::string ssl_certificate_ecdsa;
 			std::string private_key_ecdsa;
 			std::vector<std::string> cipher_suites;
+			bool ktls_enabled = false;
 
+			uint16_t listener_shards = 0;
 			uint16_t client_threads = 0;
+			uint16_t client_threads_max = 0;
+			uint32_t client_threads_spawn_delay = 0;
+			uint32_t client_threads_idle_timeout = 0;
+			uint32_t max_connections = 0;
+			uint16_t disk_io_threads = 0;
+			std::string network_backend;
+			uint32_t keepalive_timeout = 0;
+			uint32_t client_header_timeout = 0;
+			uint32_t client_body_timeout = 0;
 			uint32_t file_chunk_size = 0;
+			uint64_t file_cache_size = 0;
+			uint64_t file_cache_max_file_size = 0;
+			uint64_t compressed_variant_max_file_size = 0;
 			uint16_t max_header_size = 0;
 			uint16_t client_body_buffer_size = 0;
 			uint64_t client_max_body_size = 0;
@@ -56,6 +72,20 @@ class Config
 			bool isSet() const { return (last_modified != -1 && !etag.empty() && resource_fd != -1); }
 			static std::string generateETag(const int64_t sec, const int64_t nsec);
 
+			// Predpripravene header fields odpovedi s resource, pri odeslani se doplni jen Date a Expires
+			struct HeaderTemplate
+			{
+				std::string fields;
+				size_t date_offset = 0;
+				size_t expires_offset = std::string::npos;  // npos -> Expires je pevne nebo chybi
+				time_t last_modified = -1;
+				std::string last_modified_date;  // Last-Modified naformatovane jednou pro tuto verzi resource
+			};
+			std::shared_ptr<const HeaderTemplate> headerTemplate(const bool http_1_1) const { 
+				return std::atomic_load(&header_templates[http_1_1 ? 1 : 0]); 
+			}
+			void updateHeaderTemplates();
+
 			std::string resource_path;  // Uklada se vzdy bez "/" jako prvni znak
 			std::vector<std::string> methods_allowed;
 			std::string accept_ranges;
@@ -66,13 +96,34 @@ class Config
 			time_t last_modified;
 			ETag etag;
 
-			pthread_rwlock_t access_lock;
+			// Zamek patri requestu, ne vlaknu (request ukladajici resource dokoncuje jine vlakno nez ho zamklo) -> ne pthread_rwlock_t
+			std::mutex access_lock;
+			std::condition_variable access_cond;
+			uint32_t access_readers = 0;
+			bool access_writer = false;
 			std::atomic<uint32_t> access_counter;
+			uint32_t access_waiters = 0;  // Requesty cekajici na zamek resource mimo resources.conf (chraneno orparams_mutex_)
 			std::mutex update_lock;
 			int resource_fd;
 
 			// Posledni cas pristupu k resource
 			time_t last_resource_access;
+
+			// [0] -> HTTP/1.0, [1] -> HTTP/1.1 (meni se i pri sdilenem zamku resource -> std::atomic_load/store)
+			std::shared_ptr<const HeaderTemplate> header_templates[2];
+		};
+
+		// Status page nactena do pameti -> odpoved se sestavi bez zamku resource a bez cteni souboru
+		struct StatusPage
+		{
+			HttpStatusCode status_code = HttpStatusCode::UNSUPPORTED;
+			std::string resource_path;
+			std::string headers[2];  // [0] -> HTTP/1.0, [1] -> HTTP/1.1 (status line az Content-Length, bez ukonceni hlavicky)
+			size_t date_offsets[2] = { 0, 0 };  // Misto pro hodnotu Date
+			std::shared_ptr<const std::string> body;
+			int64_t modified_ns = -1;  // Posledni zmena souboru, ze ktere byla page sestavena
+			mutable std::atomic<time_t> checked{ -1 };  // Kdy se naposledy kontrolovala zmena souboru
+			mutable std::atomic_flag checking = ATOMIC_FLAG_INIT;
 		};
 
 		~Config() = default;
@@ -82,12 +133,15 @@ class Config
 		static void orparamsRemove(const Config::RParams* rparam);
 		static bool loadConfig();
 		static bool loadResourcesConfig();
+		static std::shared_ptr<const Config::StatusPage> statusPage(const HttpStatusCode status_code);
 		static void reset();
 
 	private:
 		Config() = default;
 		bool buildParams();
 		bool buildRParams();
+		bool buildStatusPages();
+		static Config::RParams* orparamsFind(const std::string& resource);  // Volat pod orparams_mutex_
 
 	private:
 		static Config obj_;
@@ -95,6 +149,7 @@ class Config
 		std::unordered_map<std::string, Config::RParams> rparams_;  // rparams_.first -> resource name v konfiguraku 
 		std::unordered_map<std::string, Config::RParams> other_rparams_;  // resource params pro resources, ktere nejsou devinovany v resources.conf
 		std::mutex orparams_mutex_;
+		std::shared_ptr<const Config::StatusPage> status_pages_[STATUS_PAGES_COUNT];  // Meni se za behu -> std::atomic_load/store
 };
 
 
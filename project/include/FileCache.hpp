@@ -0,0 +1,152 @@
+#ifndef __FILE_CACHE_HPP__
+#define __FILE_CACHE_HPP__
+#include "Configuration.hpp"
+#include <string>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <mutex>
+#include <memory>
+
+
+// Obsah malych resources v pameti sdileny vsemi spojenimi (odpoved se posle bez open/sendfile/mmap)
+// Velikost je omezena v bytech, o vyrazeni rozhoduje W-TinyLFU: novy resource prijde do maleho LRU okna,
+// z okna se do hlavni casti (segmentovane LRU) dostane jen pokud je pouzivan casteji nez resource, ktery by vytlacil
+// Drzi i komprimovane varianty resources (gzip, deflate) -> resource se komprimuje jednou, ne pri kazdem odeslani
+// (varianty vetsi nez max_file_size se ukladaji do COMPRESSED_FILES_DIR a posilaji se ze souboru)
+class FileCache
+{
+	public:
+		struct Stats
+		{
+			uint64_t hits = 0;
+			uint64_t misses = 0;
+			uint64_t evictions = 0;
+			uint64_t compressions = 0;
+			uint64_t size = 0;  // Byty obsahu v cache
+			uint64_t entries = 0;
+		};
+
+		// Komprimovana varianta resource (data v pameti, nebo soubor v COMPRESSED_FILES_DIR)
+		struct Variant
+		{
+			std::shared_ptr<const std::string> data;
+			std::string file_path;  // Relativne k RESOURCES_DIR (jako resource_path)
+			uint64_t size = 0;
+
+			bool isSet() const { return (data || !file_path.empty()); }
+		};
+
+		// max_size = 0 -> cache je vypnuta, compressed_max_file_size = 0 -> varianty se nevytvari
+		static void init(const uint64_t max_size, const uint64_t max_file_size, const uint64_t compressed_max_file_size);
+		static void reset();
+
+		// Obsah aktualni verze resource (resource musi byt zamceny), pri prvnim cteni se nacte ze souboru
+		// nullptr -> resource se posle ze souboru (je prilis velky, cache je vypnuta nebo cteni selhalo)
+		static std::shared_ptr<const std::string> get(const Config::RParams& rparam);
+
+		// Komprimovana varianta aktualni verze resource (resource musi byt zamceny), volajici vlakno nikdy nekomprimuje
+		// Nenastavena -> resource se zakoduje pri odesilani (je prilis velky, komprese selhala nebo varianta jeste neni hotova)
+		// build = true -> varianta chybi a volajici ji ma nechat vytvorit mimo obsluhu requestu buildCompressed(),
+		// pokud to nejde, musi zavolat cancelCompressed() (jinak by ji uz nikdo nevytvoril)
+		static Variant getCompressed(const Config::RParams& rparam, const HttpContentEncoding encoding, bool& build);
+		static void buildCompressed(const std::string& resource_path, const HttpContentEncoding encoding, const ETag& etag);
+		static void cancelCompressed(const std::string& resource_path, const HttpContentEncoding encoding);
+
+		static void erase(const std::string& resource_path);  // Obsah i vsechny varianty
+		static Stats stats();
+
+	private:
+		enum class Segment : uint8_t
+		{
+			WINDOW,
+			PROBATION,
+			PROTECTED
+		};
+
+		struct Entry
+		{
+			std::string key;  // Cesta resource, u varianty navic kodovani
+			ETag etag;
+			std::shared_ptr<const std::string> data;
+			uint64_t hash;
+			Segment segment;
+		};
+
+		using EntryList = std::list<Entry>;
+
+		struct SpilledVariant
+		{
+			ETag etag;
+			std::string file_name;  // V COMPRESSED_FILES_DIR
+			uint64_t size = 0;
+		};
+
+		// Odhad cetnosti pristupu (count-min sketch se 4bitovymi citaci, po sample_size_ pristupech se citace puli)
+		class FrequencySketch
+		{
+			public:
+				void resize(const size_t counters);
+				void clear();
+				void increment(const uint64_t hash);
+				uint32_t frequency(const uint64_t hash) const;
+
+			private:
+				size_t counterIndex(const uint64_t hash, const size_t row) const;
+
+			private:
+				std::vector<uint64_t> table_;  // 16 citacu v kazdem slove
+				size_t mask_ = 0;
+				uint64_t sample_size_ = 0;
+				uint64_t additions_ = 0;
+		};
+
+	private:
+		FileCache() = default;
+
+		std::shared_ptr<const std::string> find(const std::string& key, const ETag& etag);
+		std::shared_ptr<const std::string> insert(const std::string& key, const ETag& etag, const uint64_t hash, std::shared_ptr<const std::string> data);
+		void eraseKey(const std::string& key);
+		void removeSpilledVariants();
+		void hit(EntryList::iterator entry);
+		void evictFromWindow();
+		void admit(EntryList::iterator candidate);
+		void remove(EntryList::iterator entry, const bool eviction);
+		EntryList& segmentList(const Segment segment);
+		uint64_t& segmentSize(const Segment segment);
+		static uint64_t entrySize(const Entry& entry);
+		static std::shared_ptr<const std::string> readResource(const Config::RParams& rparam);
+		static std::shared_ptr<const std::string> readResource(const std::string& resource_path, const ETag& etag);  // nullptr i pri jine verzi
+		static std::string variantKey(const std::string& resource_path, const char* encoding);
+		static bool writeVariant(const std::string& file_name, const std::string& data);
+		static void removeVariantFile(const std::string& file_name);
+
+	private:
+		std::mutex mutex_;
+		uint64_t max_size_ = 0;
+		uint64_t max_file_size_ = 0;
+		uint64_t compressed_max_file_size_ = 0;
+		uint64_t window_max_size_ = 0;
+		uint64_t protected_max_size_ = 0;
+
+		EntryList window_;
+		EntryList probation_;
+		EntryList protected_;
+		uint64_t window_size_ = 0;
+		uint64_t probation_size_ = 0;
+		uint64_t protected_size_ = 0;
+		std::unordered_map<std::string, EntryList::iterator> entries_;
+		FrequencySketch sketch_;
+		Stats stats_;
+
+		std::unordered_map<std::string, SpilledVariant> spilled_;
+		std::unordered_set<std::string> compressing_;  // Varianty, jejichz vytvoreni uz je naplanovane nebo probiha
+		uint64_t spilled_counter_ = 0;  // Jmena souboru variant
+
+		static FileCache obj_;
+};
+
+
+#endif
@@ -7,6 +7,8 @@
 #define RESOURCES_CONFIG_FILE_FPATH                             CONFIG_FILES_DIR "/resources.conf"
 #define RESOURCES_DIR					                        "/var/WebServerd"
 #define TEMPORARY_FILES_DIR                                     RESOURCES_DIR "/.tmpfiles"
+#define COMPRESSED_FILES_REL_DIR                                ".tmpfiles/compressed"  // Relativne k RESOURCES_DIR
+#define COMPRESSED_FILES_DIR                                    RESOURCES_DIR "/" COMPRESSED_FILES_REL_DIR
 #define DEFAULTS_DIR                                            "defaults/"
 
 #define BAD_REQUEST_WEB_PAGE     				                DEFAULTS_DIR "bad_request.html"
@@ -20,6 +22,7 @@
 #define HTTP_VERSION_NOT_SUPPORTED_ERROR_WEB_PAGE               DEFAULTS_DIR "http_version_not_supported.html"
 #define SERVICE_UNAVAILABLE_WEB_PAGE                            DEFAULTS_DIR "service_unavailable.html"
 #define UNSUPPORTED_MEDIA_TYPE_WEB_PAGE                         DEFAULTS_DIR "unsupported_media_type.html"
+#define STATUS_PAGES_COUNT                                      11  // Pocet status pages vyse (drzi se v pameti)
 
 
 #endif
@@ -28,7 +28,7 @@ class Http
         virtual void reset();
         virtual void handleConnection() = 0;
         virtual bool sendResponse(HttpPacketBase& packetb) = 0;
-        virtual int receiveRequest() = 0;
+        virtual int receiveRequest() = 0;  // 1 -> OK, 0 -> klient se odpojil, -1 -> chyba (odpoved je pripravena), 2 -> ceka se na diskove operace nebo dalsi cast tela (obsluha se spusti znovu)
         bool endConnection();
         bool isConnected() const { return tcp_server_->isConnected(tcp_connection_); }
         HttpVersion httpVersion() const { return http_version_; }
@@ -3,7 +3,7 @@
 #include "Http.hpp"
 #include "HttpPacketBuilder.hpp"
 #include "Configuration.hpp"
-#include "request.h"
+#include "HttpRequestParser.hpp"
 #include <sys/stat.h>
 
 
@@ -12,9 +12,8 @@ class Http1_0 : public Http
     public:
         Http1_0(const std::shared_ptr<TcpServer>& tcp_server, std::shared_ptr<TcpServer::Connection>& connection);
         virtual ~Http1_0() = default;
-        static void moveHttpRequest(httpparser::Request& req, const httpparser::Request& req2);
-        static void resetHttpRequest(httpparser::Request& req);
 
+        void setRequest(std::string&& request_header, HttpRequestParser&& parser);  // Hlavicka prvniho requestu (prijata pri urceni verze HTTP)
         void reset() override;
         void handleConnection() override;
         bool sendResponse(HttpPacketBase& packetb) override;
@@ -22,6 +21,7 @@ class Http1_0 : public Http
 
     protected:
         int sendFileChunk(const uint64_t offset, const int file_fd, const uint32_t chunk_size);
+        int sendFileData(const int file_fd, const uint64_t offset, const uint64_t size);
         bool compressDataToSend(std::string& dec_data, const void* data, const size_t data_size);
 
         bool requestGetMethod() override;
@@ -36,30 +36,45 @@ class Http1_0 : public Http
         bool requestDeleteMethod() override;
         bool requestDeleteMethodFunc();
 
-        bool getHeaderField(const char* field_name);
+        bool getHeaderField(const HttpHeaderField field);
         int headersAcceptEncoding();
+        bool useCompressedVariant(const HttpContentEncoding encoding);
+        void setEncodedETag(const HttpContentEncoding encoding, const bool weak);  // Misto ETag identity dat
+        ETag negotiatedETag();  // ETag reprezentace podle Accept-Encoding (pro 304)
         int headersIfModifiedSince();
         int headersContentLength(uint64_t* content_length = nullptr);
         int headersContentType();
         int headersContentEncoding();
 
+        bool offloadStorage(TcpServer::Task&& task);  // true -> obsluha se musi vratit, false -> task uz probehl
+        bool resumeStorage();
+        bool resumeRequestBody();
+
         bool checkResourceConstraints() override;
-        void removeRequestDataHeaders();
+        void classifyRequest();
         int receiveRequestBody();
         int receiveRequestBodyPutMethod();
+        int receiveRequestBodyPutData();
         int receiveRequestBodyPostMethod();
         int receiveRetCheck(const int ret, const int temporary_file_fd);
         bool checkRequest();
         bool prepareRequestUri();
 
     protected:
+        std::string request_header_;  // Hlavicka requestu, do ktere ukazuji pohledy parser_
+        HttpRequestParser parser_;
         std::string request_data_;  /// TODO: Mozna primo presunou do tridy Http
-        httpparser::Request request_;
         HttpPacketBuilder packet_builder_;
         HttpPacketBuilder packet_builder_sp_;   // Status page packet builder
-        std::vector<httpparser::Request::HeaderItem>::const_iterator header_field_;
+        const HttpRequestParser::Header* header_field_ = nullptr;
         std::string boundary_;
         std::string file_name_;
+        bool storage_offloaded_ = false;  // Odpoved je pripravena az po diskovych operacich ve vlakne pro diskove operace
+        // Prijem tela PUT requestu (pokud data jeste neprisla, pokracuje az pri dalsim spusteni obsluhy)
+        bool body_suspended_ = false;
+        uint64_t body_length_ = 0;
+        uint64_t body_received_ = 0;
+        int body_file_fd_ = -1;  // Docasny soubor pro telo vetsi nez buffer
 };
 
 
@@ -34,23 +34,8 @@ class Http1_1 : public Http1_0
         bool sendResponseRanges();
 
     private:
-        enum class RangeType
-        {
-            START_END,
-            START_INF,
-            SUFFIX_LENGTH,
-            INVALID
-        };
-
-        struct Range
-        {
-            uint64_t start = 0;
-            uint64_t end = 0;
-            RangeType type = RangeType::INVALID;
-        };
-
-    private:
-        std::vector<Range> ranges_;
+        std::vector<HttpRange> ranges_;  // Po headersRange(true) serazene a spojene (START_END)
+        std::vector<std::string> range_parts_;  // Oddelovace casti multipart/byteranges (prazdne -> jeden rozsah)
 };
 
 #endif
\ No newline at end of file
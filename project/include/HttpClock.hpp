@@ -0,0 +1,21 @@
+#ifndef __HTTP_CLOCK_HPP__
+#define __HTTP_CLOCK_HPP__
+#include "HttpGlobal.hpp"
+#include <time.h>
+
+
+// Datum ve formatu HTTP (IMF-fixdate) pro hlavicky odpovedi, sdilene vsemi vlakny
+// Aktualni datum se formatuje nejvyse jednou za sekundu (prvni vlakno v nove sekunde), ostatni ho jen kopiruji
+namespace HttpClock
+{
+	using Date = char[HTTP_DATE_SIZE + 1];
+
+	// Aktualni cas (v sekundach) a jeho datum
+	time_t now(Date& date);
+
+	// Datum libovolneho casu bez gmtime()/strftime() (false -> rok mimo 0 - 9999)
+	bool format(const time_t t, Date& date);
+}
+
+
+#endif
@@ -2,9 +2,10 @@
 #define __HTTP_GLOBAL_HPP__
 #include "HttpGlobal2.hpp"
 #include "Globals.hpp"
-#include "request.h"
 #include <map>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <inttypes.h>
 
 extern const std::string DEFAULT_WEB_PAGE;
@@ -26,12 +27,6 @@ extern const std::string HTTP_METHOD_OPTIONS;
 
 extern const std::string HTTP_ALL_SUPPORTED_METHODS;
 
-// Jeste mozna match pro query string a port (:[0-9]{1,4})?(\\?([A-Za-z0-9_\\-]=*&)+)
-#define REQUEST_LINE_PATTERN_PART1	"^(GET|POST|PUT|DELETE|HEAD|OPTIONS)$"
-#define REQUEST_LINE_PATTERN_PART2	"^((\\*)|((/|http://|https://)?([A-Za-z0-9.-]|[/~:@?&=#%+!,;$*()\\[\\]])+))$"
-#define REQUEST_LINE_PATTERN_PART3	"^(HTTP/(1\\.0|1\\.1))$"
-#define REQUEST_LINE_PATTERN_COUNT	3
-
 #define HTTP_ASTERISK	"*"
 
 #define HEADERS_ENDLINE	"\r\n"
@@ -41,13 +36,11 @@ extern const std::string HTTP_ALL_SUPPORTED_METHODS;
 #define TEMPORARY_FILE_NAME_FORMAT	(TEMPORARY_FILES_DIR "/%d/%" PRIu32)
 
 #define HTTP_DATE_FORMAT	"%a, %d %b %Y %H:%M:%S GMT"
+#define HTTP_DATE_SIZE	29  // IMF-fixdate ma vzdy stejnou delku
 
 #define HTTP_CONTENT_NEGOTIATION_FIELDS		"Accept-Encoding"
 
-#define HTTP_RANGE_HEADER_REGEX_PATTERN		"^bytes=(-[0-9]+|[0-9]+-[0-9]*)(,[[:space:]](-[0-9]+|[0-9]+-[0-9]*))*$"
-
-//#define HTTP_CONTENT_DISPOSITION_PATTERN_NAME 	"^Content-Disposition:\\s*form-data;\\s*name=\"([^\"]+)\"\\s*;\\s*$"
-#define HTTP_CONTENT_DISPOSITION_PATTERN_FILENAME	"^Content-Disposition:\\s*form-data;\\s*name=\"([^\"]+)\"\\s*;\\s*filename=\"([^\"]+)\"$"
+#define HTTP_RANGES_MAX	64  // Range s vice rozsahy se ignoruje (posle se cely resource)
 
 
 enum class HttpContentType
@@ -147,6 +140,7 @@ enum class HttpVersion
 
 const std::string& httpVersion(const HttpVersion version);
 HttpVersion httpVersionStr(const std::string& version);
+HttpVersion httpVersionNum(const uint8_t major, const uint8_t minor);
 
 
 enum class HttpMethod
@@ -161,7 +155,7 @@ enum class HttpMethod
 	NOT_ALLOWED
 };
 
-HttpMethod httpMethod(const std::string& method, const HttpVersion& version);
+HttpMethod httpMethod(const std::string_view method, const HttpVersion& version);
 bool httpIsStateChangingMethod(const HttpMethod method);
 
 
@@ -175,13 +169,39 @@ enum class HttpContentEncoding
 
 extern const std::map<std::string, HttpContentEncoding> content_encodings;
 const std::pair<const std::string, HttpContentEncoding>* 
-	httpContentEncoding(const std::string& encodings, const bool accept_encoding);
+	httpContentEncoding(const std::string_view encodings, const bool accept_encoding);
+
+// ETag kodovane reprezentace: identity ETag s priponou kodovani uvnitr uvozovek ("123-gz"), weak -> W/"123-gz"
+// (kodovana data nesmi mit validator identity dat, jinak by If-Range navazal stahovani identity byty)
+ETag httpEncodedETag(const ETag& etag, const HttpContentEncoding encoding, const bool weak);
+// Shoda ETag z If-Match / If-None-Match s aktualni verzi resource v libovolnem kodovani
+// (weak = true -> slabe porovnani, W/ se ignoruje, jinak W/ ETag nikdy neodpovida)
+bool httpETagMatches(std::string_view tag, const ETag& etag, const bool weak);
+
+
+enum class HttpRangeType
+{
+	START_END,		// bytes=a-b
+	START_INF,		// bytes=a-
+	SUFFIX_LENGTH	// bytes=-n (poslednich n bytu)
+};
+
+struct HttpRange
+{
+	uint64_t start = 0;
+	uint64_t end = 0;  // U SUFFIX_LENGTH pocet bytu
+	HttpRangeType type = HttpRangeType::START_END;
+};
 
-int httpCheckRangeHeader(const std::string& ranges);
+// Hodnota hlavicky Range -> rozsahy v poradi z hlavicky (ranges == nullptr -> jen kontrola syntaxe)
+// Cisla mimo uint64_t se saturuji (rozsah pak neprojde kontrolou velikosti zdroje)
+bool httpParseRangeHeader(const std::string_view value, std::vector<HttpRange>* ranges);
 
-bool httpParseRequest(const std::string& request_data, httpparser::Request& request);
-int httpCheckRequestLine(const std::string& request_data);
+// Rozsahy -> START_END v ramci resource, serazene, prekryvajici se a sousedni spojene, nesplnitelne vynechane
+// (prazdny vysledek -> zadny rozsah nelze splnit, false -> rozsah s start > end)
+bool httpCoalesceRanges(std::vector<HttpRange>& ranges, const uint64_t resource_size);
 
-int httpCheckContentDisposition(const std::string& content_disp);
+// Radek Content-Disposition casti multipart/form-data -> name a filename (pohledy do content_disp)
+bool httpParseContentDisposition(const std::string_view content_disp, std::string_view& name, std::string_view& filename);
 
 #endif
@@ -4,6 +4,7 @@
 #include "HttpGlobal.hpp"
 #include <string>
 #include <cstdint>
+#include <memory>
 
 
 class HttpPacket : public HttpPacketBase
@@ -37,6 +38,8 @@ class HttpPacket : public HttpPacketBase
                 void expires(const std::string& exp) { expires(exp.c_str()); }
                 void lastModified(const char* last_modified);
                 void location(const std::string& rel_path);
+                void fields(const std::string& fields);  // Predpripravene header fields (kazde zakoncene CRLF)
+                void patch(const size_t pos, const char* value, const size_t size);  // Prepise cast uz pridanych fields
                 void end();
 
                 // Od verze Http/1.1
@@ -50,8 +53,10 @@ class HttpPacket : public HttpPacketBase
                 void transferEncoding(const std::string& transfer_encoding);
 
                 // Dalsi metody
+                void removeContentType();
                 void removeContentLength();
                 void removeContentRange();
+                void removeEtag();
                 void removeEnd();
 
             private:
@@ -71,13 +76,18 @@ class HttpPacket : public HttpPacketBase
                     bool is_file_ = false;
                     std::string data_;  // Pokud je is_file_ = false, tak jsou zde ulozena ciste data, jinak je zde ulozen nazev souboru s daty
                     uint64_t content_length_ = 0;
+                    int file_fd_ = -1;  // Uz otevreny soubor (deskriptor vlastni RParams, plati jen dokud je resource zamceny)
+                    std::shared_ptr<const std::string> shared_data_;  // Data sdilena vice odpovedmi (status pages), maji prednost pred data_
+
+                    const std::string& memoryData() const { return (shared_data_) ? *shared_data_ : data_; }
                 };
 
             public:
                 void reset();
                 bool addData(const std::string& data);
                 bool addData(std::string&& data);
-                bool addFile(const std::string& rel_path, const uint64_t file_size);
+                bool addData(std::shared_ptr<const std::string> data);  // Bez kopirovani dat
+                bool addFile(const std::string& rel_path, const uint64_t file_size, const int file_fd = -1);
 
                 const Data& data() const { return data_; }
 
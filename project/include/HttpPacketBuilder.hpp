@@ -20,14 +20,14 @@ class HttpPacketBuilder : public HttpPacketBuilderBase
         void buildNoContent();
         void buildNoContent(const Config::RParams* rparam);
         void buildCreated(const Config::RParams* rparam);
-        void buildBadRequest();
+        void buildBadRequest(const bool keep_alive = true);
         void buildHttpVersionNotSupported();
         void buildNotFound();
         void buildMethodNotAllowed(const Config::RParams* rparam);
         void buildNotAcceptable();
         void buildForbidden();
         void buildLengthRequired();
-        void buildContentTooLarge();
+        void buildContentTooLarge(const bool keep_alive = true);
         void buildInternalServerError();
         void buildNotImplemented();
         void buildServiceUnavailable();
@@ -37,8 +37,19 @@ class HttpPacketBuilder : public HttpPacketBuilderBase
         void buildContinue();
         void buildExpectationFailed();
         void buildNotModified(const Config::RParams* rparam);
+        void buildNotModified(const Config::RParams* rparam, const ETag& etag);  // ETag kodovane reprezentace
+        // 206 pro rozsahy z httpCoalesceRanges() (vice rozsahu -> multipart/byteranges, parts -> oddelovace casti a zakonceni)
+        void buildPartialContent(const Config::RParams* rparam, const std::vector<HttpRange>& ranges, 
+            std::vector<std::string>& parts);
         void buildServerOptions();
 
+        // Header fields zavisle jen na resource (nullptr -> resource nelze odeslat, hlavicky se sestavi pri odeslani)
+        static std::shared_ptr<const Config::RParams::HeaderTemplate> buildHeaderTemplate(const Config::RParams& rparam, 
+            const HttpVersion http_version);
+        // Status page nactena do pameti s predpripravenymi hlavickami (nullptr -> soubor nelze nacist)
+        static std::shared_ptr<const Config::StatusPage> loadStatusPage(const HttpStatusCode status_code, 
+            const std::string& resource_path);
+
         void setEndHeaders(const bool end_headers) { end_headers_ = end_headers; }
         void setHttpVersion(const HttpVersion ver) { packet_.header().setHttpVersion(ver); }
         HttpPacket& packet() { return packet_; }
@@ -46,6 +57,8 @@ class HttpPacketBuilder : public HttpPacketBuilderBase
 
     private:
         Config::RParams* getStatPageRParams(const std::string& status_page) { return &Config::rparams("/" + status_page, true); }
+        bool createStatusPage(const HttpStatusCode status_code, const bool keep_alive);  // Z pameti (false -> neni nactena)
+        void buildStatusPage(const std::string& status_page, const HttpStatusCode status_code, const bool keep_alive = true);
 
     private:
         bool end_headers_ = true;
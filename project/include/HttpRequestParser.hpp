@@ -0,0 +1,124 @@
+#ifndef __HTTP_REQUEST_PARSER_HPP__
+#define __HTTP_REQUEST_PARSER_HPP__
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+
+// Header fieldy, ktere obsluha requestu cte (parser je rozpozna pri parsovani -> vyhledani bez prochazeni)
+enum class HttpHeaderField : uint8_t
+{
+	ACCEPT_ENCODING,
+	CONTENT_ENCODING,
+	CONTENT_LENGTH,
+	CONTENT_TYPE,
+	EXPECT,
+	IF_MATCH,
+	IF_MODIFIED_SINCE,
+	IF_NONE_MATCH,
+	IF_RANGE,
+	IF_UNMODIFIED_SINCE,
+	RANGE,
+	TRANSFER_ENCODING,
+	UNKNOWN
+};
+
+
+// Inkrementalni parser hlavicky HTTP/1.x requestu (request line a header fields)
+// Parsuje primo prijata data bez kopirovani, dalsi volani pokracuje od mista, kde predchozi skoncilo
+// (buffer mezi volanimi muze narust i presunout se -> stav se drzi jako pozice, ne ukazatele)
+class HttpRequestParser
+{
+	public:
+		struct Header
+		{
+			std::string_view name;
+			std::string_view value;  // Bez okolnich OWS, po bind() je za hodnotou '\0'
+		};
+
+		// Pohledy do bufferu s hlavickou -> plati jen dokud buffer existuje a nemeni se
+		struct Request
+		{
+			std::string_view method;
+			std::string_view uri;
+			uint8_t version_major = 0;
+			uint8_t version_minor = 0;
+			std::vector<Header> headers;
+			std::array<uint32_t, static_cast<size_t>(HttpHeaderField::UNKNOWN)> known_headers{};  // Index + 1 prvniho vyskytu, 0 -> chybi
+			uint64_t content_length = 0;  // Hodnota Content-Length (kontroluje parser, jinak request nelze ohranicit)
+
+			const Header* header(const HttpHeaderField field) const
+			{
+				const uint32_t index = known_headers[static_cast<size_t>(field)];
+				return ((index != 0) ? &headers[index - 1] : nullptr);
+			}
+		};
+
+		enum class Result
+		{
+			COMPLETED,
+			INCOMPLETE,
+			ERROR
+		};
+
+		static HttpHeaderField headerField(const std::string_view name);
+
+		Result parse(const std::string_view data);  // data = vse prijate od zacatku requestu (muze obsahovat i telo)
+		void bind(std::string& data);  // Hlavicka se presunula do data -> presmerovat pohledy, hodnoty zakoncit '\0'
+		void reset();
+		bool isStarted() const { return (state_ != State::REQUEST_LINE_START || pos_ != 0); }
+		bool isCompleted() const { return (state_ == State::DONE); }
+		size_t headerSize() const { return ((state_ == State::DONE) ? pos_ : 0); }  // Vcetne prazdneho radku
+		const Request& request() const { return request_; }
+
+	private:
+		enum class State : uint8_t
+		{
+			REQUEST_LINE_START,  // Pred request line mohou byt prazdne radky
+			METHOD,
+			URI,
+			VERSION,
+			REQUEST_LINE_LF,
+			HEADER_START,  // Zacatek radku -> nazev pole nebo konec hlavicky
+			HEADER_NAME,
+			VALUE_START,
+			VALUE,
+			HEADER_LF,
+			END_LF,
+			DONE,
+			ERROR
+		};
+
+		struct Span
+		{
+			size_t offset = 0;
+			size_t size = 0;
+		};
+
+		struct HeaderSpan
+		{
+			Span name;
+			Span value;
+		};
+
+		Result fail();
+		bool parseVersion(const char* version, const size_t size);
+		bool parseContentLength(const char* value, const size_t size);
+		void materialize(const char* data);
+
+	private:
+		State state_ = State::REQUEST_LINE_START;
+		size_t pos_ = 0;  // Dalsi neprectany znak
+		size_t token_ = 0;  // Zacatek prave parsovaneho tokenu
+		HttpHeaderField field_ = HttpHeaderField::UNKNOWN;  // Prave parsovany header field
+		Span method_;
+		Span uri_;
+		std::vector<HeaderSpan> headers_;
+		Request request_;
+};
+
+
+#endif
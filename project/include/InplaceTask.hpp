@@ -0,0 +1,141 @@
+#ifndef __INPLACE_TASK_HPP__
+#define __INPLACE_TASK_HPP__
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+// Presouvatelna (ne kopirovatelna) obdoba std::function<void()>
+// Mala volatelna data se ukladaji primo v objektu -> bez alokace na heapu
+// (56 B pojme obsluhu spojeni z WebServer::createSession [this, 3x shared_ptr], objekt ma stale 64 B)
+class InplaceTask
+{
+	public:
+		static constexpr size_t INLINE_SIZE = 56;
+
+		InplaceTask() = default;
+		template <typename Func, typename = typename std::enable_if<
+			!std::is_same<typename std::decay<Func>::type, InplaceTask>::value>::type>
+		InplaceTask(Func&& func);
+		InplaceTask(const InplaceTask& obj) = delete;
+		InplaceTask(InplaceTask&& obj) noexcept;
+		~InplaceTask();
+
+		InplaceTask& operator=(const InplaceTask& obj) = delete;
+		InplaceTask& operator=(InplaceTask&& obj) noexcept;
+
+		void operator()() { ops_->invoke(storage_); }
+		explicit operator bool() const { return (ops_ != nullptr); }
+		void reset();
+
+	private:
+		struct Ops
+		{
+			void (*invoke)(void* storage);
+			void (*move)(void* dst, void* src);  // Presun do neinicializovaneho dst, src se znici
+			void (*destroy)(void* storage);
+		};
+
+		// Vejde se do objektu -> primo v storage_, jinak ukazatel na kopii na heapu
+		template <typename F>
+		static constexpr bool fitsInline()
+		{
+			return (sizeof(F) <= INLINE_SIZE && alignof(F) <= alignof(std::max_align_t) &&
+					std::is_nothrow_move_constructible<F>::value);
+		}
+
+		template <typename F>
+		static const Ops* inlineOps();
+		template <typename F>
+		static const Ops* heapOps();
+
+	private:
+		alignas(std::max_align_t) unsigned char storage_[INLINE_SIZE];
+		const Ops* ops_ = nullptr;
+};
+
+
+template <typename Func, typename>
+inline InplaceTask::InplaceTask(Func&& func)
+{
+	using F = typename std::decay<Func>::type;
+	if constexpr (fitsInline<F>())
+	{
+		new (storage_) F(std::forward<Func>(func));
+		ops_ = inlineOps<F>();
+	}
+	else
+	{
+		*reinterpret_cast<F**>(storage_) = new F(std::forward<Func>(func));
+		ops_ = heapOps<F>();
+	}
+}
+
+inline InplaceTask::InplaceTask(InplaceTask&& obj) noexcept :
+	ops_(obj.ops_)
+{
+	if (ops_)
+	{
+		ops_->move(storage_, obj.storage_);
+		obj.ops_ = nullptr;
+	}
+}
+
+inline InplaceTask::~InplaceTask()
+{
+	reset();
+}
+
+inline InplaceTask& InplaceTask::operator=(InplaceTask&& obj) noexcept
+{
+	if (this != &obj)
+	{
+		reset();
+		ops_ = obj.ops_;
+		if (ops_)
+		{
+			ops_->move(storage_, obj.storage_);
+			obj.ops_ = nullptr;
+		}
+	}
+	return *this;
+}
+
+inline void InplaceTask::reset()
+{
+	if (ops_)
+	{
+		ops_->destroy(storage_);
+		ops_ = nullptr;
+	}
+}
+
+template <typename F>
+inline const InplaceTask::Ops* InplaceTask::inlineOps()
+{
+	static const Ops ops = {
+		[](void* storage) { (*static_cast<F*>(storage))(); },
+		[](void* dst, void* src)
+		{
+			new (dst) F(std::move(*static_cast<F*>(src)));
+			static_cast<F*>(src)->~F();
+		},
+		[](void* storage) { static_cast<F*>(storage)->~F(); }
+	};
+	return &ops;
+}
+
+template <typename F>
+inline const InplaceTask::Ops* InplaceTask::heapOps()
+{
+	static const Ops ops = {
+		[](void* storage) { (**static_cast<F**>(storage))(); },
+		[](void* dst, void* src) { *static_cast<F**>(dst) = *static_cast<F**>(src); },
+		[](void* storage) { delete *static_cast<F**>(storage); }
+	};
+	return &ops;
+}
+
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef __IO_URING_HPP__
+#define __IO_URING_HPP__
+#ifdef WEBSERVER_IO_URING
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+
+
+// Tenka obalka nad io_uring syscally (bez liburing)
+// Submission queue muze plnit vice vlaken (pod submitMutex()), completion queue cte jen jedno vlakno
+class IoUring
+{
+	public:
+		IoUring() = default;
+		IoUring(const IoUring& obj) = delete;
+		IoUring(IoUring&& obj) = delete;
+		~IoUring();
+
+		IoUring& operator=(const IoUring& obj) = delete;
+		IoUring& operator=(IoUring&& obj) = delete;
+
+		bool init(const uint32_t entries);
+		void release();
+		bool isInitialized() const { return (ring_fd_ != -1); }
+
+		// Volat jen s uzamcenym submitMutex()
+		std::mutex& submitMutex() { return submit_mutex_; }
+		io_uring_sqe* getSqe();
+		uint32_t sqSpace() const;
+		int submit();
+
+		// Vektorovy send bez cekani na misto v socketu (msg musi platit az do CQE)
+		// CQE nese presny pocet odeslanych bytu i pri castecnem zapisu, -EAGAIN jen kdyz se neodeslalo nic
+		static void prepareSendMsg(io_uring_sqe* sqe, const int fd, const msghdr* msg);
+
+		// Volat jen z vlakna, ktere zpracovava completion queue
+		int waitCqe(const int timeout_ms);
+		io_uring_cqe* peekCqe();
+		void seenCqe();
+
+		// Provided buffers pro recv (buffer si kernel vybira sam)
+		bool initBuffers(const uint16_t group, const uint16_t count, const uint32_t size);
+		const char* buffer(const uint16_t id) const { return buffers_ + (static_cast<size_t>(id) * buffer_size_); }
+		void recycleBuffer(const uint16_t id);
+
+	private:
+		int ring_fd_ = -1;
+		std::mutex submit_mutex_;
+
+		void* sq_ptr_ = nullptr;
+		size_t sq_size_ = 0;
+		void* cq_ptr_ = nullptr;
+		size_t cq_size_ = 0;
+		io_uring_sqe* sqes_ = nullptr;
+		size_t sqes_size_ = 0;
+
+		uint32_t* sq_head_ = nullptr;
+		uint32_t* sq_tail_ = nullptr;
+		uint32_t* sq_array_ = nullptr;
+		uint32_t sq_mask_ = 0;
+		uint32_t sq_entries_ = 0;
+		uint32_t sqe_tail_ = 0;  // SQE pripravene, ale jeste neodeslane kernelu
+
+		uint32_t* cq_head_ = nullptr;
+		uint32_t* cq_tail_ = nullptr;
+		uint32_t cq_mask_ = 0;
+		io_uring_cqe* cqes_ = nullptr;
+
+		io_uring_buf_ring* buf_ring_ = nullptr;
+		size_t buf_ring_size_ = 0;
+		char* buffers_ = nullptr;
+		uint32_t buffer_size_ = 0;
+		uint16_t buffer_count_ = 0;
+		uint16_t buffer_group_ = 0;
+		uint16_t buf_tail_ = 0;
+};
+
+
+#endif
+#endif
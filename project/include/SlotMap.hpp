@@ -0,0 +1,130 @@
+#ifndef __SLOT_MAP_HPP__
+#define __SLOT_MAP_HPP__
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+
+// Tabulka s O(1) vlozenim, odebranim a vyhledanim podle handle
+// Handle = generace slotu (horni 32 bitu) + index slotu, po odebrani se generace zvysi -> stary handle uz nic nenajde
+template <typename T>
+class SlotMap
+{
+	public:
+		using Handle = uint64_t;
+		static constexpr Handle INVALID_HANDLE = 0;  // Generace zacina od 1 -> platny handle neni nikdy 0
+
+		SlotMap() = default;
+		SlotMap(const SlotMap& obj) = delete;
+		SlotMap(SlotMap&& obj) = delete;
+		~SlotMap() = default;
+
+		SlotMap& operator=(const SlotMap& obj) = delete;
+		SlotMap& operator=(SlotMap&& obj) = delete;
+
+		Handle insert(T value);
+		bool erase(const Handle handle);
+		T* find(const Handle handle);
+		void clear();
+		size_t size() const { return size_; }
+		bool empty() const { return (size_ == 0); }
+
+		template <typename Func>
+		void forEach(Func func);
+
+	private:
+		struct Slot
+		{
+			T value;
+			uint32_t generation = 1;
+			bool used = false;
+		};
+
+		static uint32_t index(const Handle handle) { return static_cast<uint32_t>(handle); }
+		static uint32_t generation(const Handle handle) { return static_cast<uint32_t>(handle >> 32); }
+
+	private:
+		std::vector<Slot> slots_;
+		std::vector<uint32_t> free_;  // Indexy volnych slotu
+		size_t size_ = 0;
+};
+
+
+template <typename T>
+inline typename SlotMap<T>::Handle SlotMap<T>::insert(T value)
+{
+	uint32_t i;
+	if (!free_.empty())
+	{
+		i = free_.back();
+		free_.pop_back();
+	}
+	else
+	{
+		i = static_cast<uint32_t>(slots_.size());
+		slots_.emplace_back();
+	}
+
+	Slot& slot = slots_[i];
+	slot.value = std::move(value);
+	slot.used = true;
+	++size_;
+
+	return ((static_cast<Handle>(slot.generation) << 32) | i);
+}
+
+template <typename T>
+inline bool SlotMap<T>::erase(const Handle handle)
+{
+	if (find(handle) == nullptr) {
+		return false;
+	}
+
+	Slot& slot = slots_[index(handle)];
+	slot.value = T();
+	slot.used = false;
+	// Generace 0 je vyhrazena pro INVALID_HANDLE
+	if (++slot.generation == 0) {
+		slot.generation = 1;
+	}
+	free_.push_back(index(handle));
+	--size_;
+
+	return true;
+}
+
+template <typename T>
+inline T* SlotMap<T>::find(const Handle handle)
+{
+	const uint32_t i = index(handle);
+	if (i >= slots_.size()) {
+		return nullptr;
+	}
+
+	Slot& slot = slots_[i];
+	return ((slot.used && slot.generation == generation(handle)) ? &slot.value : nullptr);
+}
+
+template <typename T>
+inline void SlotMap<T>::clear()
+{
+	slots_.clear();
+	free_.clear();
+	size_ = 0;
+}
+
+template <typename T>
+template <typename Func>
+inline void SlotMap<T>::forEach(Func func)
+{
+	for (Slot& slot : slots_)
+	{
+		if (slot.used) {
+			func(slot.value);
+		}
+	}
+}
+
+
+#endif
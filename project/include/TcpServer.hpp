@@ -2,7 +2,10 @@
 #define __TCP_SERVER_HPP__
 #include "ThreadPool.hpp"
 #include "HttpGlobal.hpp"
+#include "HttpRequestParser.hpp"
 #include "SslConfig.hpp"
+#include "SlotMap.hpp"
+#include "TimerWheel.hpp"
 #include <vector>
 #include <deque>
 #include <string>
@@ -10,79 +13,287 @@
 #include <arpa/inet.h>
 #include <ctime>
 #include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <sys/uio.h>
+#ifdef WEBSERVER_IO_URING
+#include "IoUring.hpp"
+#include <condition_variable>
+#include <unordered_set>
+#endif
 
 
 class TcpServer
 {
-	using Task = std::function<void()>;
-
 	public:
+		using Task = InplaceTask;  // Obsluha spojeni se uklada bez alokace na heapu
+
+		enum class NetworkBackend
+		{
+			EPOLL,
+			IO_URING
+		};
+
+		enum class TlsMode
+		{
+			NONE,			// Nesifrovane spojeni
+			USERSPACE,		// Sifrovani v OpenSSL
+			KERNEL_SEND,	// kTLS jen pro odesilani
+			KERNEL			// kTLS pro odesilani i prijem
+		};
+
+		// Poradi je vyznamne -> casovac hlavicky ma prednost pred keep-alive
+		enum class TimeoutKind : uint8_t
+		{
+			KEEPALIVE,		// Necinne spojeni mezi requesty
+			HEADER,			// Prijem hlavicky requestu
+			BODY			// Prijem tela requestu a odesilani odpovedi
+		};
+
+		// Pocty spojeni ukoncenych po vyprseni casu
+		struct TimeoutStats
+		{
+			std::atomic<uint64_t> keepalive{0};
+			std::atomic<uint64_t> header{0};
+			std::atomic<uint64_t> body{0};
+		};
+
 		struct Connection
 		{
 			friend class TcpServer;
-		
+
+			// Cast odpovedi, ktera se nevesla do socketu (data v pameti, nebo usek souboru)
+			struct OutputSegment
+			{
+				std::string data;
+				int file_fd = -1;  // Vlastni kopie deskriptoru souboru (-1 -> data v pameti)
+				uint64_t offset = 0;  // Offset v souboru, u dat v pameti uz odeslano
+				uint64_t size = 0;  // Zbyva odeslat ze souboru
+				bool spilled = false;  // Usek docasneho souboru spojeni (data odpovedi nad limit pameti)
+			};
+
 			public:
 				Connection() = default;
-				Connection(const Connection& obj) = default;
-				Connection(Connection&& obj) = default;
-				Connection& operator=(const Connection& obj) = default;
-				Connection& operator=(Connection&& obj) = default;
+				Connection(const Connection& obj) = delete;
+				Connection(Connection&& obj) = delete;
+				Connection& operator=(const Connection& obj) = delete;
+				Connection& operator=(Connection&& obj) = delete;
 				~Connection();
 
 				int getSocket() const { return socket_; }
 				bool hasSocket() const { return (socket_ != -1); }
 				bool hasSsl() const { return (ssl_ != nullptr); }
+				bool isSecure() const { return secure_; }
 				void setSsl(SSL* ssl) { ssl_ = ssl; }
+				TlsMode tlsMode() const { return tls_mode_; }
 
 			private:
 				int socket_ = -1;
+				uint64_t slot_ = 0;  // Handle spojeni v tabulce spojeni serveru
 				SSL* ssl_ = nullptr;
+				SSL* handshake_ = nullptr;  // TLS behem handshake (do ssl_ se presune az po jeho dokonceni)
+				bool secure_ = false;  // Spojeni prijate na HTTPS socketu
+				TlsMode tls_mode_ = TlsMode::NONE;
+				TimerWheel::Handle timer_ = 0;  // Casovac necinnosti spojeni v event loopu (0 -> zadny), chrani timer_mutex_ serveru
+				TimeoutKind timer_kind_ = TimeoutKind::KEEPALIVE;
+				std::chrono::steady_clock::time_point header_deadline_;  // Konec casu na hlavicku od jejiho zacatku v event loopu (prevezme ho obsluha)
+				std::atomic<bool> dispatched_{false};  // Spojeni je prave zpracovavano nekterym vlaknem
+				std::atomic<bool> parked_{false};  // Obsluha skoncila, ale odpoved ceka na misto v socketu (spojeni zustava dispatched_)
+				std::atomic<bool> awaiting_input_{false};  // Obsluha ceka na dalsi cast tela requestu v event loopu (spojeni zustava dispatched_)
+				size_t input_wanted_ = 0;  // Kolik dat musi byt v recv_buffer_, nez se obsluha spusti znovu
+				bool input_expired_ = false;  // Behem cekani na telo vyprsel cas -> prijem obsluhy skonci chybou
+				ThreadPool::TaskPriority priority_ = ThreadPool::TaskPriority::INTERACTIVE;  // Trida aktualniho requestu (urci obsluha)
+				Task task_;  // Obsluha spojeni, spoustena vzdy kdyz je v socketu cely request
+				// Prijata data, ktera jeste nevyzvedla obsluha spojeni (zbytek za hlavickou, pipelined requesty)
+				std::string recv_buffer_;
+				std::mutex recv_mutex_;
+				HttpRequestParser parser_;  // Hlavicka v recv_buffer_ parsovana event loopem, v parsovani pokracuje obsluha (receiveHeader)
+				// Vystupni fronta, odesila se najednou (writev, plne TLS zaznamy)
+				// iov_base == nullptr -> data jsou zkopirovana v output_buffer_ (v poradi fronty)
+				std::vector<iovec> output_queue_;
+				std::string output_buffer_;
+				// Odlozena cast odpovedi (socket byl plny), odesila se az bude socket zapisovatelny
+				std::deque<OutputSegment> pending_output_;
+				size_t pending_memory_ = 0;  // Velikost dat v pameti v pending_output_
+				int spill_fd_ = -1;  // Docasny soubor pro data odpovedi nad limit pameti (zavira se po odeslani vseho)
+				uint64_t spill_size_ = 0;
+				bool close_pending_ = false;  // Ukoncit spojeni az po odeslani pending_output_
+#ifdef WEBSERVER_IO_URING
+				std::condition_variable recv_cond_;
+				bool recv_eof_ = false;  // Klient ukoncil spojeni, chyba nebo bylo spojeni ukonceno serverem
+				bool recv_paused_ = false;  // Prijem pozastaven, dokud obsluha nevyzvedne prijata data
+				void* recv_request_ = nullptr;  // Zadany multishot recv/poll (kvuli jeho zruseni)
+#endif
 		};
-			
+
 		TcpServer();
 		TcpServer(const TcpServer& obj) = delete;
 		TcpServer(TcpServer&& obj) = delete;
 		~TcpServer() = default;
-		
+
 		TcpServer& operator=(const TcpServer& obj) = delete;
 		TcpServer& operator=(TcpServer&& obj) = delete;
-		
+
 		bool start();
 		bool stop();
 		bool reset();
-		bool set();
+		bool set(const size_t shards = 1);
 		std::shared_ptr<TcpServer::Connection> acceptConnection();
 		std::shared_ptr<TcpServer::Connection> acceptConnectionSsl();
-		bool handleConnection(std::shared_ptr<TcpServer::Connection>& connection, const Task& task);
+		bool initSsl(std::shared_ptr<TcpServer::Connection>& connection, SSL_CTX* ctx);  // Handshake pak provadi event loop
+		bool handshakeSsl(std::shared_ptr<TcpServer::Connection>& connection);  // Dokonceni handshake, ktery event loop nedokoncil
+		bool handleConnection(std::shared_ptr<TcpServer::Connection>& connection, Task&& task);
 		bool endConnection(std::shared_ptr<TcpServer::Connection>& connection);
 		int sendText(const std::shared_ptr<TcpServer::Connection>& connection, const char* data, const size_t size);
 		int sendText(const std::shared_ptr<TcpServer::Connection>& connection, const std::string& data);
-		int receiveText(const std::shared_ptr<TcpServer::Connection>& connection, std::string& data, 
+		void queueText(const std::shared_ptr<TcpServer::Connection>& connection, const char* data, const size_t size, const bool copy);
+		void queueText(const std::shared_ptr<TcpServer::Connection>& connection, const std::string& data, const bool copy);
+		int flushText(const std::shared_ptr<TcpServer::Connection>& connection, const bool more = false);
+		void discardText(const std::shared_ptr<TcpServer::Connection>& connection);
+		int sendFile(const std::shared_ptr<TcpServer::Connection>& connection, const int file_fd, const uint64_t offset, const uint64_t size);
+		bool supportsSendFile(const std::shared_ptr<TcpServer::Connection>& connection) const;
+		int receiveText(const std::shared_ptr<TcpServer::Connection>& connection, std::string& data,
 						const uint64_t max_size_to_recv, const std::string& terminator, const bool peek_data);
-		int receiveText(const std::shared_ptr<TcpServer::Connection>& connection, std::string& data, 
+		int receiveText(const std::shared_ptr<TcpServer::Connection>& connection, std::string& data,
 						const uint64_t bytes_to_recv, const bool peek_data);
+		int receiveHeader(const std::shared_ptr<TcpServer::Connection>& connection, std::string& data,
+						const uint64_t max_size_to_recv, HttpRequestParser& parser);
 		bool isConnected(const std::shared_ptr<TcpServer::Connection>& connection) const;
+		void setPriority(const std::shared_ptr<TcpServer::Connection>& connection, const ThreadPool::TaskPriority priority);
+		bool offloadConnection(const std::shared_ptr<TcpServer::Connection>& connection, Task&& task);  // Diskove operace requestu ve vlakne pro diskove operace, pak znovu obsluha
+		int awaitInput(const std::shared_ptr<TcpServer::Connection>& connection, const size_t size);  // 1 -> data jsou v bufferu, 2 -> obsluha se spusti znovu az prijdou, -1 -> vyprsel cas
+		bool queueBackgroundTask(Task&& task);  // Prace, na kterou neceka zadny klient (napr. vytvoreni komprimovane varianty resource)
 		bool isRunning() const { return run_; }
 		bool isDeactivated() const { return deactivated_; }
-		const std::vector<std::shared_ptr<TcpServer::Connection>>& connections() const { return connections_; }
+		size_t connectionsCount() const;
 		uint32_t maxConnections() const { return max_connections_; }
+		NetworkBackend networkBackend() const { return backend_; }
+		const TimeoutStats& timeoutStats() const { return timeout_stats_; }
 
 	private:
 		bool deactivate();
-		int waitForData(const std::shared_ptr<TcpServer::Connection>& connection);
+		void eventLoop();
+		bool isRequestReady(const std::shared_ptr<TcpServer::Connection>& connection);
+		bool isRequestBuffered(const std::shared_ptr<TcpServer::Connection>& connection, bool& header) const;
+		int acceptSsl(const std::shared_ptr<TcpServer::Connection>& connection, short& wait_events);
+		bool dispatchConnection(const std::shared_ptr<TcpServer::Connection>& connection);
+		void runConnection(const std::shared_ptr<TcpServer::Connection>& connection);
+		bool closeConnection(std::shared_ptr<TcpServer::Connection>& connection);
+		void parkConnection(const std::shared_ptr<TcpServer::Connection>& connection);
+		void resumeOutput(const std::shared_ptr<TcpServer::Connection>& connection);
+		void continueOutput(const std::shared_ptr<TcpServer::Connection>& connection);
+		void resumeConnection(const std::shared_ptr<TcpServer::Connection>& connection);
+		void suspendForInput(const std::shared_ptr<TcpServer::Connection>& connection);
+		bool isInputReady(const std::shared_ptr<TcpServer::Connection>& connection);
+		void checkInput(const std::shared_ptr<TcpServer::Connection>& connection);
+		void resumeInput(const std::shared_ptr<TcpServer::Connection>& connection);
+		void armTimer(const std::shared_ptr<TcpServer::Connection>& connection, const TimeoutKind kind);
+		void cancelTimer(const std::shared_ptr<TcpServer::Connection>& connection);
+		void expireTimers();
+		void countTimeout(const TimeoutKind kind);
+		std::chrono::steady_clock::time_point takeHeaderDeadline(const std::shared_ptr<TcpServer::Connection>& connection);
+		int waitForSocket(const std::shared_ptr<TcpServer::Connection>& connection, const short events, const int timeout_ms) const;
+		int checkIo(const std::shared_ptr<TcpServer::Connection>& connection, const int ret, const short events, short& wait_events) const;
+		int waitForIo(const std::shared_ptr<TcpServer::Connection>& connection, const int ret, const short events) const;
+		bool usesUring(const std::shared_ptr<TcpServer::Connection>& connection) const;
+		int recvData(const std::shared_ptr<TcpServer::Connection>& connection, char* data, const size_t size, size_t& received);
+		int recvToBuffer(const std::shared_ptr<TcpServer::Connection>& connection, size_t& received);
+		int waitForBufferData(const std::shared_ptr<TcpServer::Connection>& connection, std::unique_lock<std::mutex>& lock, const size_t available,
+							  const int timeout_ms, const TimeoutKind kind);
+		void consumeBufferData(const std::shared_ptr<TcpServer::Connection>& connection, const size_t size);
 		int sendAll(const std::shared_ptr<TcpServer::Connection>& connection, const char* data, const size_t size);
-		
+		int sendVector(const std::shared_ptr<TcpServer::Connection>& connection, iovec* iov, const size_t count, const bool more);
+		int sendVectorSsl(const std::shared_ptr<TcpServer::Connection>& connection, const iovec* iov, const size_t count);
+		int deferOutput(const std::shared_ptr<TcpServer::Connection>& connection, const iovec* iov, const size_t count);
+		int deferFile(const std::shared_ptr<TcpServer::Connection>& connection, const int file_fd, const uint64_t offset, const uint64_t size);
+		bool spillOutput(const std::shared_ptr<TcpServer::Connection>& connection, const iovec* iov, const size_t count, const size_t size);
+		void releaseSpill(const std::shared_ptr<TcpServer::Connection>& connection);
+		int drainOutput(const std::shared_ptr<TcpServer::Connection>& connection);
+		void discardOutput(const std::shared_ptr<TcpServer::Connection>& connection);
+#ifdef WEBSERVER_IO_URING
+		struct UringSendBatch;
+		struct UringRequest
+		{
+			enum class Type
+			{
+				ACCEPT,
+				ACCEPT_SSL,
+				RECV,
+				POLL,
+				SEND,
+				WRITABLE
+			};
+
+			Type type;
+			std::shared_ptr<TcpServer::Connection> connection;  // RECV, POLL, WRITABLE
+			UringSendBatch* batch = nullptr;  // SEND
+			size_t index = 0;  // SEND -> poradi v ramci davky
+		};
+
+		bool startUring();
+		void stopUring();
+		void uringLoop();
+		void handleUringCompletion(const io_uring_cqe& cqe);
+		void handleUringReceive(UringRequest* request, const io_uring_cqe& cqe);
+		void handleUringPoll(UringRequest* request, const io_uring_cqe& cqe);
+		void handleUringSend(UringRequest* request, const io_uring_cqe& cqe);
+		void handleUringWritable(UringRequest* request);
+		bool submitUringAccept(UringRequest& request, const int sock);
+		bool submitUringRequest(UringRequest* request);
+		void submitUringCancel(void* request);
+		void armUringConnection(const std::shared_ptr<TcpServer::Connection>& connection);
+		void parkUringConnection(const std::shared_ptr<TcpServer::Connection>& connection);
+		void wakeUringLoop();
+		void cancelUringConnection(const std::shared_ptr<TcpServer::Connection>& connection);
+		int acceptUring(std::deque<int>& accepted);
+		bool isRequestReadyUring(const std::shared_ptr<TcpServer::Connection>& connection);
+		int waitForUringData(const std::shared_ptr<TcpServer::Connection>& connection, std::unique_lock<std::mutex>& lock, const size_t available, const int timeout_ms);
+		void consumeUringData(const std::shared_ptr<TcpServer::Connection>& connection, const size_t size);
+		int sendAllUring(const std::shared_ptr<TcpServer::Connection>& connection, const iovec* iov, const size_t count);
+		bool isConnectedUring(const std::shared_ptr<TcpServer::Connection>& connection) const;
+#endif
+
 	private:
 		volatile std::atomic<bool> run_;
 		std::atomic<bool> deactivated_;
 		mutable std::mutex mutex_;
 		int socket_;
 		int socket_ssl_;
+		int epoll_fd_;
 		sockaddr_in server_;
 		sockaddr_in server_ssl_;
 		uint32_t max_connections_;
-		std::vector<std::shared_ptr<TcpServer::Connection>> connections_;
+		uint16_t max_header_size_;
+		size_t body_buffer_size_;  // Telo requestu do teto velikosti prijme event loop pred predanim obsluze
+		bool reuse_port_;
+		int keepalive_timeout_;  // [ms]
+		int header_timeout_;  // [ms]
+		int body_timeout_;  // [ms]
+		TimerWheel timers_;  // Casovace spojeni cekajicich v event loopu (klic = handle spojeni)
+		std::mutex timer_mutex_;
+		TimeoutStats timeout_stats_;
+		SlotMap<std::shared_ptr<TcpServer::Connection>> connections_;
+		std::thread event_thread_;
 		ThreadPool thread_pool_;
+		ThreadPool disk_pool_;  // Vlakna pro ukladani a mazani resources (fsync, rename, remove)
+		static thread_local Task offload_task_;  // Diskove operace predane obsluhou, do disk_pool_ se zaradi az po jejim navratu
+		NetworkBackend backend_;
+#ifdef WEBSERVER_IO_URING
+		IoUring ring_;
+		UringRequest uring_accept_;
+		UringRequest uring_accept_ssl_;
+		std::deque<int> accepted_;  // Sockety prijate multishot accept, vyzvedava je acceptConnection()
+		std::deque<int> accepted_ssl_;
+		std::mutex accept_mutex_;
+		std::condition_variable accept_cond_;
+		std::vector<std::shared_ptr<TcpServer::Connection>> uring_arm_queue_;  // Spojeni, pro ktera ma event loop zadat recv/poll
+		std::vector<std::shared_ptr<TcpServer::Connection>> uring_park_queue_;  // Spojeni, pro ktera ma event loop zadat cekani na zapis
+		std::mutex uring_arm_mutex_;
+		std::unordered_set<UringRequest*> uring_requests_;  // Zadane recv/poll (vlastni je event loop)
+		std::atomic<bool> uring_draining_{false};  // Event loop vyzvedava CQE sends i po zastaveni serveru (do zastaveni vlaken obsluhy)
+#endif
 };
 
 
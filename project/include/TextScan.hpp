@@ -0,0 +1,35 @@
+#ifndef __TEXT_SCAN_HPP__
+#define __TEXT_SCAN_HPP__
+#include <string_view>
+#include <cstddef>
+
+
+// Vyhledavani v prijatych datech (hlavicky, hranice multipart)
+// Implementace (AVX2, SSE4.2, skalarni) se vybira jednou podle CPU, na jinych architekturach jen skalarni
+namespace TextScan
+{
+	enum class Kernel
+	{
+		SCALAR,
+		SSE42,
+		AVX2
+	};
+
+	Kernel kernel();
+	const char* kernelName(const Kernel kernel);
+	bool kernelSupported(const Kernel kernel);
+
+	// Prvni vyskyt pattern v text od pozice from (std::string_view::npos -> nenalezen)
+	size_t find(const std::string_view text, const std::string_view pattern, const size_t from = 0);
+
+	// Prvni znak od pos, ktery neni viditelny (ridici znak, DEL; mezera jen pri allow_space = false), size -> zadny
+	// allow_space = true -> hodnota header fieldu (povolena mezera a HTAB), false -> request URI
+	size_t skipVisible(const char* data, const size_t pos, const size_t size, const bool allow_space);
+
+	// Zadana implementace misto vybrane (kontrola shody implementaci, benchmarky), kernel musi byt podporovany
+	size_t find(const Kernel kernel, const std::string_view text, const std::string_view pattern, const size_t from = 0);
+	size_t skipVisible(const Kernel kernel, const char* data, const size_t pos, const size_t size, const bool allow_space);
+}
+
+
+#endif
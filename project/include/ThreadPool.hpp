@@ -1,64 +1,179 @@
 #ifndef __THREAD_POOL_HPP__
 #define __THREAD_POOL_HPP__
+#include "InplaceTask.hpp"
+#include "WorkStealingDeque.hpp"
 #include <vector>
 #include <atomic>
 #include <thread>
-#include <functional>
 #include <mutex>
-#include <list>
-#include <semaphore.h>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
 
 
 class ThreadPool
 {
-	using Task = std::function<void()>;
+	using Task = InplaceTask;
 
 	public:
+		// Trida tasku, vlakna vybiraji z front vazene (interactive ma nejvetsi vahu)
+		enum class TaskPriority : uint8_t
+		{
+			INTERACTIVE,	// Kratke requesty (vychozi)
+			BULK,			// Velke prenosy (uploady, velke soubory)
+			BACKGROUND		// Prace, na kterou neceka klient
+		};
+		static constexpr size_t PRIORITIES = 3;
+
+		// Statistika jedne fronty (tridy) tasku
+		struct LaneStats
+		{
+			uint64_t queued = 0;  // Aktualne cekajici tasky
+			uint64_t max_queued = 0;
+			uint64_t tasks = 0;  // Spustene tasky
+			uint64_t wait_us = 0;  // Celkova doba cekani ve fronte [us] (odhad z merenych tasku, viz TaskNode::timed)
+			uint64_t max_wait_us = 0;
+		};
+
 		ThreadPool();
 		ThreadPool(const size_t size);
 		ThreadPool(const ThreadPool& obj) = delete;
 		ThreadPool(ThreadPool&& obj) = delete;
-		~ThreadPool() = default;
-		
+		~ThreadPool();
+
 		ThreadPool& operator=(const ThreadPool& obj) = delete;
 		ThreadPool& operator=(ThreadPool&& obj) = delete;
 
-		bool queueTask(const Task& task);
-		bool queueTask(Task&& task);
-		bool resize(const size_t size);
+		bool queueTask(Task&& task, const TaskPriority priority = TaskPriority::INTERACTIVE);
+		void setTaskPriority(const TaskPriority priority);  // Preradi task, ktery prave bezi ve volajicim vlakne
+		bool resize(const size_t size, const size_t max_size = 0);  // max_size > size -> pocet vlaken se meni podle zatizeni
+		void setScaling(const uint32_t spawn_delay_ms, const uint32_t idle_timeout_ms);
 		bool start();
 		bool stop(const bool force = false);  // Stop the threadpool without executing all tasks in the task queue
 		bool reset();
 		size_t size() const;
+		size_t maxSize() const;
 		bool isRunning() const;
+		bool isWorkerThread() const { return (current_worker_ && current_worker_->pool == this); }
 		size_t busyThreads() const;
 		size_t freeThreads() const;
-		
-	
-	private:	
-		void worker();
-		void waitForRun() const;  // Waits untill all threads are spawned an running
-		void waitForTasks() const;  // Waits until all tasks in task queue are completed
-		
-		
+		LaneStats laneStats(const TaskPriority priority) const;
+
+
+	private:
+		static constexpr size_t NODE_CACHE = 32;
+
+		// Ulozeny task (uzly se recykluji -> bez alokace pro kazdy task)
+		struct TaskNode
+		{
+			Task task;
+			TaskPriority priority = TaskPriority::INTERACTIVE;
+			std::chrono::steady_clock::time_point queued;  // Cas zarazeni (doba cekani ve fronte)
+			bool timed = false;  // Doba cekani se meri (tasky z vlaken poolu jen vzorkovane, cteni casu je drahe)
+			std::atomic<uint32_t> next{0};  // Dalsi volny uzel (index + 1, 0 -> zadny)
+		};
+
+		struct Lane
+		{
+			WorkStealingDeque<TaskNode*> deque;  // Tasky zadane z tohoto vlakna (ostatni z nej kradou)
+			std::vector<TaskNode*> inbox;  // Tasky zadane z jinych vlaken (event loop), chrani inbox_mutex
+		};
+
+		// Statistika zpracovanych tasku jednoho vlakna (zapisuje jen toto vlakno -> bez atomickych RMW operaci)
+		struct WorkerCounters
+		{
+			std::atomic<uint64_t> tasks{0};
+			std::atomic<uint64_t> timed{0};  // Tasky se zmerenou dobou cekani
+			std::atomic<uint64_t> wait_us{0};  // Doba cekani merenych tasku
+			std::atomic<uint64_t> max_wait_us{0};
+		};
+
+		struct Worker
+		{
+			ThreadPool* pool = nullptr;
+			size_t index = 0;
+			Lane lanes[PRIORITIES];
+			std::mutex inbox_mutex;
+			std::atomic<bool> active{false};  // Vlakno bezi a prijima tasky (meni se pod inbox_mutex)
+			std::thread thread;
+			uint32_t picks = 0;  // Pocitadlo pro vazeny vyber fronty
+			uint32_t pushes = 0;  // Pocitadlo tasku zadanych z tohoto vlakna (vzorkovani doby cekani)
+			std::atomic<bool> busy{false};  // Vlakno zpracovava task
+			TaskNode* node_cache[NODE_CACHE];  // Volne uzly vlakna (task zadany a zpracovany stejnym vlaknem -> bez CAS)
+			size_t cached_nodes = 0;
+			TaskPriority priority = TaskPriority::INTERACTIVE;  // Trida prave zpracovavaneho tasku
+			WorkerCounters counters[PRIORITIES];
+		};
+
+		struct LaneCounters
+		{
+			std::atomic<uint64_t> queued{0};
+			std::atomic<uint64_t> max_queued{0};
+		};
+
+		void worker(Worker* self);
+		TaskNode* nextTask(Worker* self);
+		TaskNode* takeTask(Worker* self, const size_t lane);
+		bool reserveLimited();
+		void releaseLimited();
+		bool hasRunnableTasks() const;
+		uint64_t queuedTasks() const;
+		bool isIdle() const;
+		void park(const int64_t timeout_ms = -1);
+		void notify();
+		void manager();
+		bool spawnWorker();
+		bool retireWorker(Worker* self);
+		bool isElastic() const { return (workers_.size() > min_threads_); }
+		TaskNode* allocNode(Worker* self);
+		void freeNode(Worker* self, TaskNode* node);
+		TaskNode* popFreeNode();
+		void pushFreeNode(TaskNode* node);
+		void clearTasks();
+		void waitForRun();  // Waits untill all threads are spawned an running
+		void waitForTasks();  // Waits until all tasks in task queue are completed
+
+
 	private:
 		volatile std::atomic<bool> run_;
-		std::atomic<size_t> running_threads_;
-		std::atomic<size_t> busy_threads_;
-		std::vector<std::thread> threads_;
-		std::list<Task> task_queue_;
-		std::mutex mutex_;
-		sem_t semaphore_;
+		std::atomic<uint32_t> running_threads_;
+		std::atomic<size_t> threads_;  // Aktivni vlakna (prijimajici tasky)
+		std::atomic<size_t> used_slots_;  // Pocet pouzitych mist ve workers_ (vlakna se spousti od nejnizsiho volneho)
+		size_t min_threads_;
+		std::chrono::milliseconds spawn_delay_;  // Jak dlouho musi byt vsechna vlakna obsazena, nez se spusti dalsi
+		std::chrono::milliseconds idle_timeout_;  // Jak dlouho muze byt vlakno nad minimum necinne, nez skonci
+		std::thread manager_thread_;
+		std::mutex manager_mutex_;
+		std::condition_variable manager_cond_;
+		std::atomic<size_t> limited_running_;  // Vlakna zpracovavajici bulk a background tasky (vzdy zustava jedno pro interactive)
+		LaneCounters lanes_[PRIORITIES];
+		std::atomic<bool> draining_;  // Ceka se na dokonceni vsech tasku (vlakna po kazdem tasku zmeni drain_seq_)
+		std::atomic<uint32_t> drain_seq_;  // Futex pro waitForTasks()
+		std::atomic<uint32_t> wake_seq_;  // Futex, na kterem spi necinna vlakna (zmena -> probuzeni)
+		std::atomic<uint32_t> sleepers_;
+		std::atomic<size_t> next_worker_;  // Round-robin pro tasky zadane mimo vlakna poolu
+		std::vector<std::unique_ptr<Worker>> workers_;  // Mista pro max. pocet vlaken (za behu se nemeni)
+		std::unique_ptr<TaskNode[]> nodes_;
+		std::atomic<uint64_t> free_nodes_;  // Zasobnik volnych uzlu (ABA znacka v hornich 32 bitech + index + 1)
+		static thread_local Worker* current_worker_;
 };
 
 
 inline size_t ThreadPool::size() const
 {
-	return threads_.size();
+	return threads_;
+}
+
+
+inline size_t ThreadPool::maxSize() const
+{
+	return workers_.size();
 }
 
 
-inline bool ThreadPool::isRunning() const 
+inline bool ThreadPool::isRunning() const
 {
 	return run_;
 }
@@ -66,13 +181,44 @@ inline bool ThreadPool::isRunning() const
 
 inline size_t ThreadPool::busyThreads() const
 {
-	return busy_threads_;
+	// Kazde vlakno si priznak nastavuje samo (spolecny citac by se menil pri kazdem tasku)
+	size_t busy = 0;
+	for (const auto& worker : workers_) {
+		busy += worker->busy.load(std::memory_order_acquire);
+	}
+	return busy;
 }
 
 
 inline size_t ThreadPool::freeThreads() const
 {
-	return (threads_.size() - busy_threads_);	
+	const size_t threads = threads_;
+	const size_t busy = busyThreads();
+	return (threads > busy ? threads - busy : 0);
+}
+
+
+inline ThreadPool::LaneStats ThreadPool::laneStats(const TaskPriority priority) const
+{
+	const size_t lane = static_cast<size_t>(priority);
+	LaneStats stats;
+	stats.queued = lanes_[lane].queued;
+	stats.max_queued = lanes_[lane].max_queued;
+	uint64_t timed = 0;
+	for (const auto& worker : workers_)
+	{
+		const WorkerCounters& counters = worker->counters[lane];
+		stats.tasks += counters.tasks.load(std::memory_order_relaxed);
+		timed += counters.timed.load(std::memory_order_relaxed);
+		stats.wait_us += counters.wait_us.load(std::memory_order_relaxed);
+		stats.max_wait_us = std::max<uint64_t>(stats.max_wait_us, counters.max_wait_us.load(std::memory_order_relaxed));
+	}
+
+	// Prumer merenych tasku plati pro vsechny (tasky z vlaken poolu se meri jen vzorkovane)
+	if (timed != 0 && timed != stats.tasks) {
+		stats.wait_us = static_cast<uint64_t>(static_cast<double>(stats.wait_us) * stats.tasks / timed);
+	}
+	return stats;
 }
 
 
@@ -0,0 +1,61 @@
+#ifndef __TIMER_WHEEL_HPP__
+#define __TIMER_WHEEL_HPP__
+#include "SlotMap.hpp"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+// Hierarchicke casovace (4 urovne po 64 slotech), naplanovani a zruseni O(1)
+// Casovac nese klic a druh, po vyprseni je vraci volajicimu (zadne callbacky)
+class TimerWheel
+{
+	public:
+		using Handle = uint64_t;
+
+		struct Expired
+		{
+			Handle timer;  // Handle vyprseleho casovace (uz neplatny)
+			uint64_t key;
+			uint8_t kind;
+		};
+
+		TimerWheel(const uint32_t tick_ms = 100);
+		TimerWheel(const TimerWheel& obj) = delete;
+		TimerWheel(TimerWheel&& obj) = delete;
+		~TimerWheel() = default;
+
+		TimerWheel& operator=(const TimerWheel& obj) = delete;
+		TimerWheel& operator=(TimerWheel&& obj) = delete;
+
+		void start(const uint64_t now_ms);
+		Handle schedule(const uint64_t key, const uint8_t kind, const uint64_t timeout_ms);
+		bool cancel(const Handle timer);
+		void advance(const uint64_t now_ms, std::vector<Expired>& expired);
+		void clear();
+		size_t size() const { return timers_.size(); }
+
+	private:
+		struct Timer
+		{
+			uint64_t key = 0;
+			uint8_t kind = 0;
+			uint64_t expires = 0;  // Tick vyprseni
+			uint32_t bucket = 0;
+			Handle prev = 0;
+			Handle next = 0;
+		};
+
+		void link(const Handle handle, Timer& timer);
+		void unlink(Timer& timer);
+		void cascade(const uint32_t level);
+
+	private:
+		SlotMap<Timer> timers_;
+		std::vector<Handle> buckets_;  // Hlavy seznamu casovacu (uroven * sloty + slot)
+		uint32_t tick_ms_;
+		uint64_t current_;  // Posledni zpracovany tick
+};
+
+
+#endif
@@ -5,6 +5,7 @@
 #include "SslConfig.hpp"
 #include <memory>
 #include <thread>
+#include <vector>
 
 
 class WebServer
@@ -15,25 +16,26 @@ class WebServer
 		static void run();
 		static bool stop();
 		static bool reset();
-		static bool isRunning() { return server_.tcp_server_->isRunning(); }
-		static bool isDeactivated() { return server_.tcp_server_->isDeactivated(); }	
+		static bool isRunning();
+		static bool isDeactivated();
 	
 	private:
-		WebServer();
+		WebServer() = default;
 		WebServer(const WebServer& obj) = delete;
 		WebServer(WebServer&& obj) = delete;
 		WebServer& operator=(const WebServer& obj) = delete;
 		WebServer& operator=(WebServer&& obj) = delete;
 		
-		void createSession(std::shared_ptr<TcpServer::Connection> connection);
-		void createSessionSsl(std::shared_ptr<TcpServer::Connection> connection);
+		void acceptConnections(const std::shared_ptr<TcpServer>& tcp_server, const bool ssl);
+		void createSession(const std::shared_ptr<TcpServer>& tcp_server, std::shared_ptr<TcpServer::Connection> connection);
+		void createSessionSsl(const std::shared_ptr<TcpServer>& tcp_server, std::shared_ptr<TcpServer::Connection> connection);
 		bool loadConfigFiles();
-		bool getClientHttpVersion(std::shared_ptr<TcpServer::Connection>& connection, std::unique_ptr<Http>& http_client);
+		bool getClientHttpVersion(const std::shared_ptr<TcpServer>& tcp_server, std::shared_ptr<TcpServer::Connection>& connection, std::shared_ptr<Http>& http_client);
 			
 	private:
-		std::shared_ptr<TcpServer> tcp_server_;
+		std::vector<std::shared_ptr<TcpServer>> tcp_servers_;  // Shardy (kazdy s vlastnim listening socketem, event loopem a vlakny)
 		SslConfig ssl_config_;
-		std::thread https_thread_;
+		std::vector<std::thread> accept_threads_;
 		static WebServer server_;
 };
 
@@ -0,0 +1,150 @@
+#ifndef __WORK_STEALING_DEQUE_HPP__
+#define __WORK_STEALING_DEQUE_HPP__
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+// Chase-Lev deque (Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models")
+// push()/pop() vola jen vlastnik (konec bottom), steal() libovolne vlakno (konec top)
+// Prvky musi byt trivialne kopirovatelne (ukazatele) -> zlodej je cte pred CAS
+template <typename T>
+class WorkStealingDeque
+{
+	public:
+		WorkStealingDeque(const size_t capacity = 256);
+		WorkStealingDeque(const WorkStealingDeque& obj) = delete;
+		WorkStealingDeque(WorkStealingDeque&& obj) = delete;
+		~WorkStealingDeque();
+
+		WorkStealingDeque& operator=(const WorkStealingDeque& obj) = delete;
+		WorkStealingDeque& operator=(WorkStealingDeque&& obj) = delete;
+
+		void push(const T item);
+		bool pop(T& item);
+		bool steal(T& item);
+		bool empty() const;
+
+	private:
+		struct Array
+		{
+			Array(const size_t cap) : capacity(cap), mask(cap - 1), items(new std::atomic<T>[cap]) {}
+			~Array() { delete[] items; }
+
+			T get(const int64_t i) const { return items[i & mask].load(std::memory_order_relaxed); }
+			void put(const int64_t i, const T item) { items[i & mask].store(item, std::memory_order_relaxed); }
+
+			const int64_t capacity;
+			const int64_t mask;
+			std::atomic<T>* items;
+		};
+
+	private:
+		alignas(64) std::atomic<int64_t> top_;
+		alignas(64) std::atomic<int64_t> bottom_;
+		std::atomic<Array*> array_;
+		std::vector<Array*> retired_;  // Predchozi pole (zlodej z nich jeste muze cist), uvolni se az s deque
+};
+
+
+template <typename T>
+inline WorkStealingDeque<T>::WorkStealingDeque(const size_t capacity) :
+	top_(0),
+	bottom_(0)
+{
+	// Kapacita musi byt mocnina 2
+	size_t cap = 1;
+	while (cap < capacity) {
+		cap <<= 1;
+	}
+	array_.store(new Array(cap), std::memory_order_relaxed);
+}
+
+template <typename T>
+inline WorkStealingDeque<T>::~WorkStealingDeque()
+{
+	delete array_.load(std::memory_order_relaxed);
+	for (Array* array : retired_) {
+		delete array;
+	}
+}
+
+template <typename T>
+inline void WorkStealingDeque<T>::push(const T item)
+{
+	const int64_t b = bottom_.load(std::memory_order_relaxed);
+	const int64_t t = top_.load(std::memory_order_acquire);
+	Array* array = array_.load(std::memory_order_relaxed);
+
+	// Plne pole -> zdvojnasobit (stare zustava platne pro zlodeje)
+	if (b - t > array->capacity - 1)
+	{
+		Array* bigger = new Array(array->capacity * 2);
+		for (int64_t i = t; i < b; ++i) {
+			bigger->put(i, array->get(i));
+		}
+		retired_.push_back(array);
+		array_.store(bigger, std::memory_order_release);
+		array = bigger;
+	}
+
+	// Release store (ne fence + relaxed) -> zlodej, ktery cte bottom_ s acquire, vidi i data tasku
+	array->put(b, item);
+	bottom_.store(b + 1, std::memory_order_release);
+}
+
+template <typename T>
+inline bool WorkStealingDeque<T>::pop(T& item)
+{
+	const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+	Array* array = array_.load(std::memory_order_relaxed);
+	bottom_.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top_.load(std::memory_order_relaxed);
+
+	if (t > b)
+	{
+		// Prazdna deque
+		bottom_.store(b + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	item = array->get(b);
+	if (t == b)
+	{
+		// Posledni prvek -> souperi se zlodeji
+		const bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		bottom_.store(b + 1, std::memory_order_relaxed);
+		return won;
+	}
+
+	return true;
+}
+
+template <typename T>
+inline bool WorkStealingDeque<T>::steal(T& item)
+{
+	int64_t t = top_.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const int64_t b = bottom_.load(std::memory_order_acquire);
+
+	if (t >= b) {
+		return false;
+	}
+
+	Array* array = array_.load(std::memory_order_acquire);
+	item = array->get(t);
+	return top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+template <typename T>
+inline bool WorkStealingDeque<T>::empty() const
+{
+	const int64_t t = top_.load(std::memory_order_acquire);
+	const int64_t b = bottom_.load(std::memory_order_acquire);
+	return (b <= t);
+}
+
+
+#endif
@@ -3,7 +3,7 @@
 #define BUFFER_SIZE 32768
 
 
-bool Codec::compress_data(std::string& compressed_data, const void* data, const size_t data_size, const bool gzip)
+bool Codec::compress_data(std::string& compressed_data, const void* data, const size_t data_size, const bool gzip, const int level)
 {
     z_stream zs = {0};
 
@@ -14,12 +14,15 @@ bool Codec::compress_data(std::string& compressed_data, const void* data, const
     }
 
     // Initialize the deflate stream.
-    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+    if (deflateInit2(&zs, level, Z_DEFLATED,
                      windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
     {
         return false;
     }
 
+    // Reserve the worst case size at once (large inputs would otherwise reallocate many times).
+    compressed_data.reserve(compressed_data.size() + deflateBound(&zs, static_cast<uLong>(data_size)));
+
     // Set input data: cast away const to satisfy deflate's API.
     zs.next_in = reinterpret_cast<Bytef*>(const_cast<void*>(data));
     zs.avail_in = static_cast<uInt>(data_size);
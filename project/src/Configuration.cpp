@@ -1,11 +1,15 @@
 #include "Configuration.hpp"
 #include "WebServerError.hpp"
 #include "Logger.hpp"
+#include "HttpPacketBuilder.hpp"
+#include "FileCache.hpp"
 #include "toml.hpp"
 #include <cstdio>
 #include <stdexcept>
 #include <vector>
 #include <algorithm>
+#include <iterator>
+#include <time.h>
 #include <sys/stat.h>
 #include <sys/file.h>
 #include <unistd.h>
@@ -26,8 +30,22 @@
 #define SSL_CERTIFICATE_ECDSA					"ssl_certificate_ecdsa"
 #define PRIVATE_KEY_ECDSA						"private_key_ecdsa"
 #define CIPHER_SUITES							"cipher_suites"
+#define KTLS_ENABLED							"ktls_enabled"
+#define LISTENER_SHARDS							"listener_shards"
 #define CLIENT_THREADS							"client_threads"
+#define CLIENT_THREADS_MAX						"client_threads_max"
+#define CLIENT_THREADS_SPAWN_DELAY				"client_threads_spawn_delay"
+#define CLIENT_THREADS_IDLE_TIMEOUT				"client_threads_idle_timeout"
+#define MAX_CONNECTIONS							"max_connections"
+#define DISK_IO_THREADS							"disk_io_threads"
+#define NETWORK_BACKEND							"network_backend"
+#define KEEPALIVE_TIMEOUT						"keepalive_timeout"
+#define CLIENT_HEADER_TIMEOUT					"client_header_timeout"
+#define CLIENT_BODY_TIMEOUT						"client_body_timeout"
 #define FILE_CHUNK_SIZE							"file_chunk_size"
+#define FILE_CACHE_SIZE							"file_cache_size"
+#define FILE_CACHE_MAX_FILE_SIZE				"file_cache_max_file_size"
+#define COMPRESSED_VARIANT_MAX_FILE_SIZE		"compressed_variant_max_file_size"
 #define MAX_HEADER_SIZE							"max_header_size"
 #define CLIENT_BODY_BUFFER_SIZE					"client_body_buffer_size"
 #define CLIENT_MAX_BODY_SIZE					"client_max_body_size"
@@ -43,6 +61,30 @@
 #define CACHE_TYPE								"cache_type"
 
 
+// Status pages drzene v pameti (index odpovida Config::status_pages_)
+struct StatusPageFile
+{
+	HttpStatusCode status_code;
+	const char* resource_path;
+};
+
+static const StatusPageFile status_page_files[] = {
+	{ HttpStatusCode::BAD_REQUEST, BAD_REQUEST_WEB_PAGE },
+	{ HttpStatusCode::FORBIDDEN, FORBIDDEN_WEB_PAGE },
+	{ HttpStatusCode::NOT_FOUND, NOT_FOUND_WEB_PAGE },
+	{ HttpStatusCode::METHOD_NOT_ALLOWED, METHOD_NOT_ALLOWED_WEB_PAGE },
+	{ HttpStatusCode::NOT_ACCEPTABLE, NOT_ACCEPTABLE_WEB_PAGE },
+	{ HttpStatusCode::LENGTH_REQUIRED, LENGTH_REQUIRED_WEB_PAGE },
+	{ HttpStatusCode::CONTENT_TOO_LARGE, CONTENT_TOO_LARGE_WEB_PAGE },
+	{ HttpStatusCode::UNSUPPORTED_MEDIA_TYPE, UNSUPPORTED_MEDIA_TYPE_WEB_PAGE },
+	{ HttpStatusCode::INTERNAL_SERVER_ERROR, INTERNAL_SERVER_ERROR_WEB_PAGE },
+	{ HttpStatusCode::SERVICE_UNAVAILABLE, SERVICE_UNAVAILABLE_WEB_PAGE },
+	{ HttpStatusCode::HTTP_VERSION_NOT_SUPPORTED, HTTP_VERSION_NOT_SUPPORTED_ERROR_WEB_PAGE }
+};
+
+static_assert(std::size(status_page_files) == STATUS_PAGES_COUNT, "STATUS_PAGES_COUNT does not match status page files");
+
+
 Config Config::obj_;
 
 
@@ -102,9 +144,23 @@ bool Config::buildParams()
 		getValue(params_.ssl_certificate_ecdsa, SSL_CERTIFICATE_ECDSA, input);
 		getValue(params_.private_key_ecdsa, PRIVATE_KEY_ECDSA, input);
 		getValue(params_.cipher_suites, CIPHER_SUITES, input);
+		getValue(params_.ktls_enabled, KTLS_ENABLED, input);
 
+		getValue(params_.listener_shards, LISTENER_SHARDS, input);
 		getValue(params_.client_threads, CLIENT_THREADS, input);
+		getValue(params_.client_threads_max, CLIENT_THREADS_MAX, input);
+		getValue(params_.client_threads_spawn_delay, CLIENT_THREADS_SPAWN_DELAY, input);
+		getValue(params_.client_threads_idle_timeout, CLIENT_THREADS_IDLE_TIMEOUT, input);
+		getValue(params_.max_connections, MAX_CONNECTIONS, input);
+		getValue(params_.disk_io_threads, DISK_IO_THREADS, input);
+		getValue(params_.network_backend, NETWORK_BACKEND, input);
+		getValue(params_.keepalive_timeout, KEEPALIVE_TIMEOUT, input);
+		getValue(params_.client_header_timeout, CLIENT_HEADER_TIMEOUT, input);
+		getValue(params_.client_body_timeout, CLIENT_BODY_TIMEOUT, input);
 		getValue(params_.file_chunk_size, FILE_CHUNK_SIZE, input);
+		getValue(params_.file_cache_size, FILE_CACHE_SIZE, input);
+		getValue(params_.file_cache_max_file_size, FILE_CACHE_MAX_FILE_SIZE, input);
+		getValue(params_.compressed_variant_max_file_size, COMPRESSED_VARIANT_MAX_FILE_SIZE, input);
 		getValue(params_.max_header_size, MAX_HEADER_SIZE, input);
 		getValue(params_.client_body_buffer_size, CLIENT_BODY_BUFFER_SIZE, input);
 		getValue(params_.client_max_body_size, CLIENT_MAX_BODY_SIZE, input);
@@ -192,67 +248,93 @@ bool Config::loadConfig()
 
 bool Config::loadResourcesConfig()
 {
-	return obj_.buildRParams();
+	return (obj_.buildRParams() && obj_.buildStatusPages());
 }
 
-Config::RParams* Config::orparams(const std::string& resource, const bool resource_lock_shared)
+bool Config::buildStatusPages()
 {
-	try
+	for (size_t i = 0; i < STATUS_PAGES_COUNT; ++i)
 	{
-		std::lock_guard<std::mutex> lock(obj_.orparams_mutex_);
+		std::shared_ptr<const Config::StatusPage> page = 
+			HttpPacketBuilder::loadStatusPage(status_page_files[i].status_code, status_page_files[i].resource_path);
+		if (!page)
+		{
+			LOG_ERR("Failed to load status page (file: %s)", status_page_files[i].resource_path);
+			return false;
+		}
+		std::atomic_store(&status_pages_[i], std::move(page));
+	}
+
+	return true;
+}
+
+std::shared_ptr<const Config::StatusPage> Config::statusPage(const HttpStatusCode status_code)
+{
+	size_t index = 0;
+	while (index < STATUS_PAGES_COUNT && status_page_files[index].status_code != status_code) {
+		++index;
+	}
+	if (index == STATUS_PAGES_COUNT) {
+		return nullptr;
+	}
+
+	std::shared_ptr<const Config::StatusPage> page = std::atomic_load(&obj_.status_pages_[index]);
+	if (!page) {
+		return nullptr;
+	}
 
-		static const std::vector<std::string> default_allowed_methods = 
-			{ "GET", "HEAD", "POST", "PUT", "DELETE", "OPTIONS" };
+	// Zmena souboru se kontroluje nejvyse jednou za sekundu a jen jednim vlaknem (ostatni pouziji stavajici page)
+	const time_t now = time(nullptr);
+	if (page->checked.load(std::memory_order_relaxed) != now && !page->checking.test_and_set(std::memory_order_acquire))
+	{
+		page->checked.store(now, std::memory_order_relaxed);
 
-		// Nejdrive zkusit najit resource
-		//LOG_DBG("Finding other resource...");
-		const std::string rsrc_path = ((!resource.empty() && resource.at(0) == '/') ? resource.substr(1) : resource);
-		const auto rsrc_it = obj_.other_rparams_.find(rsrc_path);
-		if (rsrc_it != obj_.other_rparams_.end()) 
+		const std::string file_path = std::string(RESOURCES_DIR) + "/" + page->resource_path;
+		struct stat st = {0};
+		if (stat(file_path.c_str(), &st) == 0 && 
+			static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec != page->modified_ns)
 		{
-			//LOG_DBG("Other resource found");
-			rsrc_it->second.lock(resource_lock_shared);
-			return &rsrc_it->second;
+			std::shared_ptr<const Config::StatusPage> rebuilt = HttpPacketBuilder::loadStatusPage(status_code, page->resource_path);
+			if (rebuilt) {
+				std::atomic_store(&obj_.status_pages_[index], rebuilt);
+			}
+			else {
+				LOG_ERR("Failed to reload status page (file: %s)", page->resource_path.c_str());
+			}
+			page->checking.clear(std::memory_order_release);
+			return ((rebuilt) ? rebuilt : page);
 		}
+		page->checking.clear(std::memory_order_release);
+	}
 
-		//LOG_DBG("Creating other resource...");
+	return page;
+}
 
-		Config::RParams rparam;
-		rparam.resource_path = rsrc_path;
-		rparam.methods_allowed = default_allowed_methods;
-		rparam.accept_ranges = "bytes";
-		rparam.expires = 3600;  // 1 hodina v sekundach
-		rparam.cache_type = "public";
-		// Zatim nastavuji defaultni hodnoty, protoze resource nemusi byt jeste vytvoreny
-		rparam.resource_size = 0;
-		rparam.last_modified = -1;
-		rparam.etag = "";
-		rparam.last_resource_access = time(NULL);
-		
-		if (obj_.other_rparams_.size() == MAX_OTHER_RPARAMS)
+Config::RParams* Config::orparams(const std::string& resource, const bool resource_lock_shared)
+{
+	Config::RParams* rp = nullptr;
+	try
+	{
 		{
-			const auto rparam_it = std::min_element(obj_.other_rparams_.cbegin(), obj_.other_rparams_.cend(),
-			[](const std::pair<const std::string, Config::RParams>& r1, 
-			   const std::pair<const std::string, Config::RParams>& r2) 
-			{
-				return r1.second.last_resource_access < r2.second.last_resource_access;
-			});
-
-			if (rsrc_path != rparam_it->first) {
-				//LOG_DBG("Erasing other resource...");
-				obj_.other_rparams_.erase(rparam_it);
-				//LOG_DBG("Erased other resource");
-			}
+			std::lock_guard<std::mutex> lock(obj_.orparams_mutex_);
+			rp = orparamsFind(resource);
+			++rp->access_waiters;
 		}
 
-		//LOG_DBG("Adding other resource param...");
-		obj_.other_rparams_[rsrc_path] = std::move(rparam);
-		//LOG_DBG("Added other resource param");
+		// Na zamek resource se ceka bez orparams_mutex_ (drzitel zamku muze volat orparamsRemove),
+		// cekajici request zaroven brani smazani zaznamu
+		try {
+			rp->lock(resource_lock_shared);
+		}
+		catch (const std::exception& exc)
+		{
+			std::lock_guard<std::mutex> lock(obj_.orparams_mutex_);
+			--rp->access_waiters;
+			throw;
+		}
 
-		//LOG_DBG("Locking other resource param...");
-		Config::RParams* rp = &obj_.other_rparams_[rsrc_path];
-		rp->lock(resource_lock_shared);
-		//LOG_DBG("Locked other resource param");
+		std::lock_guard<std::mutex> lock(obj_.orparams_mutex_);
+		--rp->access_waiters;
 		return rp;
 	}
 
@@ -263,6 +345,61 @@ Config::RParams* Config::orparams(const std::string& resource, const bool resour
 	return nullptr;
 }
 
+Config::RParams* Config::orparamsFind(const std::string& resource)
+{
+	static const std::vector<std::string> default_allowed_methods = 
+		{ "GET", "HEAD", "POST", "PUT", "DELETE", "OPTIONS" };
+
+	// Nejdrive zkusit najit resource
+	//LOG_DBG("Finding other resource...");
+	const std::string rsrc_path = ((!resource.empty() && resource.at(0) == '/') ? resource.substr(1) : resource);
+	const auto rsrc_it = obj_.other_rparams_.find(rsrc_path);
+	if (rsrc_it != obj_.other_rparams_.end()) 
+	{
+		//LOG_DBG("Other resource found");
+		return &rsrc_it->second;
+	}
+
+	//LOG_DBG("Creating other resource...");
+
+	Config::RParams rparam;
+	rparam.resource_path = rsrc_path;
+	rparam.methods_allowed = default_allowed_methods;
+	rparam.accept_ranges = "bytes";
+	rparam.expires = 3600;  // 1 hodina v sekundach
+	rparam.cache_type = "public";
+	// Zatim nastavuji defaultni hodnoty, protoze resource nemusi byt jeste vytvoreny
+	rparam.resource_size = 0;
+	rparam.last_modified = -1;
+	rparam.etag = "";
+	rparam.last_resource_access = time(NULL);
+	
+	if (obj_.other_rparams_.size() >= MAX_OTHER_RPARAMS)
+	{
+		// Zamceny resource nebo resource, na ktery se ceka, se nesmi smazat -> pri plne mape se vybira jen z nepouzivanych
+		auto rparam_it = obj_.other_rparams_.end();
+		for (auto it = obj_.other_rparams_.begin(); it != obj_.other_rparams_.end(); ++it)
+		{
+			if (it->second.access_counter == 0 && it->second.access_waiters == 0 && 
+				(rparam_it == obj_.other_rparams_.end() || it->second.last_resource_access < rparam_it->second.last_resource_access)) {
+				rparam_it = it;
+			}
+		}
+
+		if (rparam_it != obj_.other_rparams_.end()) {
+			//LOG_DBG("Erasing other resource...");
+			obj_.other_rparams_.erase(rparam_it);
+			//LOG_DBG("Erased other resource");
+		}
+	}
+
+	//LOG_DBG("Adding other resource param...");
+	Config::RParams* rp = &(obj_.other_rparams_[rsrc_path] = std::move(rparam));
+	//LOG_DBG("Added other resource param");
+	return rp;
+}
+
+
 void Config::orparamsRemove(const Config::RParams* rparam)
 {
 	try
@@ -275,6 +412,10 @@ void Config::orparamsRemove(const Config::RParams* rparam)
 				return;
 			}
 			rparam_it->second.unlock();
+			// Resource drzi nebo na nej ceka jiny request -> zaznam zustava, aktualni stav si nacte pres update()
+			if (rparam_it->second.access_counter > 0 || rparam_it->second.access_waiters > 0) {
+				return;
+			}
 			obj_.other_rparams_.erase(rparam_it);
 		}
 	}
@@ -297,6 +438,9 @@ void Config::reset()
 	obj_.params_.reset();
 	obj_.rparams_.clear();
 	obj_.other_rparams_.clear();
+	for (std::shared_ptr<const Config::StatusPage>& page : obj_.status_pages_) {
+		std::atomic_store(&page, std::shared_ptr<const Config::StatusPage>());
+	}
 }
 
 
@@ -311,9 +455,23 @@ void Config::Params::reset()
 	ssl_certificate_ecdsa.clear();
 	private_key_ecdsa.clear();
 	cipher_suites.clear();
+	ktls_enabled = false;
 
+	listener_shards = 0;
 	client_threads = 0;
+	client_threads_max = 0;
+	client_threads_spawn_delay = 0;
+	client_threads_idle_timeout = 0;
+	max_connections = 0;
+	disk_io_threads = 0;
+	network_backend.clear();
+	keepalive_timeout = 0;
+	client_header_timeout = 0;
+	client_body_timeout = 0;
 	file_chunk_size = 0;
+	file_cache_size = 0;
+	file_cache_max_file_size = 0;
+	compressed_variant_max_file_size = 0;
 	max_header_size = 0;
 	client_body_buffer_size = 0;
 	client_max_body_size = 0;
@@ -325,7 +483,6 @@ Config::RParams::RParams() :
 	expires(0),
 	resource_size(0),
 	last_modified(-1),
-	access_lock(PTHREAD_RWLOCK_INITIALIZER),
 	access_counter(0),
 	resource_fd(-1),
 	last_resource_access(-1)
@@ -349,10 +506,10 @@ Config::RParams::RParams(Config::RParams&& obj) :
 	resource_size(obj.resource_size),
 	last_modified(obj.last_modified),
 	etag(std::move(obj.etag)),
-	access_lock(PTHREAD_RWLOCK_INITIALIZER),
 	access_counter((uint32_t)obj.access_counter),
 	resource_fd(obj.resource_fd),
-	last_resource_access(obj.last_resource_access)
+	last_resource_access(obj.last_resource_access),
+	header_templates{ std::move(obj.header_templates[0]), std::move(obj.header_templates[1]) }
 {
 	obj.expires = 0;
 	obj.resource_size = 0;
@@ -377,6 +534,8 @@ Config::RParams& Config::RParams::operator=(Config::RParams&& obj)
 		access_counter = (uint32_t)obj.access_counter;
 		resource_fd = obj.resource_fd;
 		last_resource_access = obj.last_resource_access;
+		header_templates[0] = std::move(obj.header_templates[0]);
+		header_templates[1] = std::move(obj.header_templates[1]);
 
 		obj.expires = 0;
 		obj.resource_size = 0;
@@ -396,8 +555,10 @@ void Config::RParams::lock(const bool resource_lock_shared)
 	{
 		//LOG_DBG("\nLocking shared...");
 		//LOG_DBG("Locking access..");
-		if (pthread_rwlock_rdlock(&access_lock) != 0) {
-			goto err;
+		{
+			std::unique_lock<std::mutex> lock(access_lock);
+			access_cond.wait(lock, [this]() { return !access_writer; });
+			++access_readers;
 		}
 		//LOG_DBG("Locked access");
 
@@ -415,8 +576,10 @@ void Config::RParams::lock(const bool resource_lock_shared)
 	{
 		//LOG_DBG("\nLocking exclusive...");
 		//LOG_DBG("Locking access..");
-		if (pthread_rwlock_wrlock(&access_lock) != 0) {
-			goto err;
+		{
+			std::unique_lock<std::mutex> lock(access_lock);
+			access_cond.wait(lock, [this]() { return (!access_writer && access_readers == 0); });
+			access_writer = true;
 		}
 		//LOG_DBG("Locked access");
 
@@ -441,19 +604,29 @@ err:
 
 void Config::RParams::unlock()
 {
-	if (access_counter == 1)
+	if (access_counter == 0) {
+		return;
+	}
+
+	// Kazdy lock() musi uvolnit sdileny zamek access_lock, souborovy zamek uvolni az posledni drzitel
+	// (pri soubeznych ctenarich by se jinak access_lock neuvolnil a dalsi zapis by cekal navzdy)
+	//LOG_DBG("Decrementing access counter...");
+	if (access_counter.fetch_sub(1) == 1 && resource_fd != -1) {
+		//LOG_DBG("Unlocking file lock...");
+		flock(resource_fd, LOCK_UN);
+	}
+	//LOG_DBG("Unlocking access...");
 	{
-		if (resource_fd != -1) {
-			//LOG_DBG("Unlocking file lock...");
-			flock(resource_fd, LOCK_UN);
+		// Pri exkluzivnim zamku nemuze byt zadny ctenar -> uvolnuje se zapis
+		std::lock_guard<std::mutex> lock(access_lock);
+		if (access_writer) {
+			access_writer = false;
+		}
+		else if (access_readers > 0) {
+			--access_readers;
 		}
-		//LOG_DBG("Unlocking access...");
-		pthread_rwlock_unlock(&access_lock);
-	}
-	if (access_counter > 0) {
-		//LOG_DBG("Decrementing access counter...");
-		access_counter--;
 	}
+	access_cond.notify_all();
 }
 
 void Config::RParams::releaseFileLock()
@@ -492,16 +665,29 @@ void Config::RParams::update()
 		throw WebServerError("Failed to get resource info (file: " + file_path + ")");
 	}
 
-	if (last_modified != st.st_mtime)
+	// Zmena v ramci stejne sekundy se pozna podle ETag (ms) a velikosti -> obsah v cache nesmi zustat stary
+	const ETag new_etag = generateETag(st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+	if (last_modified != st.st_mtime || etag != new_etag || resource_size != static_cast<uint64_t>(st.st_size))
 	{
+		// Nove vytvorene RParams (last_modified = -1) muze odpovidat obsahu v cache, starou verzi odmitne ETag
+		if (last_modified != -1) {
+			FileCache::erase(resource_path);
+		}
 		resource_size = st.st_size;
 		last_modified = st.st_mtime;
-		etag = generateETag(st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+		etag = new_etag;
+		updateHeaderTemplates();
 	}
 
 	updateLastAccess();
 }
 
+void Config::RParams::updateHeaderTemplates()
+{
+	std::atomic_store(&header_templates[0], HttpPacketBuilder::buildHeaderTemplate(*this, HttpVersion::HTTP_1_0));
+	std::atomic_store(&header_templates[1], HttpPacketBuilder::buildHeaderTemplate(*this, HttpVersion::HTTP_1_1));
+}
+
 void Config::RParams::updateLastAccess()
 {
 	last_resource_access = time(NULL);
@@ -0,0 +1,605 @@
+#include "FileCache.hpp"
+#include "Logger.hpp"
+#include "Globals.hpp"
+#include "Codec.hpp"
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+
+#define FILE_CACHE_WINDOW_PERCENT		1  // LRU okno z cele velikosti
+#define FILE_CACHE_PROTECTED_PERCENT	80  // Chranena cast z hlavni casti
+#define FILE_CACHE_AVERAGE_FILE_SIZE	4096  // Odhad poctu resources v cache pro velikost sketche
+#define FILE_CACHE_SKETCH_MIN			1024
+#define FILE_CACHE_SKETCH_MAX			(1 << 22)
+#define FILE_CACHE_SKETCH_ROWS			4
+#define FILE_CACHE_COUNTER_MAX			15
+#define FILE_CACHE_VARIANT_SEPARATOR	'\0'  // Mezi cestou a kodovanim v klici varianty (v ceste byt nemuze)
+
+
+// Kodovani, pro ktera se vytvari varianty (x-gzip pouziva data gzip)
+static const char* variantEncoding(const HttpContentEncoding encoding)
+{
+	switch (encoding)
+	{
+		case HttpContentEncoding::GZIP:
+		case HttpContentEncoding::X_GZIP:
+			return "gzip";
+		case HttpContentEncoding::DEFLATE:
+			return "deflate";
+		default:
+			return nullptr;
+	}
+}
+
+
+FileCache FileCache::obj_;
+
+
+void FileCache::FrequencySketch::resize(const size_t counters)
+{
+	size_t size = FILE_CACHE_SKETCH_MIN;
+	while (size < counters && size < FILE_CACHE_SKETCH_MAX) {
+		size <<= 1;
+	}
+
+	table_.assign(size / 16, 0);
+	mask_ = size - 1;
+	sample_size_ = 10 * static_cast<uint64_t>(size);
+	additions_ = 0;
+}
+
+void FileCache::FrequencySketch::clear()
+{
+	std::fill(table_.begin(), table_.end(), 0);
+	additions_ = 0;
+}
+
+size_t FileCache::FrequencySketch::counterIndex(const uint64_t hash, const size_t row) const
+{
+	static constexpr uint64_t seeds[FILE_CACHE_SKETCH_ROWS] = {
+		0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL, 0x9ae16a3b2f90404fULL, 0xcbf29ce484222325ULL };
+	uint64_t h = (hash ^ seeds[row]) * 0x9E3779B97F4A7C15ULL;
+	h ^= (h >> 32);
+	return static_cast<size_t>(h) & mask_;
+}
+
+void FileCache::FrequencySketch::increment(const uint64_t hash)
+{
+	if (table_.empty()) {
+		return;
+	}
+
+	bool added = false;
+	for (size_t row = 0; row < FILE_CACHE_SKETCH_ROWS; ++row)
+	{
+		const size_t index = counterIndex(hash, row);
+		uint64_t& word = table_[index >> 4];
+		const unsigned shift = (index & 15) * 4;
+		if (((word >> shift) & 0xf) < FILE_CACHE_COUNTER_MAX)
+		{
+			word += (1ULL << shift);
+			added = true;
+		}
+	}
+
+	// Starnuti -> drivejsi popularita casem prestane stacit na udrzeni v cache
+	if (added && ++additions_ >= sample_size_)
+	{
+		for (uint64_t& word : table_) {
+			word = (word >> 1) & 0x7777777777777777ULL;
+		}
+		additions_ /= 2;
+	}
+}
+
+uint32_t FileCache::FrequencySketch::frequency(const uint64_t hash) const
+{
+	if (table_.empty()) {
+		return 0;
+	}
+
+	uint32_t frequency = FILE_CACHE_COUNTER_MAX;
+	for (size_t row = 0; row < FILE_CACHE_SKETCH_ROWS; ++row)
+	{
+		const size_t index = counterIndex(hash, row);
+		frequency = std::min(frequency, static_cast<uint32_t>((table_[index >> 4] >> ((index & 15) * 4)) & 0xf));
+	}
+	return frequency;
+}
+
+
+void FileCache::init(const uint64_t max_size, const uint64_t max_file_size, const uint64_t compressed_max_file_size)
+{
+	reset();
+
+	// Varianty z predchoziho behu uz neodpovidaji zadnemu zaznamu
+	if (compressed_max_file_size > 0)
+	{
+		if (mkdir(COMPRESSED_FILES_DIR, 0700) == -1 && errno != EEXIST) {
+			LOG_ERR("Failed to create compressed files directory (error: %s)", strerror(errno));
+		}
+		else if (DIR* dir = opendir(COMPRESSED_FILES_DIR))
+		{
+			while (const struct dirent* file = readdir(dir))
+			{
+				if (file->d_name[0] != '.') {
+					removeVariantFile(file->d_name);
+				}
+			}
+			closedir(dir);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(obj_.mutex_);
+	obj_.max_size_ = max_size;
+	obj_.max_file_size_ = std::min(max_file_size, max_size);
+	obj_.compressed_max_file_size_ = compressed_max_file_size;
+	obj_.window_max_size_ = max_size * FILE_CACHE_WINDOW_PERCENT / 100;
+	obj_.protected_max_size_ = (max_size - obj_.window_max_size_) * FILE_CACHE_PROTECTED_PERCENT / 100;
+	obj_.sketch_.resize((max_size > 0) ? static_cast<size_t>(std::min<uint64_t>(max_size / FILE_CACHE_AVERAGE_FILE_SIZE, FILE_CACHE_SKETCH_MAX)) : 0);
+}
+
+void FileCache::reset()
+{
+	std::lock_guard<std::mutex> lock(obj_.mutex_);
+	obj_.entries_.clear();
+	obj_.window_.clear();
+	obj_.probation_.clear();
+	obj_.protected_.clear();
+	obj_.window_size_ = 0;
+	obj_.probation_size_ = 0;
+	obj_.protected_size_ = 0;
+	obj_.sketch_.clear();
+	obj_.stats_ = Stats();
+	obj_.compressing_.clear();  // Naplanovane vytvoreni variant zastaveny pool uz nespusti
+	obj_.removeSpilledVariants();
+}
+
+std::shared_ptr<const std::string> FileCache::get(const Config::RParams& rparam)
+{
+	if (obj_.max_size_ == 0 || rparam.resource_size == 0 || rparam.resource_size > obj_.max_file_size_ ||
+		rparam.resource_fd == -1 || rparam.etag.empty())
+	{
+		return nullptr;
+	}
+
+	const uint64_t hash = std::hash<std::string>()(rparam.resource_path);
+	{
+		std::lock_guard<std::mutex> lock(obj_.mutex_);
+		obj_.sketch_.increment(hash);
+
+		std::shared_ptr<const std::string> data = obj_.find(rparam.resource_path, rparam.etag);
+		if (data)
+		{
+			obj_.stats_.hits++;
+			return data;
+		}
+		obj_.stats_.misses++;
+	}
+
+	// Soubor se cte mimo zamek cache (resource je zamceny -> obsah odpovida etag)
+	std::shared_ptr<const std::string> data = readResource(rparam);
+	if (!data) {
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(obj_.mutex_);
+	return obj_.insert(rparam.resource_path, rparam.etag, hash, std::move(data));
+}
+
+FileCache::Variant FileCache::getCompressed(const Config::RParams& rparam, const HttpContentEncoding encoding, bool& build)
+{
+	Variant variant;
+	build = false;
+	const char* encoding_name = variantEncoding(encoding);
+	if (!encoding_name || rparam.resource_size == 0 || rparam.resource_size > obj_.compressed_max_file_size_ ||
+		rparam.resource_fd == -1 || rparam.etag.empty())
+	{
+		return variant;
+	}
+
+	const std::string key = variantKey(rparam.resource_path, encoding_name);
+	const uint64_t hash = std::hash<std::string>()(key);
+	std::lock_guard<std::mutex> lock(obj_.mutex_);
+	obj_.sketch_.increment(hash);
+
+	variant.data = obj_.find(key, rparam.etag);
+	if (variant.data)
+	{
+		obj_.stats_.hits++;
+		variant.size = variant.data->size();
+		return variant;
+	}
+
+	const auto spilled_it = obj_.spilled_.find(key);
+	if (spilled_it != obj_.spilled_.end() && spilled_it->second.etag == rparam.etag)
+	{
+		obj_.stats_.hits++;
+		variant.file_path = std::string(COMPRESSED_FILES_REL_DIR) + "/" + spilled_it->second.file_name;
+		variant.size = spilled_it->second.size;
+		return variant;
+	}
+	obj_.stats_.misses++;
+
+	// Variantu vytvori jen prvni request, ktery ji nenasel (dalsi se do te doby zakoduji pri odesilani)
+	build = obj_.compressing_.insert(key).second;
+	return variant;
+}
+
+void FileCache::buildCompressed(const std::string& resource_path, const HttpContentEncoding encoding, const ETag& etag)
+{
+	const char* encoding_name = variantEncoding(encoding);
+	if (!encoding_name) {
+		return;
+	}
+
+	const std::string key = variantKey(resource_path, encoding_name);
+	const uint64_t hash = std::hash<std::string>()(key);
+	std::string file_name;
+	{
+		std::lock_guard<std::mutex> lock(obj_.mutex_);
+		file_name = std::to_string(++obj_.spilled_counter_) + "." + encoding_name;
+	}
+
+	// Komprese jednou s nejvyssim stupnem (mimo zamek cache), velka varianta se ulozi do souboru
+	// Resource mezitim neni zamceny -> cte se podle cesty a jina verze nez etag se zahodi
+	std::shared_ptr<std::string> compressed = std::make_shared<std::string>();
+	std::shared_ptr<const std::string> data = readResource(resource_path, etag);
+	bool compressed_ok = (data && Codec::compress_data(*compressed, data->data(), data->size(), 
+		(strcmp(encoding_name, "gzip") == 0), Z_BEST_COMPRESSION));
+	const bool read_ok = (data != nullptr);  // Jinak se resource mezitim zmenil (novou verzi vytvori dalsi request)
+	data.reset();
+
+	const bool spill = (compressed->size() > obj_.max_file_size_);
+	if (compressed_ok && spill) {
+		compressed_ok = writeVariant(file_name, *compressed);
+	}
+
+	std::lock_guard<std::mutex> lock(obj_.mutex_);
+	obj_.compressing_.erase(key);
+	if (!compressed_ok)
+	{
+		if (read_ok)
+		{
+			LOG_ERR("Failed to create compressed variant of resource (resource: %s, encoding: %s)", 
+				resource_path.c_str(), encoding_name);
+		}
+		return;
+	}
+
+	obj_.stats_.compressions++;
+	if (spill)
+	{
+		SpilledVariant& spilled = obj_.spilled_[key];
+		if (!spilled.file_name.empty()) {
+			removeVariantFile(spilled.file_name);
+		}
+		spilled.etag = etag;
+		spilled.file_name = file_name;
+		spilled.size = compressed->size();
+	}
+	else {
+		obj_.insert(key, etag, hash, std::move(compressed));
+	}
+}
+
+void FileCache::cancelCompressed(const std::string& resource_path, const HttpContentEncoding encoding)
+{
+	const char* encoding_name = variantEncoding(encoding);
+	if (!encoding_name) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(obj_.mutex_);
+	obj_.compressing_.erase(variantKey(resource_path, encoding_name));
+}
+
+void FileCache::erase(const std::string& resource_path)
+{
+	std::lock_guard<std::mutex> lock(obj_.mutex_);
+	obj_.eraseKey(resource_path);
+	for (const HttpContentEncoding encoding : { HttpContentEncoding::GZIP, HttpContentEncoding::DEFLATE }) {
+		obj_.eraseKey(variantKey(resource_path, variantEncoding(encoding)));
+	}
+}
+
+FileCache::Stats FileCache::stats()
+{
+	std::lock_guard<std::mutex> lock(obj_.mutex_);
+	Stats stats = obj_.stats_;
+	stats.size = obj_.window_size_ + obj_.probation_size_ + obj_.protected_size_;
+	stats.entries = obj_.entries_.size();
+	return stats;
+}
+
+
+std::shared_ptr<const std::string> FileCache::find(const std::string& key, const ETag& etag)
+{
+	const auto entry_it = entries_.find(key);
+	if (entry_it == entries_.end()) {
+		return nullptr;
+	}
+
+	// Starsi verze resource -> uz se nepouzije
+	const EntryList::iterator entry = entry_it->second;
+	if (entry->etag != etag)
+	{
+		remove(entry, false);
+		return nullptr;
+	}
+
+	hit(entry);
+	return entry->data;
+}
+
+std::shared_ptr<const std::string> FileCache::insert(const std::string& key, const ETag& etag, const uint64_t hash, std::shared_ptr<const std::string> data)
+{
+	// Mezitim ho nacetlo jine vlakno
+	const auto entry_it = entries_.find(key);
+	if (entry_it != entries_.end())
+	{
+		if (entry_it->second->etag == etag) {
+			return entry_it->second->data;
+		}
+		remove(entry_it->second, false);
+	}
+
+	window_.push_front(Entry{ key, etag, data, hash, Segment::WINDOW });
+	window_size_ += entrySize(window_.front());
+	entries_.emplace(key, window_.begin());
+	evictFromWindow();
+
+	// I kdyz resource nebyl prijat, tato odpoved se posle z nacteneho obsahu
+	return data;
+}
+
+void FileCache::hit(EntryList::iterator entry)
+{
+	switch (entry->segment)
+	{
+		case Segment::WINDOW:
+			window_.splice(window_.begin(), window_, entry);
+			break;
+
+		case Segment::PROBATION:
+		{
+			// Opakovany pristup -> do chranene casti, z ni se nejdele nepouzity vraci zpet na zkusebni
+			const uint64_t size = entrySize(*entry);
+			protected_.splice(protected_.begin(), probation_, entry);
+			entry->segment = Segment::PROTECTED;
+			probation_size_ -= size;
+			protected_size_ += size;
+
+			while (protected_size_ > protected_max_size_ && protected_.size() > 1)
+			{
+				const EntryList::iterator demoted = std::prev(protected_.end());
+				const uint64_t demoted_size = entrySize(*demoted);
+				probation_.splice(probation_.begin(), protected_, demoted);
+				demoted->segment = Segment::PROBATION;
+				protected_size_ -= demoted_size;
+				probation_size_ += demoted_size;
+			}
+			break;
+		}
+
+		case Segment::PROTECTED:
+			protected_.splice(protected_.begin(), protected_, entry);
+			break;
+	}
+}
+
+void FileCache::evictFromWindow()
+{
+	while (window_size_ > window_max_size_ && !window_.empty())
+	{
+		const EntryList::iterator candidate = std::prev(window_.end());
+		const uint64_t size = entrySize(*candidate);
+		probation_.splice(probation_.begin(), window_, candidate);
+		candidate->segment = Segment::PROBATION;
+		window_size_ -= size;
+		probation_size_ += size;
+		admit(candidate);
+	}
+}
+
+void FileCache::admit(EntryList::iterator candidate)
+{
+	const uint64_t main_max_size = max_size_ - window_max_size_;
+	const uint32_t candidate_frequency = sketch_.frequency(candidate->hash);
+
+	if (entrySize(*candidate) > main_max_size)
+	{
+		remove(candidate, true);
+		return;
+	}
+
+	// Kandidat z okna vytlaci obet jen pokud byl pouzivan casteji (jinak by jednorazove pristupy vyprazdnily cache)
+	while (probation_size_ + protected_size_ > main_max_size)
+	{
+		EntryList::iterator victim;
+		if (std::prev(probation_.end()) != candidate) {
+			victim = std::prev(probation_.end());
+		}
+		else if (!protected_.empty()) {
+			victim = std::prev(protected_.end());
+		}
+		else
+		{
+			remove(candidate, true);
+			return;
+		}
+
+		if (candidate_frequency <= sketch_.frequency(victim->hash))
+		{
+			remove(candidate, true);
+			return;
+		}
+		remove(victim, true);
+	}
+}
+
+void FileCache::remove(EntryList::iterator entry, const bool eviction)
+{
+	segmentSize(entry->segment) -= entrySize(*entry);
+	entries_.erase(entry->key);
+	segmentList(entry->segment).erase(entry);
+	if (eviction) {
+		stats_.evictions++;
+	}
+}
+
+void FileCache::eraseKey(const std::string& key)
+{
+	const auto entry_it = entries_.find(key);
+	if (entry_it != entries_.end()) {
+		remove(entry_it->second, false);
+	}
+
+	const auto spilled_it = spilled_.find(key);
+	if (spilled_it != spilled_.end())
+	{
+		removeVariantFile(spilled_it->second.file_name);
+		spilled_.erase(spilled_it);
+	}
+}
+
+void FileCache::removeSpilledVariants()
+{
+	for (const auto& spilled : spilled_) {
+		removeVariantFile(spilled.second.file_name);
+	}
+	spilled_.clear();
+}
+
+FileCache::EntryList& FileCache::segmentList(const Segment segment)
+{
+	switch (segment)
+	{
+		case Segment::WINDOW: return window_;
+		case Segment::PROBATION: return probation_;
+		default: return protected_;
+	}
+}
+
+uint64_t& FileCache::segmentSize(const Segment segment)
+{
+	switch (segment)
+	{
+		case Segment::WINDOW: return window_size_;
+		case Segment::PROBATION: return probation_size_;
+		default: return protected_size_;
+	}
+}
+
+uint64_t FileCache::entrySize(const Entry& entry)
+{
+	return entry.data->size() + entry.key.size() + entry.etag.size();
+}
+
+std::shared_ptr<const std::string> FileCache::readResource(const Config::RParams& rparam)
+{
+	std::shared_ptr<std::string> data = std::make_shared<std::string>(rparam.resource_size, '\0');
+	uint64_t read_bytes = 0;
+	while (read_bytes < rparam.resource_size)
+	{
+		const ssize_t ret = pread(rparam.resource_fd, &(*data)[read_bytes], rparam.resource_size - read_bytes, read_bytes);
+		if (ret == -1 && errno == EINTR) {
+			continue;
+		}
+		if (ret <= 0)
+		{
+			LOG_ERR("Failed to read resource to file cache (resource: %s)", rparam.resource_path.c_str());
+			return nullptr;
+		}
+		read_bytes += static_cast<uint64_t>(ret);
+	}
+	return data;
+}
+
+std::shared_ptr<const std::string> FileCache::readResource(const std::string& resource_path, const ETag& etag)
+{
+	const std::string file_path = std::string(RESOURCES_DIR) + "/" + resource_path;
+	const int fd = open(file_path.c_str(), O_RDONLY | O_NOCTTY);
+	if (fd == -1) {
+		return nullptr;
+	}
+
+	// Verze podle casu modifikace pred ctenim i po nem (resource se muze prepsat na miste, ne jen nahradit souborem)
+	struct stat st = {0};
+	const auto matches = [fd, &etag, &st]() {
+		return (fstat(fd, &st) == 0 && Config::RParams::generateETag(st.st_mtim.tv_sec, st.st_mtim.tv_nsec) == etag);
+	};
+	std::shared_ptr<std::string> data;
+	if (matches())
+	{
+		data = std::make_shared<std::string>(static_cast<size_t>(st.st_size), '\0');
+		uint64_t read_bytes = 0;
+		while (read_bytes < data->size())
+		{
+			const ssize_t ret = pread(fd, &(*data)[read_bytes], data->size() - read_bytes, read_bytes);
+			if (ret == -1 && errno == EINTR) {
+				continue;
+			}
+			if (ret <= 0)
+			{
+				data.reset();
+				break;
+			}
+			read_bytes += static_cast<uint64_t>(ret);
+		}
+		if (data && !matches()) {
+			data.reset();
+		}
+	}
+	close(fd);
+	return data;
+}
+
+std::string FileCache::variantKey(const std::string& resource_path, const char* encoding)
+{
+	std::string key = resource_path;
+	key += FILE_CACHE_VARIANT_SEPARATOR;
+	key += encoding;
+	return key;
+}
+
+bool FileCache::writeVariant(const std::string& file_name, const std::string& data)
+{
+	const std::string file_path = std::string(COMPRESSED_FILES_DIR) + "/" + file_name;
+	const int fd = open(file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0600);
+	if (fd == -1) {
+		return false;
+	}
+
+	size_t written = 0;
+	while (written < data.size())
+	{
+		const ssize_t ret = write(fd, data.data() + written, data.size() - written);
+		if (ret == -1 && errno == EINTR) {
+			continue;
+		}
+		if (ret <= 0)
+		{
+			close(fd);
+			unlink(file_path.c_str());
+			return false;
+		}
+		written += static_cast<size_t>(ret);
+	}
+
+	close(fd);
+	return true;
+}
+
+void FileCache::removeVariantFile(const std::string& file_name)
+{
+	unlink((std::string(COMPRESSED_FILES_DIR) + "/" + file_name).c_str());
+}
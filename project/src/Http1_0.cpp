@@ -2,9 +2,11 @@
 #include "HttpPacketBuilder.hpp"
 #include "Logger.hpp"
 #include "Configuration.hpp"
+#include "FileCache.hpp"
 #include "Globals.hpp"
 #include "HttpGlobal.hpp"
 #include "Codec.hpp"
+#include "TextScan.hpp"
 #include "WebServerError.hpp"
 #include <sys/mman.h>
 #include <errno.h>
@@ -15,6 +17,9 @@
 #include <algorithm>
 
 
+#define BULK_TRANSFER_SIZE (1024 * 1024)    // Request s vetsim telem nebo odpovedi se zpracovava jako bulk task [B]
+
+
 Http1_0::Http1_0(const std::shared_ptr<TcpServer>& tcp_server, std::shared_ptr<TcpServer::Connection>& connection) :
     Http(tcp_server, connection, HttpVersion::HTTP_1_0),
     packet_builder_(http_version_, false),
@@ -35,8 +40,17 @@ void Http1_0::reset()
 
     boundary_.clear();
     file_name_.clear();
+    request_header_.clear();
+    parser_.reset();
     request_data_.clear();
-    resetHttpRequest(request_);
+}
+
+void Http1_0::setRequest(std::string&& request_header, HttpRequestParser&& parser)
+{
+    // Pohledy parseru se presmeruji do vlastni kopie hlavicky
+    request_header_ = std::move(request_header);
+    parser_ = std::move(parser);
+    parser_.bind(request_header_);
 }
 
 /*
@@ -52,20 +66,15 @@ void Http1_0::reset()
         Server,
 */
 
-bool Http1_0::getHeaderField(const char* field_name)
+bool Http1_0::getHeaderField(const HttpHeaderField field)
 {
-    header_field_ = std::find_if(request_.headers.cbegin(), request_.headers.cend(), 
-    [field_name](const httpparser::Request::HeaderItem& header_item)
-    {
-        return (strcasecmp(field_name, header_item.name.c_str()) == 0);
-    });
-
-    return (header_field_ != request_.headers.cend());
+    header_field_ = parser_.request().header(field);
+    return (header_field_ != nullptr);
 }
 
 int Http1_0::headersAcceptEncoding()
 {
-    if (getHeaderField("Accept-Encoding"))
+    if (getHeaderField(HttpHeaderField::ACCEPT_ENCODING))
     {
         const auto* content_enc = httpContentEncoding(header_field_->value, true);
         if (!content_enc)
@@ -78,8 +87,16 @@ int Http1_0::headersAcceptEncoding()
         if (Config::params().prefer_content_encoding) 
         {
             packet_builder_.packet().header().contentEncoding(content_enc->first);
+
+            // Predkomprimovana varianta -> odesle se hotova se skutecnou delkou (pri odesilani se uz nekomprimuje)
+            if (useCompressedVariant(content_enc->second)) {
+                return 1;
+            }
+
             content_encoding_str_ = content_enc->first;
             content_encoding_ = content_enc->second;
+            // Data zakodovana pri odesilani nejsou bajt po bajtu stejna jako varianta -> jen slaby validator
+            setEncodedETag(content_enc->second, true);
         }
 
         return 1;
@@ -88,18 +105,80 @@ int Http1_0::headersAcceptEncoding()
     return 0;
 }
 
+bool Http1_0::useCompressedVariant(const HttpContentEncoding encoding)
+{
+    if (!rparam_) {
+        return false;
+    }
+
+    bool build = false;
+    const FileCache::Variant variant = FileCache::getCompressed(*rparam_, encoding, build);
+    if (build)
+    {
+        // Variantu vytvori vlakno poolu az bude volno (pomala komprese nebrzdi odpoved), do te doby se koduje pri odesilani
+        const std::string resource_path = rparam_->resource_path;
+        const ETag etag = rparam_->etag;
+        if (!this->tcp_server_->queueBackgroundTask([resource_path, encoding, etag]() {
+            FileCache::buildCompressed(resource_path, encoding, etag);
+        }))
+        {
+            FileCache::cancelCompressed(resource_path, encoding);
+        }
+    }
+    if (!variant.isSet()) {
+        return false;
+    }
+
+    HttpPacket& packet = packet_builder_.packet();
+    packet.header().removeContentLength();
+    packet.header().contentLength(variant.size);
+    setEncodedETag(encoding, false);
+    if (variant.data) {
+        packet.body().addData(variant.data);
+    }
+    else {
+        packet.body().addFile(variant.file_path, variant.size);
+    }
+    return true;
+}
+
+void Http1_0::setEncodedETag(const HttpContentEncoding encoding, const bool weak)
+{
+    if (!rparam_) {
+        return;
+    }
+
+    HttpPacket::Header& pheader = packet_builder_.packet().header();
+    pheader.removeEtag();
+    pheader.etag(httpEncodedETag(rparam_->etag, encoding, weak));
+}
+
+ETag Http1_0::negotiatedETag()
+{
+    if (Config::params().prefer_content_encoding && getHeaderField(HttpHeaderField::ACCEPT_ENCODING))
+    {
+        // Zda se posle varianta nebo data kodovana pri odesilani zde neni zname -> slaby validator
+        const auto* content_enc = httpContentEncoding(header_field_->value, true);
+        if (content_enc) {
+            return httpEncodedETag(rparam_->etag, content_enc->second, true);
+        }
+    }
+
+    return rparam_->etag;
+}
+
 int Http1_0::headersIfModifiedSince()
 {
-    if (getHeaderField("If-Modified-Since"))
+    if (getHeaderField(HttpHeaderField::IF_MODIFIED_SINCE))
     {
         // Kontrola formatu datumu
         struct tm gmt = {0};
-        if (strptime(header_field_->value.c_str(), HTTP_DATE_FORMAT, &gmt) != NULL)
+        if (strptime(header_field_->value.data(), HTTP_DATE_FORMAT, &gmt) != NULL)
         {
             // Kontrola zda byl modifikovan
             if (rparam_->last_modified == mktime(&gmt))
             {
-                packet_builder_sp_.buildNotModified(rparam_);
+                packet_builder_sp_.buildNotModified(rparam_, negotiatedETag());
                 status_page_ = true;
                 return -1;
             }
@@ -120,19 +199,11 @@ int Http1_0::headersIfModifiedSince()
 
 int Http1_0::headersContentLength(uint64_t* content_length)
 {
-    if (getHeaderField("Content-Length")) 
+    if (getHeaderField(HttpHeaderField::CONTENT_LENGTH)) 
     {
-        errno = 0;
-        const uint64_t content_len = strtoull(header_field_->value.c_str(), NULL, 10);
-        if (errno == EINVAL || errno == ERANGE)  // Poskytnuta hodnota Content-Length neni validni
-        {
-            packet_builder_sp_.buildBadRequest();
-            status_page_ = true;
-            return -1;
-        }
-
+        // Hodnotu zkontroloval parser (nevalidni nebo vicenasobny Content-Length je nevalidni hlavicka)
         if (content_length) {
-            *content_length = content_len;
+            *content_length = parser_.request().content_length;
         }
 
         return 1;
@@ -151,9 +222,9 @@ int Http1_0::headersContentType()
     // v PUT, POST requestu. Server si muze odvodit typ sam dle pripony souboru v URI. Pokud ani to neni tak je soubor ve formatu "application/octet-stream".
     // Tohle asi nebudu podporovat, proste tam musi byt --> nove teda podporuju odvozeni Content-Type z pripony resource uvedenem v URI
 
-    if (getHeaderField("Content-Type")) 
+    if (getHeaderField(HttpHeaderField::CONTENT_TYPE)) 
     {
-        const std::string& content_type = header_field_->value;
+        const std::string_view content_type = header_field_->value;
         const size_t semicolon_ind = content_type.find(';');
         const size_t charset_ind = content_type.find("charset=");
         const std::string boundary_str = "boundary=";
@@ -217,7 +288,7 @@ int Http1_0::headersContentType()
 
 int Http1_0::headersContentEncoding()
 {
-    if (getHeaderField("Content-Encoding"))
+    if (getHeaderField(HttpHeaderField::CONTENT_ENCODING))
     {
         const auto* content_enc = httpContentEncoding(header_field_->value, false);
         if (!content_enc)
@@ -282,12 +353,6 @@ bool Http1_0::requestPostMethod()
 
 bool Http1_0::requestPostMethodFunc()
 {
-    /*Pokud nebyly ulozeny data tela HTTP requestu do dosacneho souboru, 
-    tak jsou v request_data_ a pro dalsi zpracovani je musim odstranit*/
-    if (!temp_file_->data_in_temp_file_) {
-        removeRequestDataHeaders();
-    }
-
     if (!this->storeResource(nullptr, *temp_file_, 
         file_name_, request_data_.data(), request_data_.size())) 
     {
@@ -335,6 +400,8 @@ bool Http1_0::requestPutMethodFunc()
         return false;
     }
 
+    // Novy obsah muze mit stejny cas zmeny i velikost (a tedy ETag) -> update() by obsah v cache nezahodil
+    FileCache::erase(rparam_->resource_path);
     const_cast<Config::RParams*>(rparam_)->update();
 
     if (file_existed) {
@@ -357,7 +424,65 @@ bool Http1_0::requestDeleteMethod()
         Pripadne dodelat Authorization
     */
 
-    return requestDeleteMethodFunc();
+    // Smazani resource ve vlakne pro diskove operace
+    this->offloadStorage([this]() { this->requestDeleteMethodFunc(); });
+    return true;
+}
+
+bool Http1_0::offloadStorage(TcpServer::Task&& task)
+{
+    // Ulozeni nebo smazani resource (fsync, rename, remove) probehne ve vlakne pro diskove operace (telo requestu uz je prijate)
+    // -> vlakno obsluhy se uvolni a pripravenou odpoved odesle az pri dalsim spusteni obsluhy
+    TcpServer::Task storage_task = [this, task = std::move(task)]() mutable
+    {
+        try {
+            task();
+        }
+        catch (const std::exception& exc)
+        {
+            LOG_ERR("Error: %s", exc.what());
+            packet_builder_sp_.buildInternalServerError();
+            status_page_ = true;
+        }
+
+        // Zamek resource se uvolni hned (vlakna obsluhy cekajici na resource by jinak blokovala i odeslani teto odpovedi)
+        if (rparam_)
+        {
+            const_cast<Config::RParams*>(rparam_)->unlock();
+            rparam_ = nullptr;
+        }
+    };
+
+    if (tcp_server_->offloadConnection(tcp_connection_, std::move(storage_task)))
+    {
+        storage_offloaded_ = true;
+        return true;
+    }
+
+    storage_task();
+    return false;
+}
+
+bool Http1_0::resumeStorage()
+{
+    // Obsluha se spustila znovu po dokonceni diskovych operaci -> zbyva odeslat pripravenou odpoved
+    if (!storage_offloaded_) {
+        return false;
+    }
+
+    storage_offloaded_ = false;
+    return true;
+}
+
+bool Http1_0::resumeRequestBody()
+{
+    // Obsluha se spustila znovu, protoze data tela, na ktera cekala, uz jsou v bufferu spojeni
+    if (!body_suspended_) {
+        return false;
+    }
+
+    body_suspended_ = false;
+    return true;
 }
 
 bool Http1_0::requestDeleteMethodFunc()
@@ -389,21 +514,36 @@ void Http1_0::handleConnection()
             int ret;
             //LOG_DBG("Running Http1_0::handleConnection...");
 
-            // Vytvorit adresar pro temp files
-            if (!this->createTempDirectory()) 
-            {
-                packet_builder_sp_.buildInternalServerError();
-                status_page_ = true;
+            if (this->resumeStorage()) {
                 goto send_response;
             }
 
-            // Vygenerovat nazev pro temp file
-            this->generateTempFilePath(0);
-            temp_file_ = &temp_files_.at(0);
+            // Pokracovat v prijmu tela requestu
+            if (this->resumeRequestBody()) {
+                ret = receiveRequestBodyPutData();
+            }
+            else
+            {
+                // Vytvorit adresar pro temp files
+                if (!this->createTempDirectory()) 
+                {
+                    packet_builder_sp_.buildInternalServerError();
+                    status_page_ = true;
+                    goto send_response;
+                }
 
-            // Prijmout request
-            ret = receiveRequest();
-            if (ret == 0) {
+                // Vygenerovat nazev pro temp file
+                this->generateTempFilePath(0);
+                temp_file_ = &temp_files_.at(0);
+
+                // Prijmout request
+                ret = receiveRequest();
+            }
+            if (ret == 2) {
+                // Odpoved se odesle po dokonceni diskovych operaci, nebo se ceka na dalsi cast tela
+                return;
+            }
+            else if (ret == 0) {
                 goto end_conn;
             }
             else if (ret == -1) {
@@ -423,6 +563,9 @@ void Http1_0::handleConnection()
                 this->requestDeleteMethod();
                 break;
             }
+            if (storage_offloaded_) {
+                return;
+            }
 
     send_response:
             // Poslat odpoved
@@ -553,34 +696,61 @@ int Http1_0::sendFileChunk(const uint64_t offset, const int file_fd, const uint3
         {        
             char chunk_size_hex[50];
             snprintf(chunk_size_hex, sizeof(chunk_size_hex), "%zX\r\n", send_size);
-            ret = tcp_server_->sendText(this->tcp_connection_, chunk_size_hex, strlen(chunk_size_hex));
-            if (ret != 1) {
-                goto end_send;
-            }
+            tcp_server_->queueText(this->tcp_connection_, chunk_size_hex, strlen(chunk_size_hex), true);
         }
     }
 
-    ret = tcp_server_->sendText(this->tcp_connection_, 
-        static_cast<const char*>(data_to_send), send_size);
-    if (ret <= 0) {
-        goto end_send;
-    }
+    // Velikost chunku, data i jejich zakonceni jednim zapisem (mapovani se uvolni az po odeslani)
+    tcp_server_->queueText(this->tcp_connection_, 
+        static_cast<const char*>(data_to_send), send_size, false);
 
     if (content_encoding_ != HttpContentEncoding::NONE &&
         http_version_ != HttpVersion::HTTP_1_0) {
-        ret = tcp_server_->sendText(this->tcp_connection_, "\r\n");
+        tcp_server_->queueText(this->tcp_connection_, "\r\n", 2, false);
     }
 
+    ret = tcp_server_->flushText(this->tcp_connection_);
+
 end_send:
     munmap(mapping, mapping_size);
     return ret;
 }
 
 
+int Http1_0::sendFileData(const int file_fd, const uint64_t offset, const uint64_t size)
+{
+    // Bez komprese a userspace TLS -> zero-copy sendfile() z page cache primo do socketu (pripadne pres kTLS)
+    if (content_encoding_ == HttpContentEncoding::NONE && 
+        tcp_server_->supportsSendFile(this->tcp_connection_)) 
+    {
+        return tcp_server_->sendFile(this->tcp_connection_, file_fd, offset, size);
+    }
+
+    // Jinak po castech (komprese kazde casti, sifrovani v OpenSSL)
+    uint64_t sent_bytes = 0;
+    while (sent_bytes < size)
+    {
+        const uint64_t chunk_size = std::min(size - sent_bytes, 
+                static_cast<uint64_t>(Config::params().file_chunk_size)); 
+
+        const int send_ret = sendFileChunk(offset + sent_bytes, file_fd, static_cast<uint32_t>(chunk_size));
+        if (send_ret != 1) {
+            return send_ret;
+        }
+
+        sent_bytes += chunk_size;
+    }
+
+    return 1;
+}
+
+
 bool Http1_0::sendResponse(HttpPacketBase& packetb)
 {
     HttpPacket& packet = dynamic_cast<HttpPacket&>(packetb);
     const HttpPacket::Body::Data* packet_body;
+    std::shared_ptr<const std::string> cached_body;  // Drzi obsah z file cache az do odeslani
+    std::string dec_data;
     int file_fd = -1;
 
     // Kontrola zda neposilam prazdny packet
@@ -598,27 +768,35 @@ bool Http1_0::sendResponse(HttpPacketBase& packetb)
             packet.header().transferEncoding(content_encoding_str_ + ", chunked");
             packet.header().end();
         }
+        // HTTP/1.0 -> delka komprimovanych dat neni predem znama, konec tela urci uzavreni spojeni
+        else
+        {
+            packet.header().removeEnd();
+            packet.header().removeContentLength();
+            packet.header().end();
+        }
     }
 
-    // Odeslani hlavicky packetu
+    // Hlavicka, telo i zakonceni se radi do vystupni fronty spojeni a odesilaji se najednou
+    // (data ve fronte se nekopiruji -> musi byt platna az do flushText)
     int send_ret;
-    if ((send_ret = tcp_server_->sendText(this->tcp_connection_, 
-        packet.header().data())) == -1) 
-    {
-        goto err;
-    }
-    else if (send_ret == 0) {
-        return true;
-    }
+    tcp_server_->queueText(this->tcp_connection_, packet.header().data(), false);
 
     // Odeslani tela packetu
     packet_body = &packet.body().data();
-    if (!packet_body->is_file_ && !packet_body->data_.empty())  // Odesilam jen pokud ma telo packetu nejaka data
+
+    // Zamceny resource tohoto requestu -> obsah z file cache (odesle se spolu s hlavickou jako data v pameti)
+    if (packet_body->is_file_ && !packet.header().isHeadMethod() && 
+        rparam_ && packet_body->file_fd_ != -1 && packet_body->file_fd_ == rparam_->resource_fd) 
     {
-        const std::string* data_to_send = &packet_body->data_;
+        cached_body = FileCache::get(*rparam_);
+    }
+
+    if ((!packet_body->is_file_ && !packet_body->memoryData().empty()) || cached_body)  // Odesilam jen pokud ma telo packetu nejaka data
+    {
+        const std::string* data_to_send = ((cached_body) ? cached_body.get() : &packet_body->memoryData());
 
         // Kompresovat data
-        std::string dec_data;
         if (content_encoding_ != HttpContentEncoding::NONE)
         {
             if (!compressDataToSend(dec_data, 
@@ -632,76 +810,41 @@ bool Http1_0::sendResponse(HttpPacketBase& packetb)
             {
                 char chunk_size_hex[50];
                 snprintf(chunk_size_hex, sizeof(chunk_size_hex), "%zX\r\n", data_to_send->size());
-                send_ret = tcp_server_->sendText(this->tcp_connection_, chunk_size_hex, strlen(chunk_size_hex));
-                if (send_ret == -1) {
-                    goto err;
-                }
-                else if (send_ret == 0) {
-                    return true;
-                }
+                tcp_server_->queueText(this->tcp_connection_, chunk_size_hex, strlen(chunk_size_hex), true);
             }
         }
 
-        // Odeslani dat
-        send_ret = tcp_server_->sendText(this->tcp_connection_, *data_to_send);
-        if (send_ret == -1) {
-            goto err;
-        }
-        else if (send_ret == 0) {
-            return true;
-        }
+        tcp_server_->queueText(this->tcp_connection_, *data_to_send, false);
 
         if (content_encoding_ != HttpContentEncoding::NONE &&
             http_version_ != HttpVersion::HTTP_1_0) 
         {
-            send_ret = tcp_server_->sendText(this->tcp_connection_, "\r\n");
-            if (send_ret == -1) {
-                goto err;
-            }
-            else if (send_ret == 0) {
-                return true;
-            }
+            tcp_server_->queueText(this->tcp_connection_, "\r\n", 2, false);
         }
     }
     // Odesilam soubor jen pokud ho mam odesilat, tedy i prave pokud odpovidam na HEAD request
     else if (packet_body->is_file_ && !packet.header().isHeadMethod())
     {
-        file_fd = open(packet_body->data_.c_str(), O_RDONLY | O_NOCTTY);
-        if (file_fd == -1) 
+        // Resource je uz otevreny v RParams (a zamceny) -> neotevirat ho znovu
+        int send_fd = packet_body->file_fd_;
+        if (send_fd == -1)
         {
-            LOG_ERR("Failed to open file to send (file: %s)", packet_body->data_.c_str());
-            goto err;
-        }
-
-        uint64_t sent_bytes = 0;
-        uint64_t chunk_size;
-        while (sent_bytes < packet_body->content_length_)
-        {
-            chunk_size = std::min(packet_body->content_length_ - sent_bytes, 
-                    static_cast<uint64_t>(Config::params().file_chunk_size)); 
-
-            send_ret = sendFileChunk(sent_bytes, file_fd, static_cast<uint32_t>(chunk_size));
-            if (send_ret == -1)
+            file_fd = open(packet_body->data_.c_str(), O_RDONLY | O_NOCTTY);
+            if (file_fd == -1) 
             {
-                close(file_fd);
+                LOG_ERR("Failed to open file to send (file: %s)", packet_body->data_.c_str());
                 goto err;
             }
-            else if (send_ret == 0) {
-                close(file_fd);
-                return true;
-            }
+            send_fd = file_fd;
+        }
 
-            sent_bytes += chunk_size;
+        send_ret = sendFileData(send_fd, 0, packet_body->content_length_);
+        if (file_fd != -1) 
+        {
+            close(file_fd);
+            file_fd = -1;
         }
-    
-        close(file_fd);
-    }
 
-    // Zakonceni transfer encoding
-    if (content_encoding_ != HttpContentEncoding::NONE &&
-        http_version_ != HttpVersion::HTTP_1_0) 
-    {
-        send_ret = tcp_server_->sendText(this->tcp_connection_, "0\r\n\r\n");
         if (send_ret == -1) {
             goto err;
         }
@@ -710,9 +853,23 @@ bool Http1_0::sendResponse(HttpPacketBase& packetb)
         }
     }
 
+    // Zakonceni transfer encoding
+    if (content_encoding_ != HttpContentEncoding::NONE &&
+        http_version_ != HttpVersion::HTTP_1_0) 
+    {
+        tcp_server_->queueText(this->tcp_connection_, "0\r\n\r\n", 5, false);
+    }
+
+    // Odeslani vseho, co zbylo ve fronte (u malych odpovedi cela odpoved jednim zapisem)
+    send_ret = tcp_server_->flushText(this->tcp_connection_);
+    if (send_ret == -1) {
+        goto err;
+    }
+
     return true;
 
 err:
+    tcp_server_->discardText(this->tcp_connection_);
     // V pripade chyby behem zasilani dat jednoduse jen vratim z funkce false a uzivateli nic nesdeluju -> prohlizec bude cekat dokud nedostane vsechna data, ale nikdy je nedostane (-> refresh)
     if (file_fd != -1) { close(file_fd); }
     return false;
@@ -723,34 +880,32 @@ int Http1_0::receiveRequest()
 {
     //LOG_DBG("Http1_0::receiveRequest()...");
 
-    std::string buffer;
     int ret;
 
-    // Nacteni hlavicky HTTP requestu
-    ret = this->tcp_server_->receiveText(this->tcp_connection_, buffer, 
-        Config::params().max_header_size, HEADERS_END, false);
-    ret = receiveRetCheck(ret, -1);
-    if (ret != 1) {
-        return ret;
+    // Nacteni a rozparsovani hlavicky HTTP requestu (prvni request spojeni uz prijal WebServer pri urceni verze HTTP)
+    if (!parser_.isCompleted())
+    {
+        ret = this->tcp_server_->receiveHeader(this->tcp_connection_, request_header_, 
+            Config::params().max_header_size, parser_);
+        // Nevalidni nebo prilis velka hlavicka zustava v bufferu spojeni (zacatek dalsiho requestu nelze urcit) -> po odpovedi ukoncit spojeni
+        if (ret == -3 || ret == -2)
+        {
+            if (ret == -3) { packet_builder_sp_.buildBadRequest(false); }
+            else { packet_builder_sp_.buildContentTooLarge(false); }
+            status_page_ = true;
+            return -1;
+        }
+        ret = receiveRetCheck(ret, -1);
+        if (ret != 1) {
+            return ret;
+        }
     }
 
     //LOG_DBG("Http1_0::receiveRequest(term) got data (ret: %d)", ret);
-    ////LOG_DBG("Headers end index: %z", (size_t) buffer.find(HEADERS_END));
-    LOG_DBG("Recvd data: %s\n", buffer.c_str());
+    LOG_DBG("Recvd header: %zu B\n", request_header_.size());
 
-    // Prekopirovani hlavicky
-    request_data_ = std::move(buffer);
-
-    // Rozparsovani a kontrola HTTP requestu
-    httpparser::Request request;
-    if (!httpParseRequest(request_data_, request))
-    {
-        packet_builder_sp_.buildBadRequest();
-        status_page_ = true;
-        return -1;
-    }
-    moveHttpRequest(request_, request);
-    request_uri_ = request_.uri;
+    const HttpRequestParser::Request& request = parser_.request();
+    request_uri_.assign(request.uri);
 
     if (request_uri_.empty()) {
         packet_builder_sp_.buildBadRequest();
@@ -765,7 +920,7 @@ int Http1_0::receiveRequest()
     ////LOG_DBG("URI: %s", request_uri_.c_str());
         
     // Nacteni HTTP metody requestu
-    request_method_ = httpMethod(request_.method, this->http_version_);
+    request_method_ = httpMethod(request.method, this->http_version_);
     if (request_method_ == HttpMethod::NOT_ALLOWED)
     {
         packet_builder_sp_.buildNotImplemented();
@@ -803,11 +958,30 @@ int Http1_0::receiveRequest()
         return -1;
     }
     //LOG_DBG("checkResourceConstraints() done");
+
+    classifyRequest();
     
     // Zda budu prijimat i telo HTTP requestu (metody POST, PUT)
     return receiveRequestBody();
 }
 
+void Http1_0::classifyRequest()
+{
+    // Velky upload nebo soubor by dlouho drzel vlakno -> bulk, aby nezdrzoval kratke requesty
+    uint64_t transfer_size = 0;
+    if (request_method_ == HttpMethod::PUT || request_method_ == HttpMethod::POST)
+    {
+        transfer_size = parser_.request().content_length;
+    }
+    else if (request_method_ == HttpMethod::GET && rparam_) {
+        transfer_size = rparam_->resource_size;
+    }
+
+    if (transfer_size > BULK_TRANSFER_SIZE) {
+        tcp_server_->setPriority(tcp_connection_, ThreadPool::TaskPriority::BULK);
+    }
+}
+
 int Http1_0::receiveRequestBody()
 {
     // Zjistit HTTP metodu
@@ -826,11 +1000,8 @@ int Http1_0::receiveRequestBody()
         }
 
         int ret = receiveRequestBodyPostMethod();
-        if (ret == -1) {
-            return -1;
-        }
-        else if (ret == 0) {
-            return 0;
+        if (ret != 1) {
+            return ret;
         }
     }
     else if (request_method_ == HttpMethod::PUT) 
@@ -840,11 +1011,8 @@ int Http1_0::receiveRequestBody()
         }
 
         int ret = receiveRequestBodyPutMethod();
-        if (ret == -1) {
-            return -1;
-        }
-        else if (ret == 0) {
-            return 0;
+        if (ret != 1) {
+            return ret;
         }
     }
 
@@ -901,11 +1069,11 @@ int Http1_0::receiveRequestBodyPutMethod()
     //LOG_DBG("Length processed");
 
     // Kontrola toho zda neni telo HTTP requestu vetsi nez nastavena velikost bufferu pro prijem tela
-    int temporary_file_fd;
+    body_file_fd_ = -1;
     if (content_length > Config::params().client_body_buffer_size)
     {
         // Pokud je, tak ukladam do temporary file
-        if (!this->createTemporaryFile(temporary_file_fd, *const_cast<Http::TempFile*>(temp_file_))) 
+        if (!this->createTemporaryFile(body_file_fd_, *const_cast<Http::TempFile*>(temp_file_))) 
         {
             packet_builder_sp_.buildInternalServerError();
             status_page_ = true;
@@ -913,15 +1081,35 @@ int Http1_0::receiveRequestBodyPutMethod()
         }
     }
 
-    // Nacteni tela HTTP requestu
-    uint64_t total = 0;
+    body_length_ = content_length;
+    body_received_ = 0;
+    return receiveRequestBodyPutData();
+}
+
+int Http1_0::receiveRequestBodyPutData()
+{
+    // Nacteni (zbytku) tela HTTP requestu
+    const uint64_t content_length = body_length_;
+    const int temporary_file_fd = body_file_fd_;
+    uint64_t total = body_received_;
     std::string buffer;
 
     while (total < content_length)
     {
         buffer.resize(std::min(content_length, static_cast<uint64_t>(Config::params().client_body_buffer_size)));
         const uint64_t chunk_size = std::min(buffer.size(), content_length - total);
-        int ret = this->tcp_server_->receiveText(this->tcp_connection_, buffer, chunk_size, false);
+
+        // Cast tela jeste neprisla -> vlakno se uvolni a obsluha pokracuje az bude v bufferu spojeni
+        int ret = this->tcp_server_->awaitInput(this->tcp_connection_, chunk_size);
+        if (ret == 2)
+        {
+            body_received_ = total;
+            body_suspended_ = true;
+            return 2;
+        }
+        else if (ret == 1) {
+            ret = this->tcp_server_->receiveText(this->tcp_connection_, buffer, chunk_size, false);
+        }
         ret = receiveRetCheck(ret, temporary_file_fd);
         if (ret != 1) {
             return ret;
@@ -958,37 +1146,37 @@ int Http1_0::receiveRequestBodyPutMethod()
         total += chunk_size;
     }
 
-    if (temp_file_->data_in_temp_file_)
+    // Telo je cele prijate -> fsync a presun do resources ve vlakne pro diskove operace
+    const bool offloaded = this->offloadStorage([this, temporary_file_fd]()
     {
-        if (fsync(temporary_file_fd) == -1)
+        if (temp_file_->data_in_temp_file_)
         {
-            LOG_ERR("Failed to store request body into temp file (error: %s)", strerror(errno));
-            this->deleteTemporaryFile(temporary_file_fd, *temp_file_);
+            if (fsync(temporary_file_fd) == -1)
+            {
+                LOG_ERR("Failed to store request body into temp file (error: %s)", strerror(errno));
+                this->deleteTemporaryFile(temporary_file_fd, *temp_file_);
+                close(temporary_file_fd);
+                packet_builder_sp_.buildInternalServerError();
+                status_page_ = true;
+                return;
+            }
+
             close(temporary_file_fd);
-            packet_builder_sp_.buildInternalServerError();
-            status_page_ = true;
-            return -1;
         }
 
-        close(temporary_file_fd);
-    }
-
-    if (!this->requestPutMethodFunc()) {
-        return -1;
-    }
+        this->requestPutMethodFunc();
+    });
 
-    return 1;
+    return ((offloaded) ? 2 : 1);
 }
 
 int Http1_0::receiveRequestBodyPostMethod()
 {
     static const std::string content_disp = "Content-Disposition:";
-    static const std::string content_disp_filename = "filename=";
     const std::string boundary = "--" + boundary_;
     const std::string end_boundary = boundary + "--";
-    int ret;
 
-    size_t boundary_ind = request_data_.find(boundary);
+    size_t boundary_ind = TextScan::find(request_data_, boundary);
 
     // Kontrola zda POST request nebyl zaslan v hlavicce
     if (boundary_ind != std::string::npos)
@@ -1001,7 +1189,7 @@ int Http1_0::receiveRequestBodyPostMethod()
             return -1;
         }
 
-        const size_t headers_end_ind = request_data_.find(HEADERS_END, cont_disp_ind);
+        const size_t headers_end_ind = TextScan::find(request_data_, HEADERS_END, cont_disp_ind);
         if (headers_end_ind == std::string::npos)
         {
             packet_builder_sp_.buildBadRequest();
@@ -1009,28 +1197,22 @@ int Http1_0::receiveRequestBodyPostMethod()
             return -1;
         }
 
-        ret = httpCheckContentDisposition(request_data_.substr(cont_disp_ind, headers_end_ind-cont_disp_ind));
-        if (ret == -1)
-        {
-            packet_builder_sp_.buildInternalServerError();
-            status_page_ = true;
-            return -1;
-        }
-        else if (ret == -2)
+        // Radek Content-Disposition (za nim mohou byt dalsi hlavicky casti, napr. Content-Type)
+        const size_t cont_disp_end_ind = request_data_.find(HEADERS_ENDLINE, cont_disp_ind);
+        std::string_view field_name;
+        std::string_view file_name;
+        if (!httpParseContentDisposition(std::string_view(request_data_).substr(cont_disp_ind, cont_disp_end_ind-cont_disp_ind), 
+            field_name, file_name)) 
         {
             return 1;
         }
-
-        const size_t filename_ind = request_data_.find(content_disp_filename, cont_disp_ind);
-        const size_t quote1_ind = request_data_.find("\"", filename_ind);
-        const size_t quote2_ind = request_data_.find("\"", quote1_ind+1);
-        file_name_ = request_data_.substr(quote1_ind+1, quote2_ind-quote1_ind+1);
+        file_name_ = file_name;
 
         // Ulozim telo
         std::string resource_data;
         const size_t value_ind = headers_end_ind+strlen(HEADERS_END);
 
-        boundary_ind = request_data_.find(boundary, value_ind);
+        boundary_ind = TextScan::find(request_data_, boundary, value_ind);
         if (boundary_ind == std::string::npos)
         {
             packet_builder_sp_.buildBadRequest();
@@ -1041,32 +1223,25 @@ int Http1_0::receiveRequestBodyPostMethod()
         resource_data = request_data_.substr(value_ind, boundary_ind-value_ind);
         request_data_ = std::move(resource_data);
 
-        if (!this->requestPutMethodFunc()) {
-            return -1;
-        }
-
-        // Vyndani poslednich dat
+        // Vyndani poslednich dat (jeste pred ulozenim, po nem uz se jen odesila odpoved)
         std::string buffer;
         this->tcp_server_->receiveText(this->tcp_connection_, buffer, end_boundary.size(), end_boundary, false);
+
+        // Ulozeni resource ve vlakne pro diskove operace
+        if (this->offloadStorage([this]() { this->requestPutMethodFunc(); })) {
+            return 2;
+        }
     }
 
     return 1;
 }
 
-void Http1_0::removeRequestDataHeaders()
-{
-    const size_t headers_end_ind = request_data_.find(HEADERS_END);
-    const size_t erase_count = headers_end_ind + sizeof(HEADERS_END) - 1;
-    request_data_.erase(0, erase_count);
-}
-
-
 bool Http1_0::checkResourceConstraints()
 {
     if (rparam_)
     {
         // Kontrola HTTP metody
-        const auto meth_it = std::find(rparam_->methods_allowed.cbegin(), rparam_->methods_allowed.cend(), request_.method);
+        const auto meth_it = std::find(rparam_->methods_allowed.cbegin(), rparam_->methods_allowed.cend(), parser_.request().method);
         if (meth_it == rparam_->methods_allowed.cend())
         {
             packet_builder_sp_.buildMethodNotAllowed(rparam_);
@@ -1085,7 +1260,7 @@ bool Http1_0::prepareRequestUri()
 
     if (request_uri_ == HTTP_ASTERISK) 
     {
-        if (request_.method != HTTP_METHOD_OPTIONS)
+        if (parser_.request().method != HTTP_METHOD_OPTIONS)
         {
             packet_builder_sp_.buildBadRequest();
             status_page_ = true;
@@ -1111,25 +1286,3 @@ bool Http1_0::prepareRequestUri()
 
     return true;
 }
-
-void Http1_0::moveHttpRequest(httpparser::Request& req, const httpparser::Request& req2)
-{
-	req.method = std::move(req2.method);
-	req.uri = std::move(req2.uri);
-	req.versionMajor = req2.versionMajor;
-	req.versionMinor = req2.versionMinor;
-	req.headers = std::move(req2.headers);
-    req.content = std::move(req2.content);
-	req.keepAlive = req2.keepAlive;
-}
-
-void Http1_0::resetHttpRequest(httpparser::Request& req)
-{
-    req.method.clear();
-	req.uri.clear();
-	req.versionMajor = 0;
-	req.versionMinor = 0;
-	req.headers.clear();
-    req.content.clear();
-	req.keepAlive = false;
-}
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "Http1_1.hpp"
 #include "Configuration.hpp"
+#include "FileCache.hpp"
 #include "Logger.hpp"
 #include <string.h>
 #include <unistd.h>
@@ -21,23 +22,24 @@ void Http1_1::reset()
     this->packet_builder_.setHttpVersion(HttpVersion::HTTP_1_1);
     this->packet_builder_sp_.setHttpVersion(HttpVersion::HTTP_1_1);
     ranges_.clear();
+    range_parts_.clear();
 }
 
 
 int Http1_1::headersIfRange()
 {
-    if (getHeaderField("If-Range"))
+    if (getHeaderField(HttpHeaderField::IF_RANGE))
     {
         // Kontrola datumu
         struct tm gmt = {0};
-        if (strptime(header_field_->value.c_str(), HTTP_DATE_FORMAT, &gmt) != NULL)
+        if (strptime(header_field_->value.data(), HTTP_DATE_FORMAT, &gmt) != NULL)
         {
             if (rparam_->last_modified == mktime(&gmt)) {
                 return 1;
             }
         }
 
-        // Kontrola ETag
+        // Kontrola ETag (rozsahy se posilaji jen z identity dat -> ETag kodovane reprezentace neodpovida)
         if (header_field_->value == rparam_->etag) {
             return 1;
         }
@@ -50,114 +52,28 @@ int Http1_1::headersIfRange()
 
 int Http1_1::headersRange(const bool parse_ranges)
 {
-    if (getHeaderField("Range"))
+    if (getHeaderField(HttpHeaderField::RANGE))
     {
-        int ret = httpCheckRangeHeader(header_field_->value.c_str());
-        if (ret == -1)
+        if (!httpParseRangeHeader(header_field_->value, parse_ranges ? &ranges_ : nullptr))
         {
-            //LOG_DBG("Failed to compile regex (range header)");
-            packet_builder_sp_.buildInternalServerError();
-            status_page_ = true;
-            return -1;
-        }
-        else if (ret == -2)
-        {
-            //LOG_DBG("Failed to match request line with regex (range header)");
+            //LOG_DBG("Invalid range header");
             packet_builder_sp_.buildBadRequest();
             status_page_ = true;
             return -1;
         }
 
+        // Kontrola rozsahu (416 jen pokud nelze splnit zadny)
         if (parse_ranges)
         {
-            // Ziskani rozsahu
-            std::vector<std::string> ranges_str;
-            const char* delimiters = ", ";
-            const char* bytes_str = "bytes=";
-
-            char ranges_cpy[header_field_->value.size() - strlen(bytes_str) + 1] = {0};
-            strncpy(ranges_cpy, header_field_->value.c_str()+strlen(bytes_str), 
-                header_field_->value.size()-strlen(bytes_str));
-
-            char* saveptr = nullptr;
-            char* token = strtok_r(ranges_cpy, delimiters, &saveptr);
-            if (token == nullptr) {
-                ranges_str.push_back(ranges_cpy);
-            }
-            else
+            // Prilis mnoho rozsahu -> Range se ignoruje a posle se cely resource
+            if (ranges_.size() > HTTP_RANGES_MAX)
             {
-                do
-                {
-                    ranges_str.push_back(token);
-                    token = strtok_r(nullptr, delimiters, &saveptr);
-                } while (token != nullptr);
+                ranges_.clear();
+                return 0;
             }
 
-            // Kontrola rozsahu
-            ranges_.resize(ranges_str.size());
-            for (size_t i = 0; i < ranges_str.size(); ++i)
-            {
-                const std::string& rstr = ranges_str[i];
-                Range& range = ranges_[i];
-
-                if (rstr.front() == '-')
-                {
-                    errno = 0;
-                    uint64_t val = strtoull(rstr.substr(1).c_str(), NULL, 10);
-                    if (errno == EINVAL || errno == ERANGE || 
-                        val > rparam_->resource_size) 
-                    {
-                        goto range_not_satisfiable;
-                    }
-
-                    range.end = val;
-                    range.type = RangeType::SUFFIX_LENGTH;
-                }
-
-                else if (rstr.back() == '-')
-                {
-                    errno = 0;
-                    uint64_t val = strtoull(rstr.substr(0, rstr.size()-1).c_str(), NULL, 10);
-                    if (errno == EINVAL || errno == ERANGE || 
-                        val >= rparam_->resource_size)
-                    {
-                        goto range_not_satisfiable;
-                    }
-
-                    range.start = val;
-                    range.type = RangeType::START_INF;
-                }
-
-                else
-                {
-                    const size_t range_ind = rstr.find('-');
-                    if (range_ind == std::string::npos) {
-                        goto range_not_satisfiable;
-                    }
-
-                    errno = 0;
-                    uint64_t val = strtoull(rstr.substr(0, range_ind).c_str(), NULL, 10);
-                    if (errno == EINVAL || errno == ERANGE || 
-                        val >= rparam_->resource_size) 
-                    {
-                        goto range_not_satisfiable;
-                    }
-                    
-                    uint64_t val2 = strtoull(rstr.substr(range_ind+1).c_str(), NULL, 10);
-                    if (errno == EINVAL || errno == ERANGE || 
-                        val2 >= rparam_->resource_size)
-                    {
-                        goto range_not_satisfiable;
-                    }
-
-                    if (val > val2) {
-                        goto range_not_satisfiable;
-                    }
-
-                    range.start = val;
-                    range.end = val2;
-                    range.type = RangeType::START_END;
-                }
+            if (!httpCoalesceRanges(ranges_, rparam_->resource_size) || ranges_.empty()) {
+                goto range_not_satisfiable;
             }
         }
 
@@ -174,13 +90,13 @@ range_not_satisfiable:
 
 int Http1_1::headersIfMatch()
 {
-    if (getHeaderField("If-Match"))
+    if (getHeaderField(HttpHeaderField::IF_MATCH))
     {
         std::vector<std::string> etags;
 
         static const char* delimiters = ", ";
         char hfield_etags_cpy[header_field_->value.size() + 1] = {0};
-        strncpy(hfield_etags_cpy, header_field_->value.c_str(), header_field_->value.size());
+        strncpy(hfield_etags_cpy, header_field_->value.data(), header_field_->value.size());
         char* saveptr = nullptr;
 
         char* token = strtok_r(hfield_etags_cpy, delimiters, &saveptr);
@@ -196,7 +112,10 @@ int Http1_1::headersIfMatch()
             } while (token != nullptr);
         }
 
-        const auto etag_it = std::find(etags.cbegin(), etags.cend(), rparam_->etag);
+        // Silne porovnani (W/ ETag neodpovida), odpovida i ETag kodovane varianty aktualni verze
+        const auto etag_it = std::find_if(etags.cbegin(), etags.cend(), [this](const std::string& etag) {
+            return httpETagMatches(etag, rparam_->etag, false);
+        });
         if (etag_it == etags.cend())
         {
             packet_builder_sp_.buildPreconditionFailed();
@@ -212,7 +131,7 @@ int Http1_1::headersIfMatch()
 
 int Http1_1::headersIfNoneMatch(const bool rsrc_exists_check)
 {
-    if (getHeaderField("If-None-Match"))
+    if (getHeaderField(HttpHeaderField::IF_NONE_MATCH))
     {
         if (rsrc_exists_check)
         {
@@ -230,7 +149,7 @@ int Http1_1::headersIfNoneMatch(const bool rsrc_exists_check)
         std::vector<std::string> etags;
         static const char* delimiters = ", ";
         char hfield_etags_cpy[header_field_->value.size() + 1] = {0};
-        strncpy(hfield_etags_cpy, header_field_->value.c_str(), header_field_->value.size());
+        strncpy(hfield_etags_cpy, header_field_->value.data(), header_field_->value.size());
         char* saveptr = nullptr;
 
         char* token = strtok_r(hfield_etags_cpy, delimiters, &saveptr);
@@ -246,10 +165,13 @@ int Http1_1::headersIfNoneMatch(const bool rsrc_exists_check)
             } while (token != nullptr);
         }
 
-        const auto etag_it = std::find(etags.cbegin(), etags.cend(), rparam_->etag);
+        // Slabe porovnani, 304 nese ETag reprezentace, kterou klient ma (identity nebo kodovanou)
+        const auto etag_it = std::find_if(etags.cbegin(), etags.cend(), [this](const std::string& etag) {
+            return httpETagMatches(etag, rparam_->etag, true);
+        });
         if (etag_it != etags.cend())
         {
-            packet_builder_sp_.buildNotModified(rparam_);
+            packet_builder_sp_.buildNotModified(rparam_, *etag_it);
             status_page_ = true;
             return -1;
         }
@@ -263,11 +185,11 @@ int Http1_1::headersIfNoneMatch(const bool rsrc_exists_check)
 
 int Http1_1::headersIfUnmodifiedSince()
 {
-    if (getHeaderField("If-Unmodified-Since"))
+    if (getHeaderField(HttpHeaderField::IF_UNMODIFIED_SINCE))
     {
         // Kontrola formatu datumu
         struct tm gmt = {0};
-        if (strptime(header_field_->value.c_str(), HTTP_DATE_FORMAT, &gmt) != NULL)
+        if (strptime(header_field_->value.data(), HTTP_DATE_FORMAT, &gmt) != NULL)
         {
             if (rparam_->last_modified != mktime(&gmt))
             {
@@ -287,7 +209,7 @@ int Http1_1::headersIfUnmodifiedSince()
 
 int Http1_1::headersExpect()
 {
-    if (getHeaderField("Expect"))
+    if (getHeaderField(HttpHeaderField::EXPECT))
     {
         if (header_field_->value != "100-continue") 
         {
@@ -348,16 +270,18 @@ bool Http1_1::requestGetMethod()
     if (ret == -1) { return false; }
     else if (ret == 1) 
     {
-        ret = headersIfRange();
-        if (ret == -1) { 
-            return false; 
+        // If-Range neodpovida aktualni verzi resource -> Range se ignoruje a posle se cely resource
+        if (headersIfRange() == -1) {
+            ranges_.clear();
         }
-        else if (ret == 1)
+        else
         {
             packet_builder_.reset();
-            packet_builder_.setEndHeaders(false);
             packet_builder_.setHttpVersion(this->http_version_);
-            packet_builder_.createCommonHeaders(const_cast<Config::RParams*>(rparam_), HttpStatusCode::PARTIAL_CONTENT, false, true);
+            packet_builder_.buildPartialContent(rparam_, ranges_, range_parts_);
+
+            // Rozsahy se vztahuji k datum bez content coding -> Accept-Encoding se neuplatni
+            return true;
         }
     }
 
@@ -416,7 +340,10 @@ bool Http1_1::requestDeleteMethod()
 {
     if (headersIfMatch() == -1) { return false; }
     if (headersIfUnmodifiedSince() == -1) { return false; }
-    return requestDeleteMethodFunc();
+
+    // Smazani resource ve vlakne pro diskove operace
+    this->offloadStorage([this]() { this->requestDeleteMethodFunc(); });
+    return true;
 }
 
 // Muze odeslat 200 OK nebo 204 No Content, ale je lepsi odesilat 200 OK primo s Content-Lenght a Content-Type
@@ -433,167 +360,183 @@ bool Http1_1::requestOptionsMethod()
 
 void Http1_1::handleConnection()
 {
-    //LOG_DBG("Http1_0::handleConnection");
+    //LOG_DBG("Http1_1::handleConnection");
 
-    // Vytvorit adresar pro temp files
-    if (!this->createTempDirectory()) 
+    // Spojeni je udrzovano event loopem TcpServeru, zde se zpracuje vzdy jen jeden prijaty request
+    bool end_conn = false;
+    bool storage_done = false;
+
+    // Vytvorit adresar pro temp files (pri prvnim requestu spojeni)
+    if (temp_files_dir_.empty() && !this->createTempDirectory()) 
     {
         packet_builder_sp_.buildInternalServerError();
         this->sendResponse(packet_builder_sp_.packet());
+        this->endConnection();
         return;
     }
 
-    // Udrzovani spojeni
-    while (isConnected())
+    try
     {
-        try
-        {
-            bool end_conn = false;
-            int ret;
-            //LOG_DBG("Running Http1_1::handleConnection...");
+        int ret;
+        //LOG_DBG("Running Http1_1::handleConnection...");
 
+        // Odpoved requestu, ktery ulozil nebo smazal resource (resource uz je odemceny)
+        storage_done = this->resumeStorage();
+        if (storage_done) {
+            goto send_response;
+        }
+
+        // Pokracovat v prijmu tela requestu
+        if (this->resumeRequestBody()) {
+            ret = receiveRequestBodyPutData();
+        }
+        else
+        {
             // Vygenerovat nazev pro temp file
             this->generateTempFilePath(0);
             temp_file_ = &temp_files_.at(0);
 
             // Prijmout request
             ret = receiveRequest();
-            if (ret == 0) {
-                //LOG_DBG("Http1_1: receiveRequest() --> end_connection");
-                end_conn = true;
-            }
-            else if (ret == -1) {
-                //LOG_DBG("Http1_1: receiveRequest() --> send_response");
-                goto send_response;
-            }
+        }
+        if (ret == 2) {
+            // Odpoved se odesle po dokonceni diskovych operaci, nebo se ceka na dalsi cast tela
+            return;
+        }
+        else if (ret == 0) {
+            //LOG_DBG("Http1_1: receiveRequest() --> end_connection");
+            end_conn = true;
+        }
+        else if (ret == -1) {
+            //LOG_DBG("Http1_1: receiveRequest() --> send_response");
+            goto send_response;
+        }
 
-            // Sestaveni odpovedi na zaklade metody HTTP requestu
-            switch (request_method_)
-            {
-            case HttpMethod::GET:
-                this->requestGetMethod();
-                break;
-            case HttpMethod::HEAD:
-                this->requestHeadMethod();
-                break;
-            case HttpMethod::DELETE:
-                this->requestDeleteMethod();
-                break;
-            case HttpMethod::OPTIONS:
-                this->requestOptionsMethod();
-                break;
-            }
+        // Sestaveni odpovedi na zaklade metody HTTP requestu
+        switch (request_method_)
+        {
+        case HttpMethod::GET:
+            this->requestGetMethod();
+            break;
+        case HttpMethod::HEAD:
+            this->requestHeadMethod();
+            break;
+        case HttpMethod::DELETE:
+            this->requestDeleteMethod();
+            break;
+        case HttpMethod::OPTIONS:
+            this->requestOptionsMethod();
+            break;
+        }
+        if (storage_offloaded_) {
+            return;
+        }
 
-    send_response:
-            // Poslat odpoved
-            if (status_page_)
-            {
-                this->sendResponse(packet_builder_sp_.packet());
+send_response:
+        // Poslat odpoved
+        if (status_page_)
+        {
+            this->sendResponse(packet_builder_sp_.packet());
 
-                bool remove_orparam = true;
-                if (rparam_)
+            // Po diskovych operacich uz je resource odemceny (rparam_ == nullptr), POST resource nezamyka vubec
+            bool remove_orparam = true;
+            if (rparam_ || (storage_done && request_method_ != HttpMethod::POST))
+            {
+                HttpStatusCode hsc = 
+                    packet_builder_sp_.packet().header().statusCode();
+                switch (hsc)
                 {
-                    HttpStatusCode hsc = 
-                        packet_builder_sp_.packet().header().statusCode();
-                    switch (hsc)
-                    {
-                        case HttpStatusCode::CONTINUE:
-                        case HttpStatusCode::OK:
-                        case HttpStatusCode::CREATED:
-                        case HttpStatusCode::NO_CONTENT:
-                        case HttpStatusCode::PARTIAL_CONTENT:
-                        case HttpStatusCode::NOT_MODIFIED:
-                            remove_orparam = false;
-                            break;
-                    }
-                    if (remove_orparam) 
-                    {
-                        Config::orparamsRemove(rparam_);
-                        rparam_ = nullptr;
-                    }
+                    case HttpStatusCode::CONTINUE:
+                    case HttpStatusCode::OK:
+                    case HttpStatusCode::CREATED:
+                    case HttpStatusCode::NO_CONTENT:
+                    case HttpStatusCode::PARTIAL_CONTENT:
+                    case HttpStatusCode::NOT_MODIFIED:
+                        remove_orparam = false;
+                        break;
                 }
-
-                if (packet_builder_.packet().header().isConnectionClosed() 
-                    || request_method_ == HttpMethod::POST
-                    || request_method_ == HttpMethod::PUT) 
+                if (rparam_ && remove_orparam) 
                 {
-                    if (remove_orparam) { 
-                        break;
-                    }
+                    Config::orparamsRemove(rparam_);
+                    rparam_ = nullptr;
                 }
             }
-            
-            else 
-            {
-                //LOG_DBG("send_response: ending packet...");
-                // Prevence vuci tomu yda mam ukoncene header fields v HTTP response
-                if (!packet_builder_.packet().header().hasEnd()) {
-                    packet_builder_.packet().header().end();
-                }
-                //LOG_DBG("send_response: packet ended");
 
-                // Odeslani odpovedi
-                if (!ranges_.empty()) {
-                    //LOG_DBG("Sending ranges in response...");
-                    sendResponseRanges();
-                }
-                else {
-                    //LOG_DBG("send_response: sending packet...");
-                    this->sendResponse(packet_builder_.packet());
-                    //LOG_DBG("send_response: packet sent");
-                }
-
-                // Prevence vuci ponechani resourcu v nekonzistentnim stavu
-                //LOG_DBG("send_response: checking is rparam_ set...");
-                if (rparam_ && !rparam_->isSet()) {
-                    //LOG_DBG("send_response: rparam_ update()...");
-                    const_cast<Config::RParams*>(rparam_)->update();
-                    //LOG_DBG("send_response: rparam_ updated");
+            if (packet_builder_sp_.packet().header().isConnectionClosed() 
+                || packet_builder_.packet().header().isConnectionClosed() 
+                || request_method_ == HttpMethod::POST
+                || request_method_ == HttpMethod::PUT) 
+            {
+                if (remove_orparam) { 
+                    end_conn = true;
                 }
             }
+        }
+        
+        else 
+        {
+            //LOG_DBG("send_response: ending packet...");
+            // Prevence vuci tomu yda mam ukoncene header fields v HTTP response
+            if (!packet_builder_.packet().header().hasEnd()) {
+                packet_builder_.packet().header().end();
+            }
+            //LOG_DBG("send_response: packet ended");
 
-            if (rparam_) 
-            { 
-                //LOG_DBG("Unlocking rparam...");
-                const_cast<Config::RParams*>(rparam_)->unlock();
-                //LOG_DBG("Unlocked rparam");
-                rparam_ = nullptr;
+            // Odeslani odpovedi
+            if (!ranges_.empty()) {
+                //LOG_DBG("Sending ranges in response...");
+                sendResponseRanges();
+            }
+            else {
+                //LOG_DBG("send_response: sending packet...");
+                this->sendResponse(packet_builder_.packet());
+                //LOG_DBG("send_response: packet sent");
             }
 
-            if (end_conn) {
-                break;
+            // Prevence vuci ponechani resourcu v nekonzistentnim stavu
+            //LOG_DBG("send_response: checking is rparam_ set...");
+            if (rparam_ && !rparam_->isSet()) {
+                //LOG_DBG("send_response: rparam_ update()...");
+                const_cast<Config::RParams*>(rparam_)->update();
+                //LOG_DBG("send_response: rparam_ updated");
             }
-            //LOG_DBG("Http1_1::reset()...");
-            this->reset();
-            //LOG_DBG("Http1_1::reset done");
         }
 
-        catch (const std::exception& exc)
-        {
-            LOG_ERR("Error: %s", exc.what());
-            
-            if (rparam_) 
-            { 
-                const_cast<Config::RParams*>(rparam_)->unlock();
-                rparam_ = nullptr;
-            }
-            packet_builder_sp_.buildInternalServerError();
-            this->sendResponse(packet_builder_sp_.packet());
-            break;
+        if (rparam_) 
+        { 
+            //LOG_DBG("Unlocking rparam...");
+            const_cast<Config::RParams*>(rparam_)->unlock();
+            //LOG_DBG("Unlocked rparam");
+            rparam_ = nullptr;
         }
     }
 
-    try
+    catch (const std::exception& exc)
     {
-        // Ukoncit spojeni
-        //LOG_DBG("Http1_1::Peacfully ending connection...");
+        LOG_ERR("Error: %s", exc.what());
+        
         if (rparam_) 
         { 
-            //LOG_DBG("Unlocking rparam...");
             const_cast<Config::RParams*>(rparam_)->unlock();
             rparam_ = nullptr;
-            //LOG_DBG("Unlocked rparam");
         }
+        packet_builder_sp_.buildInternalServerError();
+        this->sendResponse(packet_builder_sp_.packet());
+        end_conn = true;
+    }
+
+    try
+    {
+        // Spojeni zustava otevrene pro dalsi request (keep-alive)
+        if (!end_conn && isConnected())
+        {
+            //LOG_DBG("Http1_1::reset()...");
+            this->reset();
+            //LOG_DBG("Http1_1::reset done");
+            return;
+        }
+
+        // Ukoncit spojeni
         //LOG_DBG("Http1_1::Ending connection...");
         this->endConnection();
         //LOG_DBG("Http1_1::Ended connection");
@@ -606,95 +549,58 @@ void Http1_1::handleConnection()
 bool Http1_1::sendResponseRanges()
 {
     HttpPacket& packet = packet_builder_.packet();
-    const int file_fd = open(packet.body().data().data_.c_str(), O_RDONLY | O_NOCTTY);
+
+    // Resource je uz otevreny v RParams -> neotevirat ho znovu
+    const int resource_fd = packet.body().data().file_fd_;
+    const int file_fd = (resource_fd != -1) ? 
+        resource_fd : open(packet.body().data().data_.c_str(), O_RDONLY | O_NOCTTY);
     if (file_fd == -1) 
     {
         LOG_ERR("Failed to open file to send (file: %s)", packet.body().data().data_.c_str());
         return false;
     }
 
-    for (const Range& range : ranges_)
+    // Resource v file cache -> rozsahy se radi do fronty primo z pameti
+    std::shared_ptr<const std::string> cached_body;
+    if (rparam_ && resource_fd != -1 && resource_fd == rparam_->resource_fd) {
+        cached_body = FileCache::get(*rparam_);
+    }
+
+    // Jedna odpoved: hlavicka, pripadne oddelovac casti a rozsah souboru (sendFileData -> bez TLS v userspace zero-copy)
+    // Hlavicka a oddelovace ceka ve fronte a odesle se spolu s nasledujicimi daty
+    int send_ret = 1;
+    tcp_server_->queueText(this->tcp_connection_, packet.header().data(), false);
+    for (size_t i = 0; i < ranges_.size() && send_ret == 1; ++i)
     {
-        uint32_t count;
-        uint64_t offset;
-        switch (range.type)
-        {
-        case RangeType::START_END:
-            count = range.end - range.start + 1;
-            offset = range.start;
-            break;
-        case RangeType::START_INF:
-            count = rparam_->resource_size - range.start;
-            offset = range.start;
-            break;
-        case RangeType::SUFFIX_LENGTH:
-            count = range.end;
-            offset = rparam_->resource_size - range.end;
-            break;
+        if (!range_parts_.empty()) {
+            tcp_server_->queueText(this->tcp_connection_, range_parts_[i], false);
         }
-
-        uint64_t sent_bytes = 0;
-        while (sent_bytes < count)
-        {
-            const uint32_t chunk_size = 
-                std::min(count - sent_bytes, static_cast<uint64_t>(Config::params().file_chunk_size));
-
-            packet.header().removeEnd();
-            packet.header().removeContentLength();
-            packet.header().removeContentRange();
-            
-            if (content_encoding_ != HttpContentEncoding::NONE) {
-                packet.header().transferEncoding(content_encoding_str_ + ", chunked");
-            }
-            else { 
-                packet.header().contentLength(chunk_size);
-            }
-            packet.header().contentRange(offset, offset+chunk_size-1, rparam_->resource_size);
-            packet.header().end();
-
-            // Odeslani hlavicky packetu
-            int send_ret;
-            send_ret = tcp_server_->sendText(this->tcp_connection_, packet.header().data());
-            if (send_ret == -1) {
-                goto err;
-            }
-            else if (send_ret == 0) {
-                goto end_send;
-            }
-
-            // Odeslani casti souboru
-            send_ret = sendFileChunk(offset, file_fd, chunk_size);
-            if (send_ret == -1) {
-                goto err;
-            }
-            else if (send_ret == 0) {
-                goto end_send;
-            }
-
-            // Zakonceni transfer encoding
-            if (content_encoding_ != HttpContentEncoding::NONE)
-            {
-                send_ret = tcp_server_->sendText(this->tcp_connection_, "0\r\n\r\n");
-                if (send_ret == -1) {
-                    goto err;
-                }
-                else if (send_ret == 0) {
-                    return true;
-                }
-            }
-
-            sent_bytes += chunk_size;
+        if (cached_body) {
+            tcp_server_->queueText(this->tcp_connection_, cached_body->data() + ranges_[i].start, ranges_[i].end - ranges_[i].start + 1, false);
+        }
+        else {
+            send_ret = sendFileData(file_fd, ranges_[i].start, ranges_[i].end - ranges_[i].start + 1);
         }
     }
 
-end_send:
-    close(file_fd);
-    return true;
+    // Zakonceni multipart/byteranges
+    if (send_ret == 1 && (!range_parts_.empty() || cached_body))
+    {
+        if (!range_parts_.empty()) {
+            tcp_server_->queueText(this->tcp_connection_, range_parts_.back(), false);
+        }
+        send_ret = tcp_server_->flushText(this->tcp_connection_);
+    }
 
-err:
-    //LOG_DBG("Failed to send ranges data");
-    close(file_fd);
-    return false;
+    if (send_ret == -1) 
+    {
+        //LOG_DBG("Failed to send ranges data");
+        tcp_server_->discardText(this->tcp_connection_);
+    }
+    if (resource_fd == -1) {
+        close(file_fd);
+    }
+    return (send_ret != -1);
 }
 
 bool Http1_1::checkResourceConstraints()
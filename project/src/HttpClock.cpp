@@ -0,0 +1,132 @@
+#include "HttpClock.hpp"
+#include <atomic>
+#include <cstdint>
+#include <string.h>
+
+
+#define HTTP_CLOCK_WORDS	((sizeof(HttpClock::Date) + sizeof(uint64_t) - 1) / sizeof(uint64_t))
+#define SECONDS_PER_DAY	86400
+
+
+namespace
+{
+	// Slot se sekvencnim zamkem: stamp = cas << 1, nastaveny nejnizsi bit -> slot se prave prepisuje
+	// Zapisuje se vzdy do neaktivniho ze dvou slotu -> ctenar aktivniho slotu zapis nepotka
+	struct Slot
+	{
+		std::atomic<uint64_t> stamp{ 1 };
+		std::atomic<uint64_t> words[HTTP_CLOCK_WORDS];
+	};
+
+	Slot slots[2];
+	std::atomic<uint32_t> current{ 0 };
+	std::atomic_flag updating = ATOMIC_FLAG_INIT;
+
+	const char day_names[] = "SunMonTueWedThuFriSat";
+	const char month_names[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+	void digits(char* out, uint32_t value, const size_t count)
+	{
+		for (size_t i = count; i > 0; --i)
+		{
+			out[i - 1] = static_cast<char>('0' + value % 10);
+			value /= 10;
+		}
+	}
+
+	void publish(const uint64_t stamp, const HttpClock::Date& date)
+	{
+		uint64_t words[HTTP_CLOCK_WORDS] = {};
+		memcpy(words, date, sizeof(HttpClock::Date));
+
+		const uint32_t next = current.load(std::memory_order_relaxed) ^ 1;
+		Slot& slot = slots[next];
+		slot.stamp.store(stamp | 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (size_t i = 0; i < HTTP_CLOCK_WORDS; ++i) {
+			slot.words[i].store(words[i], std::memory_order_relaxed);
+		}
+		slot.stamp.store(stamp, std::memory_order_release);
+		current.store(next, std::memory_order_release);
+	}
+}
+
+
+time_t HttpClock::now(Date& date)
+{
+	const time_t t = time(nullptr);
+	const uint64_t stamp = static_cast<uint64_t>(t) << 1;
+
+	const Slot& slot = slots[current.load(std::memory_order_acquire)];
+	if (slot.stamp.load(std::memory_order_acquire) == stamp)
+	{
+		uint64_t words[HTTP_CLOCK_WORDS];
+		for (size_t i = 0; i < HTTP_CLOCK_WORDS; ++i) {
+			words[i] = slot.words[i].load(std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		// Slot mezitim nikdo neprepsal -> kopie je cela
+		if (slot.stamp.load(std::memory_order_relaxed) == stamp)
+		{
+			memcpy(date, words, sizeof(Date));
+			return t;
+		}
+	}
+
+	// Nova sekunda -> naformatovat, zverejni jen jedno vlakno (ostatni mezitim formatuji kazde pro sebe)
+	format(t, date);
+	if (!updating.test_and_set(std::memory_order_acquire))
+	{
+		if (slots[current.load(std::memory_order_relaxed)].stamp.load(std::memory_order_relaxed) != stamp) {
+			publish(stamp, date);
+		}
+		updating.clear(std::memory_order_release);
+	}
+	return t;
+}
+
+bool HttpClock::format(const time_t t, Date& date)
+{
+	int64_t days = t / SECONDS_PER_DAY;
+	int64_t seconds = t % SECONDS_PER_DAY;
+	if (seconds < 0)
+	{
+		seconds += SECONDS_PER_DAY;
+		--days;
+	}
+
+	// 1. 1. 1970 byl ctvrtek
+	const int64_t weekday = (days % 7 + 11) % 7;
+
+	// Den, mesic a rok z poctu dnu (kalendar posunuty na zacatek v breznu, cykly po 400 letech)
+	const int64_t shifted_days = days + 719468;
+	const int64_t era = ((shifted_days >= 0) ? shifted_days : shifted_days - 146096) / 146097;
+	const int64_t day_of_era = shifted_days - era * 146097;
+	const int64_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+	const int64_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+	const int64_t month_index = (5 * day_of_year + 2) / 153;  // 0 -> brezen
+	const int64_t day = day_of_year - (153 * month_index + 2) / 5 + 1;
+	const int64_t month = ((month_index < 10) ? month_index + 3 : month_index - 9);
+	const int64_t year = year_of_era + era * 400 + ((month <= 2) ? 1 : 0);
+	if (year < 0 || year > 9999) {
+		return false;
+	}
+
+	// "Sun, 06 Nov 1994 08:49:37 GMT"
+	memcpy(date, day_names + weekday * 3, 3);
+	memcpy(date + 3, ", ", 2);
+	digits(date + 5, static_cast<uint32_t>(day), 2);
+	date[7] = ' ';
+	memcpy(date + 8, month_names + (month - 1) * 3, 3);
+	date[11] = ' ';
+	digits(date + 12, static_cast<uint32_t>(year), 4);
+	date[16] = ' ';
+	digits(date + 17, static_cast<uint32_t>(seconds / 3600), 2);
+	date[19] = ':';
+	digits(date + 20, static_cast<uint32_t>(seconds / 60 % 60), 2);
+	date[22] = ':';
+	digits(date + 23, static_cast<uint32_t>(seconds % 60), 2);
+	memcpy(date + 25, " GMT", 5);
+	return true;
+}
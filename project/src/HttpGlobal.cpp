@@ -1,8 +1,8 @@
 #include "HttpGlobal.hpp"
-#include "httprequestparser.h"
 #include <algorithm>
+#include <vector>
 #include <string.h>
-#include <regex.h>
+#include <ctype.h>
 /// TODO: odendat
 #include "Logger.hpp"
 
@@ -137,8 +137,16 @@ HttpVersion httpVersionStr(const std::string& version)
 	return HttpVersion::UNSUPPORTED;
 }
 
+HttpVersion httpVersionNum(const uint8_t major, const uint8_t minor)
+{
+	if (major == 1 && minor == 0) { return HttpVersion::HTTP_1_0; }
+	else if (major == 1 && minor == 1) { return HttpVersion::HTTP_1_1; }
+	//else if (major == 2 && minor == 0) { return HttpVersion::HTTP_2_0; }
+	return HttpVersion::UNSUPPORTED;
+}
+
 
-HttpMethod httpMethod(const std::string& method, const HttpVersion& version)
+HttpMethod httpMethod(const std::string_view method, const HttpVersion& version)
 {
 	if (method == HTTP_METHOD_GET) { return HttpMethod::GET; }
 	else if (method == HTTP_METHOD_POST) { return HttpMethod::POST; }
@@ -170,7 +178,7 @@ const std::map<std::string, HttpContentEncoding> content_encodings =
 	{ "deflate", HttpContentEncoding::DEFLATE }
 };
 
-const std::pair<const std::string, HttpContentEncoding>* httpContentEncoding(const std::string& encodings, const bool accept_encoding)
+const std::pair<const std::string, HttpContentEncoding>* httpContentEncoding(const std::string_view encodings, const bool accept_encoding)
 {
 	const char* delimiters = ",; \r\n";
 
@@ -180,7 +188,7 @@ const std::pair<const std::string, HttpContentEncoding>* httpContentEncoding(con
 
 	std::vector<std::string> enc;
 	char encodings_cpy[encodings.size() + 1] = {0};
-	strncpy(encodings_cpy, encodings.c_str(), encodings.size());
+	memcpy(encodings_cpy, encodings.data(), encodings.size());
 	char* saveptr = nullptr;
 
     char* token = strtok_r(encodings_cpy, delimiters, &saveptr);
@@ -232,100 +240,210 @@ const std::pair<const std::string, HttpContentEncoding>* httpContentEncoding(con
 }
 
 
-int httpCheckRangeHeader(const std::string& ranges)
+ETag httpEncodedETag(const ETag& etag, const HttpContentEncoding encoding, const bool weak)
 {
-	regex_t regex;
-	if (regcomp(&regex, HTTP_RANGE_HEADER_REGEX_PATTERN, REG_EXTENDED) != 0) {
-		return -1;
+	const char* suffix = nullptr;
+	switch (encoding)
+	{
+		case HttpContentEncoding::GZIP:
+		case HttpContentEncoding::X_GZIP:
+			suffix = "-gz";
+			break;
+		case HttpContentEncoding::DEFLATE:
+			suffix = "-df";
+			break;
+		default:
+			return etag;
 	}
-
-	if (regexec(&regex, ranges.c_str(), 0, NULL, 0) != 0) {
-		return -2;
+	if (etag.size() < 2 || etag.back() != '"') {
+		return etag;
 	}
 
-	return 0;
+	ETag encoded_etag = (weak) ? "W/" : "";
+	encoded_etag.append(etag, 0, etag.size() - 1);
+	encoded_etag.append(suffix);
+	encoded_etag.push_back('"');
+	return encoded_etag;
 }
 
-
-bool httpParseRequest(const std::string& request_data, httpparser::Request& request)
+bool httpETagMatches(std::string_view tag, const ETag& etag, const bool weak)
 {
-	httpparser::HttpRequestParser parser;
-	const httpparser::HttpRequestParser::ParseResult parse_result = 
-		parser.parse(request, request_data.c_str(), request_data.c_str() + request_data.size());
-	
-	if (parse_result != httpparser::HttpRequestParser::ParsingCompleted) {
-		return false;
+	if (tag.substr(0, 2) == "W/")
+	{
+		if (!weak) {
+			return false;
+		}
+		tag.remove_prefix(2);
 	}
 
-	return true;
+	return (tag == etag || tag == httpEncodedETag(etag, HttpContentEncoding::GZIP, false) || 
+		tag == httpEncodedETag(etag, HttpContentEncoding::DEFLATE, false));
 }
 
+// Desitkove cislo od it (aspon jedna cislice), preteceni -> UINT64_MAX
+static bool parseRangeNumber(const char*& it, const char* const end, uint64_t& value)
+{
+	const char* const start = it;
+	value = 0;
+	while (it != end && *it >= '0' && *it <= '9')
+	{
+		const uint64_t digit = *it - '0';
+		value = (value > (UINT64_MAX - digit) / 10) ? UINT64_MAX : (value * 10 + digit);
+		++it;
+	}
+	return (it != start);
+}
 
-int httpCheckRequestLine(const std::string& request_data)
+static void skipOws(const char*& it, const char* const end)
 {
-	const char* patterns[REQUEST_LINE_PATTERN_COUNT] = { 
-		REQUEST_LINE_PATTERN_PART1, 
-		REQUEST_LINE_PATTERN_PART2, 
-		REQUEST_LINE_PATTERN_PART3 
-	};
+	while (it != end && (*it == ' ' || *it == '\t')) {
+		++it;
+	}
+}
 
-	regex_t regex[REQUEST_LINE_PATTERN_COUNT];
-	for (int i = 0; i < REQUEST_LINE_PATTERN_COUNT; ++i) 
-	{
-		if (regcomp(&regex[i], patterns[i], REG_EXTENDED) != 0) {
-			return -1;
-		}
+bool httpParseRangeHeader(const std::string_view value, std::vector<HttpRange>* ranges)
+{
+	static constexpr std::string_view bytes_unit = "bytes=";
+	if (value.substr(0, bytes_unit.size()) != bytes_unit) {
+		return false;
+	}
+
+	if (ranges) {
+		ranges->clear();
 	}
 
-	std::string request_line_parts[REQUEST_LINE_PATTERN_COUNT];
-	size_t last_part_index = 0;
-	for (int i = 1; i <= REQUEST_LINE_PATTERN_COUNT; ++i)
+	const char* it = value.data() + bytes_unit.size();
+	const char* const end = value.data() + value.size();
+	while (true)
 	{
-		if (last_part_index >= request_data.size()) {
-			return -2;
+		HttpRange range;
+		if (it != end && *it == '-')
+		{
+			++it;
+			if (!parseRangeNumber(it, end, range.end)) {
+				return false;
+			}
+			range.type = HttpRangeType::SUFFIX_LENGTH;
 		}
-
-		const size_t part_index = request_data.find(' ', last_part_index);
-		if (part_index == std::string::npos && 
-			i < REQUEST_LINE_PATTERN_COUNT)
+		else
 		{
-			return -2;
+			if (!parseRangeNumber(it, end, range.start) || it == end || *it != '-') {
+				return false;
+			}
+			++it;
+			range.type = (parseRangeNumber(it, end, range.end) ? HttpRangeType::START_END : HttpRangeType::START_INF);
+		}
+
+		if (ranges) {
+			ranges->push_back(range);
 		}
 
-		request_line_parts[i-1] = request_data.substr(last_part_index, part_index);
-		last_part_index = part_index + 1;
+		// Rozsahy oddelene carkou (RFC 7233: 1#byte-range-spec, kolem carky OWS)
+		skipOws(it, end);
+		if (it == end) {
+			return true;
+		}
+		if (*it != ',') {
+			return false;
+		}
+		++it;
+		skipOws(it, end);
 	}
+}
 
-	int ret = 0;
-	for (int i = 0; i < REQUEST_LINE_PATTERN_COUNT; ++i)
+bool httpCoalesceRanges(std::vector<HttpRange>& ranges, const uint64_t resource_size)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < ranges.size(); ++i)
 	{
-		if (regexec(&regex[i], request_line_parts[i].c_str(), 0, NULL, 0) != 0)
+		HttpRange range = ranges[i];
+		switch (range.type)
 		{
-			ret = -3;
-			break;
+			case HttpRangeType::START_END:
+				if (range.start > range.end) {
+					return false;
+				}
+				if (range.start >= resource_size) {
+					continue;
+				}
+				range.end = std::min(range.end, resource_size - 1);
+				break;
+			case HttpRangeType::START_INF:
+				if (range.start >= resource_size) {
+					continue;
+				}
+				range.end = resource_size - 1;
+				break;
+			case HttpRangeType::SUFFIX_LENGTH:
+				if (range.end == 0 || resource_size == 0) {
+					continue;
+				}
+				range.start = resource_size - std::min(range.end, resource_size);
+				range.end = resource_size - 1;
+				break;
 		}
+		range.type = HttpRangeType::START_END;
+		ranges[count++] = range;
 	}
-
-	for (int i = 0; i < REQUEST_LINE_PATTERN_COUNT; ++i) {
-		regfree(&regex[i]);
+	ranges.resize(count);
+	if (ranges.empty()) {
+		return true;
 	}
 
-    return ret;
+	std::sort(ranges.begin(), ranges.end(), [](const HttpRange& a, const HttpRange& b) { return a.start < b.start; });
+	size_t last = 0;
+	for (size_t i = 1; i < ranges.size(); ++i)
+	{
+		if (ranges[i].start <= ranges[last].end + 1) {
+			ranges[last].end = std::max(ranges[last].end, ranges[i].end);
+		}
+		else {
+			ranges[++last] = ranges[i];
+		}
+	}
+	ranges.resize(last + 1);
+	return true;
 }
 
 
-int httpCheckContentDisposition(const std::string& content_disp)
+bool httpParseContentDisposition(const std::string_view content_disp, std::string_view& name, std::string_view& filename)
 {
-	int ret = 0;
-	regex_t regex;
-	if (regcomp(&regex, HTTP_CONTENT_DISPOSITION_PATTERN_FILENAME, REG_EXTENDED) != 0) {
-		return -1;
-	}
-
-	if (regexec(&regex, content_disp.c_str(), 0, NULL, 0) != 0) {
-		ret = -2;
-	}
+	size_t pos = 0;
+	const auto skip_space = [&]() {
+		while (pos < content_disp.size() && isspace(static_cast<unsigned char>(content_disp[pos]))) {
+			++pos;
+		}
+	};
+	const auto expect = [&](const std::string_view token) {
+		if (content_disp.compare(pos, token.size(), token) != 0) {
+			return false;
+		}
+		pos += token.size();
+		return true;
+	};
+	const auto quoted = [&](std::string_view& value) {
+		if (pos >= content_disp.size() || content_disp[pos] != '"') {
+			return false;
+		}
+		const size_t quote_ind = content_disp.find('"', pos + 1);
+		if (quote_ind == std::string_view::npos || quote_ind == pos + 1) {
+			return false;
+		}
+		value = content_disp.substr(pos + 1, quote_ind - pos - 1);
+		pos = quote_ind + 1;
+		return true;
+	};
 
-	regfree(&regex);
-	return ret;
+	// Content-Disposition: form-data; name="..."; filename="..."
+	if (!expect("Content-Disposition:")) { return false; }
+	skip_space();
+	if (!expect("form-data;")) { return false; }
+	skip_space();
+	if (!expect("name=") || !quoted(name)) { return false; }
+	skip_space();
+	if (!expect(";")) { return false; }
+	skip_space();
+	if (!expect("filename=") || !quoted(filename)) { return false; }
+
+	return (pos == content_disp.size());
 }
@@ -30,6 +30,8 @@ void HttpPacket::Body::reset()
 	data_.is_file_ = false;
 	data_.data_.clear();
 	data_.content_length_ = 0;
+	data_.file_fd_ = -1;
+	data_.shared_data_.reset();
 }
 
 void HttpPacket::reset()
@@ -180,12 +182,32 @@ void HttpPacket::Header::transferEncoding(const std::string& transfer_encoding)
 	data_ << "Transfer-Encoding: " << transfer_encoding << HEADERS_ENDLINE;
 }
 
+void HttpPacket::Header::fields(const std::string& fields)
+{
+	data_.append(fields);
+}
+
+void HttpPacket::Header::patch(const size_t pos, const char* value, const size_t size)
+{
+	data_.replace(pos, size, value, size);
+}
+
 void HttpPacket::Header::end()
 {
 	data_ << HEADERS_ENDLINE;
 	has_end_ = true;
 }
 
+void HttpPacket::Header::removeContentType()
+{
+	size_t pos;
+	if ((pos = data_.rfind("Content-Type")) != std::string::npos) 
+	{
+		const size_t count = data_.find(HEADERS_ENDLINE, pos) - pos + sizeof(HEADERS_ENDLINE)-1;
+		data_.erase(pos, count);
+	}
+}
+
 void HttpPacket::Header::removeContentLength()
 {
 	size_t pos;
@@ -206,6 +228,16 @@ void HttpPacket::Header::removeContentRange()
 	}
 }
 
+void HttpPacket::Header::removeEtag()
+{
+	size_t pos;
+	if ((pos = data_.rfind("ETag")) != std::string::npos) 
+	{
+		const size_t count = data_.find(HEADERS_ENDLINE, pos) - pos + sizeof(HEADERS_ENDLINE)-1;
+		data_.erase(pos, count);
+	}
+}
+
 void HttpPacket::Header::removeEnd()
 {
 	size_t pos;
@@ -218,6 +250,7 @@ bool HttpPacket::Body::addData(const std::string& data)
 {
 	data_.is_file_ = false;
 	data_.data_ = data;
+	data_.shared_data_.reset();
 	data_.content_length_ = data.size();
 	return true;
 }
@@ -226,16 +259,28 @@ bool HttpPacket::Body::addData(std::string&& data)
 {
 	data_.is_file_ = false;
 	data_.data_ = std::move(data);
+	data_.shared_data_.reset();
 	data_.content_length_ = data.size();
 	return true;
 }
 
-bool HttpPacket::Body::addFile(const std::string& rel_path, const uint64_t file_size)
+bool HttpPacket::Body::addData(std::shared_ptr<const std::string> data)
+{
+	data_.is_file_ = false;
+	data_.data_.clear();
+	data_.content_length_ = (data) ? data->size() : 0;
+	data_.shared_data_ = std::move(data);
+	return true;
+}
+
+bool HttpPacket::Body::addFile(const std::string& rel_path, const uint64_t file_size, const int file_fd)
 {
 	std::string fpath = std::string(RESOURCES_DIR) + "/" + rel_path;
 	data_.is_file_ = true;
 	data_.data_ = std::move(fpath);
+	data_.shared_data_.reset();
 	data_.content_length_ = file_size;
+	data_.file_fd_ = file_fd;
 
 	return true;
 }
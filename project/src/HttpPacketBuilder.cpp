@@ -2,10 +2,17 @@
 #include "Globals.hpp"
 #include "Configuration.hpp"
 #include "WebServerError.hpp"
+#include "HttpClock.hpp"
 #include <string>
 #include <time.h>
+#include <string.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <stdexcept>
+#include <atomic>
+#include <random>
+#include <inttypes.h>
 
 
 std::string getPath(const std::string& uri) 
@@ -49,6 +56,41 @@ bool getFileSuffix(const std::string& uri, std::string& suffix)
 }
 
 
+// Last-Modified se bere z predpripravenych header fields, pokud odpovidaji aktualni verzi resource
+static void addLastModified(HttpPacket::Header& pheader, const Config::RParams& rparam)
+{
+    const std::shared_ptr<const Config::RParams::HeaderTemplate> header_template = 
+        rparam.headerTemplate(pheader.httpVer() == HttpVersion::HTTP_1_1);
+    if (header_template && header_template->last_modified == rparam.last_modified)
+    {
+        pheader.lastModified(header_template->last_modified_date.c_str());
+        return;
+    }
+
+    HttpClock::Date date;
+    if (HttpClock::format(rparam.last_modified, date)) {
+        pheader.lastModified(date);
+    }
+}
+
+
+// Oddelovac casti multipart/byteranges (pseudonahodny -> v datech resource se prakticky nevyskytne)
+static std::string generateBoundary()
+{
+    static std::atomic<uint64_t> state{ (static_cast<uint64_t>(std::random_device{}()) << 32) ^ static_cast<uint64_t>(time(nullptr)) };
+
+    // splitmix64
+    uint64_t value = state.fetch_add(0x9E3779B97F4A7C15ULL, std::memory_order_relaxed) + 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    value ^= (value >> 31);
+
+    char boundary[40];
+    snprintf(boundary, sizeof(boundary), "WebServerd-%016" PRIx64, value);
+    return boundary;
+}
+
+
 HttpPacketBuilder::HttpPacketBuilder(const HttpVersion http_version, const bool end_headers) : 
     end_headers_(end_headers)
 {
@@ -76,19 +118,46 @@ void HttpPacketBuilder::createCommonHeaders(const Config::RParams* rparam, const
     }
 
     // Pridavam jen pokud odesilam nejaky resource (pripadne i metoda HEAD)
+    // Otevreny deskriptor lze pouzit jen pro resource, ktery zustava zamceny az do odeslani (status page se hned odemyka)
     if (rparam) {
-        packet_.body().addFile(rparam->resource_path, rparam->resource_size);
+        packet_.body().addFile(rparam->resource_path, rparam->resource_size, 
+            ((status_code_page) ? -1 : rparam->resource_fd));
     }
 
     pheader.statusLine(pheader.httpVer(), status_code);
     pheader.server(Config::params().web_server_name);
 
+    // Resource s predpripravenymi header fields -> doplni se jen Date a Expires
+    if (rparam && !status_code_page)
+    {
+        const std::shared_ptr<const Config::RParams::HeaderTemplate> header_template = 
+            rparam->headerTemplate(pheader.httpVer() == HttpVersion::HTTP_1_1);
+        HttpClock::Date date;
+        HttpClock::Date expires;
+        const time_t now = HttpClock::now(date);
+        if (header_template && 
+            (header_template->expires_offset == std::string::npos || HttpClock::format(now + rparam->expires, expires)))
+        {
+            const size_t fields_offset = pheader.data().size();
+            pheader.fields(header_template->fields);
+            pheader.patch(fields_offset + header_template->date_offset, date, HTTP_DATE_SIZE);
+            if (header_template->expires_offset != std::string::npos) {
+                pheader.patch(fields_offset + header_template->expires_offset, expires, HTTP_DATE_SIZE);
+            }
+
+            if (pheader.httpVer() == HttpVersion::HTTP_1_1) {
+                pheader.connection((keep_alive) ? "keep-alive" : "close");
+            }
+
+            if (end_headers_) { pheader.end(); }
+            return;
+        }
+    }
+
     // Date
-    time_t cas = time(nullptr);
-    struct tm* gmt = gmtime(&cas);
-    char datum[100];
-    strftime(datum, sizeof(datum), HTTP_DATE_FORMAT, gmt);
-    pheader.date(datum);
+    HttpClock::Date date;
+    const time_t now = HttpClock::now(date);
+    pheader.date(date);
 
     // Pridavam jen pokud odesilam nejaky resource (pripadne i metoda HEAD)
     if (rparam)
@@ -124,21 +193,15 @@ void HttpPacketBuilder::createCommonHeaders(const Config::RParams* rparam, const
         pheader.vary();
 
         // Last-Modified
-        time_t mod_cas = rparam->last_modified;
-        gmt = gmtime(&mod_cas);
-        strftime(datum, sizeof(datum), HTTP_DATE_FORMAT, gmt);
-        pheader.lastModified(datum);
+        addLastModified(pheader, *rparam);
         
         // Expires
+        HttpClock::Date expires;
         if (rparam->expires == -1) {
             pheader.expires("Thu, 01 Jan 1970 00:00:01 GMT");
         }
-        else if (rparam->expires > 0) 
-        {
-            time_t exp = cas + rparam->expires;
-            gmt = gmtime(&exp);
-            strftime(datum, sizeof(datum), HTTP_DATE_FORMAT, gmt);
-            pheader.expires(datum);
+        else if (rparam->expires > 0 && HttpClock::format(now + rparam->expires, expires)) {
+            pheader.expires(expires);
         }
 
         // Cache-Control
@@ -159,6 +222,181 @@ void HttpPacketBuilder::createCommonHeaders(const Config::RParams* rparam, const
 }
 
 
+std::shared_ptr<const Config::RParams::HeaderTemplate> HttpPacketBuilder::buildHeaderTemplate(const Config::RParams& rparam, 
+    const HttpVersion http_version)
+{
+    // Hodnoty Date a Expires jsou jen mista pro doplneni (stejne dlouha jako skutecne datum)
+    static const std::string date_placeholder(HTTP_DATE_SIZE, ' ');
+    const size_t value_end = strlen(HEADERS_ENDLINE) + HTTP_DATE_SIZE;
+
+    std::string file_suffix;
+    if (!getFileSuffix(rparam.resource_path, file_suffix)) {
+        return nullptr;
+    }
+    const HttpContentTypeS* content_type = httpContentType(file_suffix);
+    if (content_type == nullptr) {
+        return nullptr;
+    }
+
+    auto header_template = std::make_shared<Config::RParams::HeaderTemplate>();
+    HttpPacket::Header pheader;
+    pheader.setHttpVersion(http_version);
+
+    pheader.date(date_placeholder);
+    header_template->date_offset = pheader.data().size() - value_end;
+
+    pheader.contentType(content_type->content_type_label);
+    pheader.contentLength(rparam.resource_size);
+    pheader.vary();
+
+    HttpClock::Date last_modified;
+    if (!HttpClock::format(rparam.last_modified, last_modified)) {
+        return nullptr;
+    }
+    header_template->last_modified = rparam.last_modified;
+    header_template->last_modified_date = last_modified;
+    pheader.lastModified(last_modified);
+
+    if (rparam.expires == -1) {
+        pheader.expires("Thu, 01 Jan 1970 00:00:01 GMT");
+    }
+    else if (rparam.expires > 0) 
+    {
+        pheader.expires(date_placeholder);
+        header_template->expires_offset = pheader.data().size() - value_end;
+    }
+
+    pheader.cacheControl(rparam.cache_type, rparam.expires);
+    if (http_version == HttpVersion::HTTP_1_1)
+    {
+        pheader.etag(rparam.etag);
+        pheader.acceptRanges(rparam.accept_ranges.c_str());
+    }
+
+    header_template->fields = pheader.data();
+    return header_template;
+}
+
+std::shared_ptr<const Config::StatusPage> HttpPacketBuilder::loadStatusPage(const HttpStatusCode status_code, 
+    const std::string& resource_path)
+{
+    static const std::string date_placeholder(HTTP_DATE_SIZE, ' ');
+    const size_t value_end = strlen(HEADERS_ENDLINE) + HTTP_DATE_SIZE;
+
+    std::string file_suffix;
+    if (!getFileSuffix(resource_path, file_suffix)) {
+        return nullptr;
+    }
+    const HttpContentTypeS* content_type = httpContentType(file_suffix);
+    if (content_type == nullptr) {
+        return nullptr;
+    }
+
+    const std::string file_path = std::string(RESOURCES_DIR) + "/" + resource_path;
+    const int fd = open(file_path.c_str(), O_RDONLY | O_NOCTTY);
+    if (fd == -1) {
+        return nullptr;
+    }
+
+    // Zmena se pozna podle casu modifikace, ktery odpovida prectenemu obsahu
+    struct stat st = {0};
+    auto body = std::make_shared<std::string>();
+    bool loaded = (fstat(fd, &st) == 0);
+    if (loaded)
+    {
+        body->resize(st.st_size);
+        size_t read_bytes = 0;
+        while (read_bytes < body->size())
+        {
+            const ssize_t ret = read(fd, &(*body)[read_bytes], body->size() - read_bytes);
+            if (ret <= 0) 
+            {
+                loaded = false;
+                break;
+            }
+            read_bytes += ret;
+        }
+    }
+    close(fd);
+    if (!loaded) {
+        return nullptr;
+    }
+
+    auto page = std::make_shared<Config::StatusPage>();
+    page->status_code = status_code;
+    page->resource_path = resource_path;
+    page->modified_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+
+    const HttpVersion http_versions[] = { HttpVersion::HTTP_1_0, HttpVersion::HTTP_1_1 };
+    for (size_t i = 0; i < 2; ++i)
+    {
+        HttpPacket::Header pheader;
+        pheader.statusLine(http_versions[i], status_code);
+        pheader.server(Config::params().web_server_name);
+        pheader.date(date_placeholder);
+        page->date_offsets[i] = pheader.data().size() - value_end;
+        pheader.contentType(content_type->content_type_label);
+        pheader.contentLength(body->size());
+        page->headers[i] = pheader.data();
+    }
+    page->body = std::move(body);
+
+    return page;
+}
+
+
+bool HttpPacketBuilder::createStatusPage(const HttpStatusCode status_code, const bool keep_alive)
+{
+    HttpPacket::Header& pheader = packet_.header();
+    if (pheader.httpVer() != HttpVersion::HTTP_1_0 && pheader.httpVer() != HttpVersion::HTTP_1_1) {
+        return false;
+    }
+
+    const std::shared_ptr<const Config::StatusPage> page = Config::statusPage(status_code);
+    if (!page) {
+        return false;
+    }
+
+    // Cela odpoved je v pameti -> doplni se jen Date a Connection, telo se sdili bez kopirovani
+    const size_t version_index = ((pheader.httpVer() == HttpVersion::HTTP_1_1) ? 1 : 0);
+    HttpClock::Date date;
+    HttpClock::now(date);
+    const size_t fields_offset = pheader.data().size();
+    pheader.fields(page->headers[version_index]);
+    pheader.patch(fields_offset + page->date_offsets[version_index], date, HTTP_DATE_SIZE);
+    pheader.setStatusCode(status_code);
+    pheader.connection((keep_alive) ? "keep-alive" : "close");
+    packet_.body().addData(page->body);
+
+    if (end_headers_) { pheader.end(); }
+    return true;
+}
+
+void HttpPacketBuilder::buildStatusPage(const std::string& status_page, const HttpStatusCode status_code, const bool keep_alive)
+{
+    if (createStatusPage(status_code, keep_alive)) {
+        return;
+    }
+
+    // Status page neni v pameti -> odesle se ze souboru resource
+    Config::RParams* rparam = nullptr;
+    try
+    {
+        rparam = getStatPageRParams(status_page);
+        createCommonHeaders(rparam, status_code, true, keep_alive);
+        rparam->unlock();
+    }
+    catch (const WebServerError& exc) {
+        if (rparam) { rparam->unlock(); }
+        throw WebServerError(exc.what());
+    }
+    catch (const std::exception& exc) {
+        if (rparam) { rparam->unlock(); }
+        throw std::runtime_error(exc.what());
+    }
+}
+
+
 void HttpPacketBuilder::buildNoContent()
 {
     createCommonHeaders(HttpStatusCode::NO_CONTENT, true);
@@ -176,11 +414,7 @@ void HttpPacketBuilder::buildNoContent(const Config::RParams* rparam)
     pheader.contentLocation(rparam->resource_path);
 
     // Last-Modified
-    char datum[100];
-    time_t mod_cas = rparam->last_modified;
-    struct tm* gmt = gmtime(&mod_cas);
-    strftime(datum, sizeof(datum), HTTP_DATE_FORMAT, gmt);
-    pheader.lastModified(datum);
+    addLastModified(pheader, *rparam);
 
     if (pheader.httpVer() == HttpVersion::HTTP_1_1) {
         pheader.etag(rparam->etag);
@@ -200,11 +434,7 @@ void HttpPacketBuilder::buildCreated(const Config::RParams* rparam)
     pheader.location("/" + rparam->resource_path);
 
     // Last-Modified
-    char datum[100];
-    time_t mod_cas = rparam->last_modified;
-    struct tm* gmt = gmtime(&mod_cas);
-    strftime(datum, sizeof(datum), HTTP_DATE_FORMAT, gmt);
-    pheader.lastModified(datum);
+    addLastModified(pheader, *rparam);
 
     if (pheader.httpVer() == HttpVersion::HTTP_1_1) {
         pheader.etag(rparam->etag);
@@ -212,62 +442,19 @@ void HttpPacketBuilder::buildCreated(const Config::RParams* rparam)
     pheader.end();
 }
 
-void HttpPacketBuilder::buildBadRequest()
+void HttpPacketBuilder::buildBadRequest(const bool keep_alive)
 {
-    Config::RParams* rparam;
-    try
-    {
-        rparam = getStatPageRParams(BAD_REQUEST_WEB_PAGE);
-        createCommonHeaders(rparam, HttpStatusCode::BAD_REQUEST, true);
-        rparam->unlock();
-    }
-    catch (const WebServerError& exc) {
-        rparam->unlock();
-        throw WebServerError(exc.what());
-    }
-    catch (const std::exception& exc) {
-        rparam->unlock();
-        throw std::runtime_error(exc.what());
-    }
+    buildStatusPage(BAD_REQUEST_WEB_PAGE, HttpStatusCode::BAD_REQUEST, keep_alive);
 }
 
 void HttpPacketBuilder::buildHttpVersionNotSupported()
 {
-    Config::RParams* rparam;
-    try
-    {
-        rparam = getStatPageRParams(HTTP_VERSION_NOT_SUPPORTED_ERROR_WEB_PAGE);
-        createCommonHeaders(rparam, 
-            HttpStatusCode::HTTP_VERSION_NOT_SUPPORTED, true, false);
-        rparam->unlock();
-    }
-    catch (const WebServerError& exc) {
-        rparam->unlock();
-        throw WebServerError(exc.what());
-    }
-    catch (const std::exception& exc) {
-        rparam->unlock();
-        throw std::runtime_error(exc.what());
-    }
+    buildStatusPage(HTTP_VERSION_NOT_SUPPORTED_ERROR_WEB_PAGE, HttpStatusCode::HTTP_VERSION_NOT_SUPPORTED, false);
 }
 
 void HttpPacketBuilder::buildNotFound()
 {
-    Config::RParams* rparam;
-    try
-    {
-        rparam = getStatPageRParams(NOT_FOUND_WEB_PAGE);
-        createCommonHeaders(rparam, HttpStatusCode::NOT_FOUND, true);
-        rparam->unlock();
-    }
-    catch (const WebServerError& exc) {
-        rparam->unlock();
-        throw WebServerError(exc.what());
-    }
-    catch (const std::exception& exc) {
-        rparam->unlock();
-        throw std::runtime_error(exc.what());
-    }
+    buildStatusPage(NOT_FOUND_WEB_PAGE, HttpStatusCode::NOT_FOUND);
 }
 
 void HttpPacketBuilder::buildMethodNotAllowed(const Config::RParams* rparam)
@@ -276,132 +463,47 @@ void HttpPacketBuilder::buildMethodNotAllowed(const Config::RParams* rparam)
         throw WebServerError("Failed to build packet (null resource parameters)");
     }
 
-    Config::RParams* rparam_sp;
-    try
-    {
-        rparam_sp = getStatPageRParams(METHOD_NOT_ALLOWED_WEB_PAGE);
-        setEndHeaders(false);
-        createCommonHeaders(rparam_sp, HttpStatusCode::METHOD_NOT_ALLOWED, true);
-
-        std::string methods_allowed;
-        methods_allowed.reserve(50);
-        const std::vector<std::string>& resource_methods_allowed = rparam->methods_allowed;
+    setEndHeaders(false);
+    buildStatusPage(METHOD_NOT_ALLOWED_WEB_PAGE, HttpStatusCode::METHOD_NOT_ALLOWED);
 
-        for (const std::string& m : resource_methods_allowed) 
-        {
-            methods_allowed.insert(methods_allowed.size(), m);
-            methods_allowed.insert(methods_allowed.size(), ", ");
-        }
+    std::string methods_allowed;
+    methods_allowed.reserve(50);
+    const std::vector<std::string>& resource_methods_allowed = rparam->methods_allowed;
 
-        methods_allowed.erase(methods_allowed.size() - 2);
-        packet_.header().allow(methods_allowed);
-        packet_.header().end();
-        rparam_sp->unlock();
-    }
-    catch (const WebServerError& exc) {
-        rparam_sp->unlock();
-        throw WebServerError(exc.what());
-    }
-    catch (const std::exception& exc) {
-        rparam_sp->unlock();
-        throw std::runtime_error(exc.what());
+    for (const std::string& m : resource_methods_allowed) 
+    {
+        methods_allowed.insert(methods_allowed.size(), m);
+        methods_allowed.insert(methods_allowed.size(), ", ");
     }
+
+    methods_allowed.erase(methods_allowed.size() - 2);
+    packet_.header().allow(methods_allowed);
+    packet_.header().end();
 }
 
 void HttpPacketBuilder::buildNotAcceptable()
 {
-    Config::RParams* rparam;
-    try
-    {
-        rparam = getStatPageRParams(NOT_ACCEPTABLE_WEB_PAGE);
-        createCommonHeaders(rparam, HttpStatusCode::NOT_ACCEPTABLE, true);
-        rparam->unlock();
-    }
-    catch (const WebServerError& exc) {
-        rparam->unlock();
-        throw WebServerError(exc.what());
-    }
-    catch (const std::exception& exc) {
-        rparam->unlock();
-        throw std::runtime_error(exc.what());
-    }
+    buildStatusPage(NOT_ACCEPTABLE_WEB_PAGE, HttpStatusCode::NOT_ACCEPTABLE);
 }
 
 void HttpPacketBuilder::buildForbidden()
 {
-    Config::RParams* rparam;
-    try
-    {
-        rparam = getStatPageRParams(FORBIDDEN_WEB_PAGE);
-        createCommonHeaders(rparam, HttpStatusCode::FORBIDDEN, true);
-        rparam->unlock();
-    }
-    catch (const WebServerError& exc) {
-        rparam->unlock();
-        throw WebServerError(exc.what());
-    }
-    catch (const std::exception& exc) {
-        rparam->unlock();
-        throw std::runtime_error(exc.what());
-    }
+    buildStatusPage(FORBIDDEN_WEB_PAGE, HttpStatusCode::FORBIDDEN);
 }
 
 void HttpPacketBuilder::buildLengthRequired()
 {
-    Config::RParams* rparam;
-    try
-    {
-        rparam = getStatPageRParams(LENGTH_REQUIRED_WEB_PAGE);
-        createCommonHeaders(rparam, HttpStatusCode::LENGTH_REQUIRED, true);
-        rparam->unlock();
-    }
-    catch (const WebServerError& exc) {
-        rparam->unlock();
-        throw WebServerError(exc.what());
-    }
-    catch (const std::exception& exc) {
-        rparam->unlock();
-        throw std::runtime_error(exc.what());
-    }
+    buildStatusPage(LENGTH_REQUIRED_WEB_PAGE, HttpStatusCode::LENGTH_REQUIRED);
 }
 
-void HttpPacketBuilder::buildContentTooLarge()
+void HttpPacketBuilder::buildContentTooLarge(const bool keep_alive)
 {
-    Config::RParams* rparam;
-    try
-    {
-        rparam = getStatPageRParams(CONTENT_TOO_LARGE_WEB_PAGE);
-        createCommonHeaders(rparam, HttpStatusCode::CONTENT_TOO_LARGE, true);
-        rparam->unlock();
-    }
-    catch (const WebServerError& exc) {
-        rparam->unlock();
-        throw WebServerError(exc.what());
-    }
-    catch (const std::exception& exc) {
-        rparam->unlock();
-        throw std::runtime_error(exc.what());
-    }
+    buildStatusPage(CONTENT_TOO_LARGE_WEB_PAGE, HttpStatusCode::CONTENT_TOO_LARGE, keep_alive);
 }
 
 void HttpPacketBuilder::buildInternalServerError()
 {
-    Config::RParams* rparam;
-    try
-    {
-        rparam = getStatPageRParams(INTERNAL_SERVER_ERROR_WEB_PAGE);
-        createCommonHeaders(rparam, 
-            HttpStatusCode::INTERNAL_SERVER_ERROR, true, false);
-        rparam->unlock();
-    }
-    catch (const WebServerError& exc) {
-        rparam->unlock();
-        throw WebServerError(exc.what());
-    }
-    catch (const std::exception& exc) {
-        rparam->unlock();
-        throw std::runtime_error(exc.what());
-    }
+    buildStatusPage(INTERNAL_SERVER_ERROR_WEB_PAGE, HttpStatusCode::INTERNAL_SERVER_ERROR, false);
 }
 
 void HttpPacketBuilder::buildNotImplemented()
@@ -411,22 +513,7 @@ void HttpPacketBuilder::buildNotImplemented()
 
 void HttpPacketBuilder::buildServiceUnavailable()
 {
-    Config::RParams* rparam;
-    try
-    {
-        rparam = getStatPageRParams(SERVICE_UNAVAILABLE_WEB_PAGE);
-        createCommonHeaders(rparam, 
-            HttpStatusCode::SERVICE_UNAVAILABLE, true, false);
-        rparam->unlock();
-    }
-    catch (const WebServerError& exc) {
-        rparam->unlock();
-        throw WebServerError(exc.what());
-    }
-    catch (const std::exception& exc) {
-        rparam->unlock();
-        throw std::runtime_error(exc.what());
-    }
+    buildStatusPage(SERVICE_UNAVAILABLE_WEB_PAGE, HttpStatusCode::SERVICE_UNAVAILABLE, false);
 }
 
 void HttpPacketBuilder::buildNotModified(const Config::RParams* rparam)
@@ -439,23 +526,77 @@ void HttpPacketBuilder::buildNotModified(const Config::RParams* rparam)
     createCommonHeaders(rparam, HttpStatusCode::NOT_MODIFIED, false);
 }
 
-void HttpPacketBuilder::buildUnsupportedMediaType()
+void HttpPacketBuilder::buildNotModified(const Config::RParams* rparam, const ETag& etag)
 {
-    Config::RParams* rparam;
-    try
+    if (!rparam) {
+        throw WebServerError("Failed to build packet (null resource parameters)");
+    }
+
+    HttpPacket::Header& pheader = packet_.header();
+    setEndHeaders(false);
+    createCommonHeaders(rparam, HttpStatusCode::NOT_MODIFIED, false);
+    if (etag != rparam->etag)
     {
-        rparam = getStatPageRParams(UNSUPPORTED_MEDIA_TYPE_WEB_PAGE);
-        createCommonHeaders(rparam, HttpStatusCode::UNSUPPORTED_MEDIA_TYPE, true);
-        rparam->unlock();
+        pheader.removeEtag();
+        pheader.etag(etag);
     }
-    catch (const WebServerError& exc) {
-        rparam->unlock();
-        throw WebServerError(exc.what());
+    pheader.end();
+}
+
+void HttpPacketBuilder::buildPartialContent(const Config::RParams* rparam, const std::vector<HttpRange>& ranges, 
+    std::vector<std::string>& parts)
+{
+    if (!rparam || ranges.empty()) {
+        throw WebServerError("Failed to build packet (null resource parameters)");
     }
-    catch (const std::exception& exc) {
-        rparam->unlock();
-        throw std::runtime_error(exc.what());
+
+    HttpPacket::Header& pheader = packet_.header();
+    setEndHeaders(false);
+    createCommonHeaders(rparam, HttpStatusCode::PARTIAL_CONTENT, false, true);
+    pheader.removeContentLength();
+    parts.clear();
+
+    if (ranges.size() == 1)
+    {
+        pheader.contentRange(ranges.front().start, ranges.front().end, rparam->resource_size);
+        pheader.contentLength(ranges.front().end - ranges.front().start + 1);
+        pheader.end();
+        return;
+    }
+
+    // Vice rozsahu -> jedna odpoved, kazda cast ma vlastni Content-Type a Content-Range (RFC 7233, 4.1)
+    std::string file_suffix;
+    if (!getFileSuffix(rparam->resource_path, file_suffix)) {
+        throw WebServerError("Failed to get file suffix");
+    }
+    const HttpContentTypeS* content_type = httpContentType(file_suffix);
+    if (content_type == nullptr) {
+        throw WebServerError("Invalid content type");
     }
+
+    const std::string boundary = generateBoundary();
+    const std::string resource_size = std::to_string(rparam->resource_size);
+    uint64_t content_length = 0;
+    parts.reserve(ranges.size() + 1);
+    for (const HttpRange& range : ranges)
+    {
+        parts.push_back(HEADERS_ENDLINE "--" + boundary + HEADERS_ENDLINE "Content-Type: " + 
+            content_type->content_type_label + HEADERS_ENDLINE "Content-Range: bytes " + std::to_string(range.start) + "-" + 
+            std::to_string(range.end) + "/" + resource_size + HEADERS_END);
+        content_length += parts.back().size() + (range.end - range.start + 1);
+    }
+    parts.push_back(HEADERS_ENDLINE "--" + boundary + "--" HEADERS_ENDLINE);
+    content_length += parts.back().size();
+
+    pheader.removeContentType();
+    pheader.contentType("multipart/byteranges; boundary=" + boundary);
+    pheader.contentLength(content_length);
+    pheader.end();
+}
+
+void HttpPacketBuilder::buildUnsupportedMediaType()
+{
+    buildStatusPage(UNSUPPORTED_MEDIA_TYPE_WEB_PAGE, HttpStatusCode::UNSUPPORTED_MEDIA_TYPE);
 }
 
 void HttpPacketBuilder::buildPreconditionFailed()
@@ -0,0 +1,405 @@
+#include "HttpRequestParser.hpp"
+#include "TextScan.hpp"
+#include <array>
+#include <string.h>
+
+
+#define HTTP_VERSION_PREFIX "HTTP/"
+#define HTTP_VERSION_SIZE (sizeof(HTTP_VERSION_PREFIX) - 1 + 3)  // HTTP/x.y
+
+
+// tchar z RFC 7230 (nazev metody a nazev header fieldu), URI a hodnoty prochazi TextScan
+static constexpr std::array<bool, 256> token_chars = []()
+{
+	std::array<bool, 256> table{};
+	for (int c = '0'; c <= '9'; ++c) { table[c] = true; }
+	for (int c = 'A'; c <= 'Z'; ++c) { table[c] = true; }
+	for (int c = 'a'; c <= 'z'; ++c) { table[c] = true; }
+	for (const char* c = "!#$%&'*+-.^_`|~"; *c; ++c) { table[static_cast<unsigned char>(*c)] = true; }
+	return table;
+}();
+
+static bool isTokenChar(const unsigned char c)
+{
+	return token_chars[c];
+}
+
+// Prvni znak od pos, ktery neni tchar (size -> zatim neprisel)
+static size_t scanToken(const char* buffer, size_t pos, const size_t size)
+{
+	while (pos < size && isTokenChar(static_cast<unsigned char>(buffer[pos]))) {
+		++pos;
+	}
+	return pos;
+}
+
+
+// Perfektni hash znamych nazvu (delka, prvni a posledni znak), kolize hlida static_assert
+// Nazvy jsou tchar -> OR 0x20 prevede velka pismena na mala a zadny jiny tchar nezobrazi na pismeno nebo '-'
+#define HEADER_FIELD_TABLE_SIZE 32
+#define HEADER_FIELD_CASE_BIT 0x20
+
+struct HeaderFieldName
+{
+	std::string_view name;  // Malymi pismeny
+	HttpHeaderField field;
+};
+
+static constexpr HeaderFieldName header_field_names[] = {
+	{ "accept-encoding", HttpHeaderField::ACCEPT_ENCODING },
+	{ "content-encoding", HttpHeaderField::CONTENT_ENCODING },
+	{ "content-length", HttpHeaderField::CONTENT_LENGTH },
+	{ "content-type", HttpHeaderField::CONTENT_TYPE },
+	{ "expect", HttpHeaderField::EXPECT },
+	{ "if-match", HttpHeaderField::IF_MATCH },
+	{ "if-modified-since", HttpHeaderField::IF_MODIFIED_SINCE },
+	{ "if-none-match", HttpHeaderField::IF_NONE_MATCH },
+	{ "if-range", HttpHeaderField::IF_RANGE },
+	{ "if-unmodified-since", HttpHeaderField::IF_UNMODIFIED_SINCE },
+	{ "range", HttpHeaderField::RANGE },
+	{ "transfer-encoding", HttpHeaderField::TRANSFER_ENCODING }
+};
+
+static constexpr size_t headerFieldHash(const std::string_view name)
+{
+	const size_t first = static_cast<unsigned char>(name.front() | HEADER_FIELD_CASE_BIT);
+	const size_t last = static_cast<unsigned char>(name.back() | HEADER_FIELD_CASE_BIT);
+	return (name.size() + first * 2 + last) % HEADER_FIELD_TABLE_SIZE;
+}
+
+// Slot -> index do header_field_names + 1 (0 -> zadny znamy nazev)
+static constexpr std::array<uint8_t, HEADER_FIELD_TABLE_SIZE> header_field_table = []()
+{
+	std::array<uint8_t, HEADER_FIELD_TABLE_SIZE> table{};
+	for (size_t i = 0; i < std::size(header_field_names); ++i) {
+		table[headerFieldHash(header_field_names[i].name)] = static_cast<uint8_t>(i + 1);
+	}
+	return table;
+}();
+
+static constexpr bool headerFieldTableComplete()
+{
+	for (size_t i = 0; i < std::size(header_field_names); ++i)
+	{
+		if (header_field_table[headerFieldHash(header_field_names[i].name)] != i + 1) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static_assert(std::size(header_field_names) == static_cast<size_t>(HttpHeaderField::UNKNOWN), "Missing known header field name");
+static_assert(headerFieldTableComplete(), "Known header field names collide, change headerFieldHash()");
+
+// Porovnani bez ohledu na velikost pismen po 8 bytech (lower je malymi pismeny a stejne dlouhy)
+static bool equalsLowerCase(const char* name, const char* lower, const size_t size)
+{
+	static constexpr uint64_t case_bits = 0x0101010101010101ULL * HEADER_FIELD_CASE_BIT;
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+	{
+		uint64_t word;
+		uint64_t lower_word;
+		memcpy(&word, name + i, sizeof(word));
+		memcpy(&lower_word, lower + i, sizeof(lower_word));
+		if ((word | case_bits) != lower_word) {
+			return false;
+		}
+	}
+	for (; i < size; ++i)
+	{
+		if ((name[i] | HEADER_FIELD_CASE_BIT) != lower[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+HttpHeaderField HttpRequestParser::headerField(const std::string_view name)
+{
+	if (name.empty()) {
+		return HttpHeaderField::UNKNOWN;
+	}
+
+	const uint8_t index = header_field_table[headerFieldHash(name)];
+	if (index == 0) {
+		return HttpHeaderField::UNKNOWN;
+	}
+
+	const HeaderFieldName& known = header_field_names[index - 1];
+	if (name.size() != known.name.size() || !equalsLowerCase(name.data(), known.name.data(), name.size())) {
+		return HttpHeaderField::UNKNOWN;
+	}
+	return known.field;
+}
+
+
+HttpRequestParser::Result HttpRequestParser::parse(const std::string_view data)
+{
+	if (state_ == State::DONE) {
+		return Result::COMPLETED;
+	}
+	else if (state_ == State::ERROR) {
+		return Result::ERROR;
+	}
+
+	const char* const buffer = data.data();
+	const size_t size = data.size();
+	State state = state_;
+	size_t pos = pos_;
+
+	while (pos < size)
+	{
+		const unsigned char c = buffer[pos];
+		switch (state)
+		{
+			case State::REQUEST_LINE_START:
+				// Prazdne radky pred request line se ignoruji (RFC 7230, 3.5)
+				if (c == '\r' || c == '\n')
+				{
+					++pos;
+					break;
+				}
+				if (!isTokenChar(c)) {
+					return fail();
+				}
+				token_ = pos;
+				state = State::METHOD;
+				break;
+
+			case State::METHOD:
+				pos = scanToken(buffer, pos, size);
+				if (pos == size) {
+					break;
+				}
+				if (buffer[pos] != ' ') {
+					return fail();
+				}
+				method_ = { token_, pos - token_ };
+				token_ = ++pos;
+				state = State::URI;
+				break;
+
+			case State::URI:
+				pos = TextScan::skipVisible(buffer, pos, size, false);
+				if (pos == size) {
+					break;
+				}
+				if (buffer[pos] != ' ' || pos == token_) {
+					return fail();
+				}
+				uri_ = { token_, pos - token_ };
+				token_ = ++pos;
+				state = State::VERSION;
+				break;
+
+			case State::VERSION:
+				if (c == '\r')
+				{
+					if (!parseVersion(buffer + token_, pos - token_)) {
+						return fail();
+					}
+					state = State::REQUEST_LINE_LF;
+				}
+				else if (pos - token_ >= HTTP_VERSION_SIZE) {
+					return fail();
+				}
+				++pos;
+				break;
+
+			case State::REQUEST_LINE_LF:
+			case State::HEADER_LF:
+				if (c != '\n') {
+					return fail();
+				}
+				state = State::HEADER_START;
+				++pos;
+				break;
+
+			case State::HEADER_START:
+				if (c == '\r')
+				{
+					state = State::END_LF;
+					++pos;
+					break;
+				}
+				// Pokracovani hodnoty na dalsim radku (obs-fold) se odmita
+				if (!isTokenChar(c)) {
+					return fail();
+				}
+				token_ = pos;
+				state = State::HEADER_NAME;
+				break;
+
+			case State::HEADER_NAME:
+			{
+				pos = scanToken(buffer, pos, size);
+				if (pos == size) {
+					break;
+				}
+				if (buffer[pos] != ':') {
+					return fail();
+				}
+				headers_.push_back({ { token_, pos - token_ }, {} });
+
+				// Nazev se rozpozna jen jednou, obsluha pak cte primo slot (plati prvni vyskyt)
+				field_ = headerField(std::string_view(buffer + token_, pos - token_));
+				if (field_ != HttpHeaderField::UNKNOWN)
+				{
+					uint32_t& index = request_.known_headers[static_cast<size_t>(field_)];
+					// Vice Content-Length -> kazdy prijemce by mohl telo ohranicit jinak (request smuggling)
+					if (index != 0 && field_ == HttpHeaderField::CONTENT_LENGTH) {
+						return fail();
+					}
+					if (index == 0) {
+						index = static_cast<uint32_t>(headers_.size());
+					}
+				}
+				state = State::VALUE_START;
+				++pos;
+				break;
+			}
+
+			case State::VALUE_START:
+				if (c == ' ' || c == '\t')
+				{
+					++pos;
+					break;
+				}
+				token_ = pos;
+				state = State::VALUE;
+				break;
+
+			case State::VALUE:
+			{
+				pos = TextScan::skipVisible(buffer, pos, size, true);
+				if (pos == size) {
+					break;
+				}
+				if (buffer[pos] != '\r') {
+					return fail();
+				}
+
+				// Koncove OWS se do hodnoty nepocitaji
+				size_t value_end = pos;
+				while (value_end > token_ && (buffer[value_end - 1] == ' ' || buffer[value_end - 1] == '\t')) {
+					--value_end;
+				}
+				headers_.back().value = { token_, value_end - token_ };
+				if (field_ == HttpHeaderField::CONTENT_LENGTH && !parseContentLength(buffer + token_, value_end - token_)) {
+					return fail();
+				}
+				state = State::HEADER_LF;
+				++pos;
+				break;
+			}
+
+			case State::END_LF:
+				if (c != '\n') {
+					return fail();
+				}
+				pos_ = pos + 1;
+				state_ = State::DONE;
+				materialize(buffer);
+				return Result::COMPLETED;
+
+			case State::DONE:
+			case State::ERROR:
+				return Result::ERROR;
+		}
+	}
+
+	state_ = state;
+	pos_ = pos;
+	return Result::INCOMPLETE;
+}
+
+void HttpRequestParser::bind(std::string& data)
+{
+	if (state_ != State::DONE || data.size() < pos_) {
+		return;
+	}
+
+	// Hodnota konci nejpozdeji na '\r' -> prepsat na '\0', hodnoty lze pak predat primo C funkcim
+	for (const HeaderSpan& header : headers_) {
+		data[header.value.offset + header.value.size] = '\0';
+	}
+	materialize(data.data());
+}
+
+void HttpRequestParser::reset()
+{
+	state_ = State::REQUEST_LINE_START;
+	pos_ = 0;
+	token_ = 0;
+	field_ = HttpHeaderField::UNKNOWN;
+	method_ = Span();
+	uri_ = Span();
+	headers_.clear();  // Kapacita zustava pro dalsi request spojeni
+	request_.method = std::string_view();
+	request_.uri = std::string_view();
+	request_.version_major = 0;
+	request_.version_minor = 0;
+	request_.headers.clear();
+	request_.known_headers.fill(0);
+	request_.content_length = 0;
+}
+
+HttpRequestParser::Result HttpRequestParser::fail()
+{
+	state_ = State::ERROR;
+	return Result::ERROR;
+}
+
+bool HttpRequestParser::parseVersion(const char* version, const size_t size)
+{
+	const size_t prefix_size = sizeof(HTTP_VERSION_PREFIX) - 1;
+	if (size != HTTP_VERSION_SIZE || memcmp(version, HTTP_VERSION_PREFIX, prefix_size) != 0) {
+		return false;
+	}
+
+	const char major = version[prefix_size];
+	const char minor = version[prefix_size + 2];
+	if (major < '0' || major > '9' || version[prefix_size + 1] != '.' || minor < '0' || minor > '9') {
+		return false;
+	}
+
+	request_.version_major = static_cast<uint8_t>(major - '0');
+	request_.version_minor = static_cast<uint8_t>(minor - '0');
+	return true;
+}
+
+bool HttpRequestParser::parseContentLength(const char* value, const size_t size)
+{
+	// 1*DIGIT (RFC 7230, 3.3.2), znamenko, mezery uvnitr ani seznam hodnot se neprijimaji, preteceni -> nevalidni
+	if (size == 0) {
+		return false;
+	}
+
+	uint64_t length = 0;
+	for (size_t i = 0; i < size; ++i)
+	{
+		const char c = value[i];
+		if (c < '0' || c > '9' || length > (UINT64_MAX - (c - '0')) / 10) {
+			return false;
+		}
+		length = length * 10 + (c - '0');
+	}
+
+	request_.content_length = length;
+	return true;
+}
+
+void HttpRequestParser::materialize(const char* data)
+{
+	request_.method = std::string_view(data + method_.offset, method_.size);
+	request_.uri = std::string_view(data + uri_.offset, uri_.size);
+
+	request_.headers.resize(headers_.size());
+	for (size_t i = 0; i < headers_.size(); ++i)
+	{
+		request_.headers[i].name = std::string_view(data + headers_[i].name.offset, headers_[i].name.size);
+		request_.headers[i].value = std::string_view(data + headers_[i].value.offset, headers_[i].value.size);
+	}
+}
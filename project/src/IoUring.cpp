@@ -0,0 +1,307 @@
+#ifdef WEBSERVER_IO_URING
+#include "IoUring.hpp"
+#include "Logger.hpp"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+static int ioUringSetup(const uint32_t entries, io_uring_params* params)
+{
+	return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int ioUringEnter(const int fd, const uint32_t to_submit, const uint32_t min_complete, const uint32_t flags, const void* arg, const size_t arg_size)
+{
+	return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size));
+}
+
+static int ioUringRegister(const int fd, const uint32_t opcode, const void* arg, const uint32_t nr_args)
+{
+	return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+
+IoUring::~IoUring()
+{
+	release();
+}
+
+bool IoUring::init(const uint32_t entries)
+{
+	if (ring_fd_ != -1) {
+		return false;
+	}
+
+	// Multishot operace generuji vice CQE nez SQE -> vetsi completion queue
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = entries * 4;
+
+	ring_fd_ = ioUringSetup(entries, &params);
+	if (ring_fd_ == -1)
+	{
+		LOG_ERR("Failed to create io_uring instance (error: %s)", strerror(errno));
+		return false;
+	}
+
+	// Vyzadovane vlastnosti kernelu (timeout pri cekani na CQE, jedno mmap pro SQ i CQ)
+	if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_SINGLE_MMAP))
+	{
+		LOG_ERR("Kernel io_uring does not support required features");
+		release();
+		return false;
+	}
+
+	sq_size_ = params.sq_off.array + (params.sq_entries * sizeof(uint32_t));
+	cq_size_ = params.cq_off.cqes + (params.cq_entries * sizeof(io_uring_cqe));
+	if (cq_size_ > sq_size_) {
+		sq_size_ = cq_size_;
+	}
+	cq_size_ = 0;  // SQ a CQ sdili jedno mapovani
+
+	sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+	if (sq_ptr_ == MAP_FAILED)
+	{
+		sq_ptr_ = nullptr;
+		LOG_ERR("Failed to map io_uring rings (error: %s)", strerror(errno));
+		release();
+		return false;
+	}
+	cq_ptr_ = sq_ptr_;
+
+	sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+	void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED)
+	{
+		LOG_ERR("Failed to map io_uring submission entries (error: %s)", strerror(errno));
+		release();
+		return false;
+	}
+	sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+	char* sq = static_cast<char*>(sq_ptr_);
+	sq_head_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+	sq_tail_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+	sq_array_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+	sq_mask_ = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+	sq_entries_ = params.sq_entries;
+	sqe_tail_ = *sq_tail_;
+
+	char* cq = static_cast<char*>(cq_ptr_);
+	cq_head_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+	cq_tail_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+	cq_mask_ = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+	cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+	return true;
+}
+
+void IoUring::release()
+{
+	if (ring_fd_ != -1)
+	{
+		close(ring_fd_);
+		ring_fd_ = -1;
+	}
+	if (sqes_)
+	{
+		munmap(sqes_, sqes_size_);
+		sqes_ = nullptr;
+	}
+	if (sq_ptr_)
+	{
+		munmap(sq_ptr_, sq_size_);
+		sq_ptr_ = nullptr;
+		cq_ptr_ = nullptr;
+	}
+	if (buf_ring_)
+	{
+		munmap(buf_ring_, buf_ring_size_);
+		buf_ring_ = nullptr;
+	}
+	if (buffers_)
+	{
+		free(buffers_);
+		buffers_ = nullptr;
+	}
+
+	sq_head_ = sq_tail_ = sq_array_ = nullptr;
+	cq_head_ = cq_tail_ = nullptr;
+	cqes_ = nullptr;
+	sq_mask_ = sq_entries_ = sqe_tail_ = cq_mask_ = 0;
+	buffer_size_ = 0;
+	buffer_count_ = buffer_group_ = buf_tail_ = 0;
+}
+
+
+io_uring_sqe* IoUring::getSqe()
+{
+	// Plna submission queue -> nejdriv odeslat pripravene SQE kernelu
+	if (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_)
+	{
+		if (submit() < 0 || sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+			return nullptr;
+		}
+	}
+
+	const uint32_t index = sqe_tail_ & sq_mask_;
+	io_uring_sqe* sqe = &sqes_[index];
+	memset(sqe, 0, sizeof(io_uring_sqe));
+	sq_array_[index] = index;
+	++sqe_tail_;
+
+	return sqe;
+}
+
+uint32_t IoUring::sqSpace() const
+{
+	return (sq_entries_ - (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE)));
+}
+
+int IoUring::submit()
+{
+	const uint32_t to_submit = sqe_tail_ - *sq_tail_;
+	if (to_submit == 0) {
+		return 0;
+	}
+
+	__atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+
+	int ret;
+	do {
+		ret = ioUringEnter(ring_fd_, to_submit, 0, 0, nullptr, 0);
+	} while (ret == -1 && errno == EINTR);
+
+	if (ret == -1) {
+		LOG_ERR("Failed to submit io_uring requests (error: %s)", strerror(errno));
+	}
+	return ret;
+}
+
+
+void IoUring::prepareSendMsg(io_uring_sqe* sqe, const int fd, const msghdr* msg)
+{
+	// Bez MSG_WAITALL: s nim kernel castecny zapis opakuje sam a pri plnem socketu muze request skoncit -EAGAIN,
+	// aniz by CQE neslo uz odeslana data -> zbytek dat odesila volajici podle vysledku
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = fd;
+	sqe->addr = reinterpret_cast<uint64_t>(msg);
+	sqe->len = 1;
+	sqe->msg_flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+}
+
+
+int IoUring::waitCqe(const int timeout_ms)
+{
+	// Vraci: 1 -> je pripraveno CQE, 0 -> vyprsel cas, -1 -> chyba
+	if (peekCqe()) {
+		return 1;
+	}
+
+	__kernel_timespec ts;
+	ts.tv_sec = timeout_ms / 1000;
+	ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+
+	io_uring_getevents_arg arg;
+	memset(&arg, 0, sizeof(arg));
+	arg.ts = reinterpret_cast<uint64_t>(&ts);
+
+	const int ret = ioUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+	if (ret == -1)
+	{
+		if (errno == ETIME || errno == EINTR) {
+			return (peekCqe() ? 1 : 0);
+		}
+		return -1;
+	}
+
+	return (peekCqe() ? 1 : 0);
+}
+
+io_uring_cqe* IoUring::peekCqe()
+{
+	const uint32_t head = *cq_head_;
+	if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+		return nullptr;
+	}
+
+	return &cqes_[head & cq_mask_];
+}
+
+void IoUring::seenCqe()
+{
+	__atomic_store_n(cq_head_, *cq_head_ + 1, __ATOMIC_RELEASE);
+}
+
+
+bool IoUring::initBuffers(const uint16_t group, const uint16_t count, const uint32_t size)
+{
+	// Pocet bufferu musi byt mocnina 2
+	if (ring_fd_ == -1 || buf_ring_ || count == 0 || (count & (count - 1)) != 0) {
+		return false;
+	}
+
+	buf_ring_size_ = count * sizeof(io_uring_buf);
+	void* ring = mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (ring == MAP_FAILED)
+	{
+		LOG_ERR("Failed to allocate io_uring buffer ring (error: %s)", strerror(errno));
+		return false;
+	}
+	buf_ring_ = static_cast<io_uring_buf_ring*>(ring);
+
+	buffers_ = static_cast<char*>(malloc(static_cast<size_t>(count) * size));
+	if (!buffers_)
+	{
+		LOG_ERR("Failed to allocate io_uring buffers");
+		munmap(buf_ring_, buf_ring_size_);
+		buf_ring_ = nullptr;
+		return false;
+	}
+
+	io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring_);
+	reg.ring_entries = count;
+	reg.bgid = group;
+	if (ioUringRegister(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) == -1)
+	{
+		LOG_ERR("Failed to register io_uring buffer ring (error: %s)", strerror(errno));
+		free(buffers_);
+		buffers_ = nullptr;
+		munmap(buf_ring_, buf_ring_size_);
+		buf_ring_ = nullptr;
+		return false;
+	}
+
+	buffer_size_ = size;
+	buffer_count_ = count;
+	buffer_group_ = group;
+	buf_tail_ = 0;
+	for (uint16_t id = 0; id < count; ++id) {
+		recycleBuffer(id);
+	}
+
+	return true;
+}
+
+void IoUring::recycleBuffer(const uint16_t id)
+{
+	// Pole bufs zacina na zacatku ringu (__DECLARE_FLEX_ARRAY ho v C++ posouva, proto ne buf_ring_->bufs)
+	io_uring_buf* buf = reinterpret_cast<io_uring_buf*>(buf_ring_) + (buf_tail_ & (buffer_count_ - 1));
+	buf->addr = reinterpret_cast<uint64_t>(buffers_ + (static_cast<size_t>(id) * buffer_size_));
+	buf->len = buffer_size_;
+	buf->bid = id;
+	++buf_tail_;
+
+	__atomic_store_n(&buf_ring_->tail, buf_tail_, __ATOMIC_RELEASE);
+}
+
+
+#endif
@@ -1,6 +1,7 @@
 #include "SslConfig.hpp"
 #include "Logger.hpp"
 #include "Configuration.hpp"
+#include <unistd.h>
 
 
 SslConfig::~SslConfig()
@@ -100,5 +101,19 @@ bool SslConfig::configureContext()
     SSL_CTX_set_ciphersuites(ctx_, cipher_suites.c_str());
     SSL_CTX_set_min_proto_version(ctx_, TLS1_2_VERSION);
 
+    // Kernel TLS (sifrovani zaznamu v kernelu -> odesilani souboru pres SSL_sendfile)
+    // Zda se kTLS opravdu pouzije se urci az po handshake (kernel modul tls, podporovana cipher suite)
+    if (Config::params().ktls_enabled)
+    {
+#ifndef OPENSSL_NO_KTLS
+        if (access("/sys/module/tls", F_OK) != 0) {
+            LOG_INFO("Kernel TLS module is not loaded, HTTPS connections may fall back to userspace TLS");
+        }
+        SSL_CTX_set_options(ctx_, SSL_OP_ENABLE_KTLS);
+#else
+        LOG_INFO("OpenSSL is built without kTLS support, HTTPS connections will use userspace TLS");
+#endif
+    }
+
     return true;
 }
@@ -1,6 +1,8 @@
 #include "TcpServer.hpp"
 #include "Logger.hpp"
 #include "Configuration.hpp"
+#include "TextScan.hpp"
+#include "Globals.hpp"
 #include "openssl/ssl.h"
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -11,31 +13,90 @@
 #include <string>
 #include <string.h>
 #include <fcntl.h>
-#include <sys/select.h>
-
-#define RTT_2 (50000)	// RTT / 2 = 50ms; RTT = 100ms
+#include <poll.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <netinet/tcp.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <chrono>
+
+#define EVENT_LOOP_TIMEOUT (100)	// Interval kontroly behu event loopu [ms]
+#define EVENT_LOOP_MAX_EVENTS (256)
+#define TIMER_TICK (100)	// Rozliseni casovacu spojeni [ms]
+#define MIN_TIMEOUT (1000)	// Nejkratsi povoleny timeout spojeni [ms]
+#define SENDFILE_WINDOW (16 * 1024 * 1024)	// Max. velikost jednoho volani sendfile() [B]
+#define RECV_CHUNK_SIZE (16 * 1024)	// Velikost jednoho cteni ze socketu do bufferu spojeni [B]
+#define TLS_RECORD_SIZE (SSL3_RT_MAX_PLAIN_LENGTH)	// Max. velikost dat jednoho TLS zaznamu [B]
+#define OUTPUT_PENDING_LIMIT (1024 * 1024)	// Max. velikost odlozenych dat odpovedi v pameti, dalsi se ukladaji do docasneho souboru [B]
+#define SPILL_READ_CHUNK (16 * 1024)	// Cteni docasneho souboru pro TLS v userspace (jeden TLS zaznam) [B]
+
+#define NETWORK_BACKEND_EPOLL "epoll"
+#define NETWORK_BACKEND_IO_URING "io_uring"
+
+#ifdef WEBSERVER_IO_URING
+#define URING_ENTRIES (1024)
+#define URING_BUFFER_GROUP (0)
+#define URING_BUFFER_COUNT (1024)	// Pocet provided bufferu pro recv (mocnina 2)
+#define URING_BUFFER_SIZE (4096)
+#define URING_RECV_BUFFER_LIMIT (1024 * 1024)	// Max. velikost neprectenych dat spojeni, pak se prijem pozastavi
+#define URING_SEND_MAX_IOV (64)	// Max. pocet casti v jednom sendmsg
+#endif
+
+
+static uint64_t steadyTimeMs()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
 
 
 TcpServer::Connection::~Connection()
 {
+	for (const OutputSegment& segment : pending_output_)
+	{
+		if (segment.file_fd != -1) {
+			close(segment.file_fd);
+		}
+	}
+	if (spill_fd_ != -1) {
+		close(spill_fd_);
+	}
+
 	if (ssl_) {
 		SSL_free(ssl_);
 	}
+	if (handshake_) {
+		SSL_free(handshake_);
+	}
 }
 
+thread_local TcpServer::Task TcpServer::offload_task_;
+
+
 TcpServer::TcpServer() :
 	run_(false),
 	deactivated_(false),
 	socket_(-1),
 	socket_ssl_(-1),
+	epoll_fd_(-1),
 	server_({0}),
 	server_ssl_({0}),
-	max_connections_(0)
+	max_connections_(0),
+	max_header_size_(0),
+	body_buffer_size_(0),
+	reuse_port_(false),
+	keepalive_timeout_(0),
+	header_timeout_(0),
+	body_timeout_(0),
+	timers_(TIMER_TICK),
+	backend_(NetworkBackend::EPOLL)
 {
 
 }
 
-bool initSocket(int& sock, sockaddr_in& server)
+bool initSocket(int& sock, sockaddr_in& server, const bool reuse_port)
 {
 	sock = socket(AF_INET, SOCK_STREAM, 0);
 	if (sock == -1)
@@ -43,6 +104,23 @@ bool initSocket(int& sock, sockaddr_in& server)
 		LOG_ERR("Failed to create server socket");
 		return false;
 	}
+
+	// Odpovedi se skladaji do jednoho zapisu sami -> Nagle by jen zdrzoval (prijate sockety nastaveni dedi)
+	const int nodelay = 1;
+	if (setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay)) == -1) {
+		LOG_ERR("Failed to set TCP_NODELAY on server socket");
+	}
+
+	// Vice shardu posloucha na stejnem portu, kernel mezi ne rozdeluje prichozi spojeni
+	if (reuse_port)
+	{
+		const int enable = 1;
+		if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) == -1)
+		{
+			LOG_ERR("Failed to set SO_REUSEPORT on server socket");
+			return false;
+		}
+	}
 	
 	if (bind(sock, (sockaddr*) &server, sizeof(server)) == -1)
 	{
@@ -69,21 +147,52 @@ bool TcpServer::start()
 			LOG_ERR("Failed to spawn threads");
 			return false;
 		}
+		if (!disk_pool_.start()) 
+		{
+			LOG_ERR("Failed to spawn disk I/O threads");
+			return false;
+		}
 
 		// Vytvoreni socketu pro pripojovani
-		if (!initSocket(socket_, server_)) {
+		if (!initSocket(socket_, server_, reuse_port_)) {
 			return false;
 		}
 		if (Config::params().https_enabled) 
 		{
-			if (!initSocket(socket_ssl_, server_ssl_)) 
+			if (!initSocket(socket_ssl_, server_ssl_, reuse_port_)) 
 			{
 				return false;
 			}
 		}
 
+		timers_.start(steadyTimeMs());
+
+#ifdef WEBSERVER_IO_URING
+		if (backend_ == NetworkBackend::IO_URING && !startUring())
+		{
+			LOG_ERR("Failed to start io_uring network backend, using epoll");
+			backend_ = NetworkBackend::EPOLL;
+		}
+		if (backend_ == NetworkBackend::IO_URING)
+		{
+			run_ = true;
+			deactivated_ = false;
+			event_thread_ = std::thread(&TcpServer::uringLoop, this);
+			return true;
+		}
+#endif
+
+		// Event loop, ktery hlida sockety vsech klientu
+		epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+		if (epoll_fd_ == -1)
+		{
+			LOG_ERR("Failed to create epoll instance");
+			return false;
+		}
+
 		run_ = true;
 		deactivated_ = false;
+		event_thread_ = std::thread(&TcpServer::eventLoop, this);
 		//LOG_DBG("Threads spawned");
 		
 		return true;
@@ -130,6 +239,10 @@ bool TcpServer::deactivate()
 			}
 
 			deactivated_ = true;
+#ifdef WEBSERVER_IO_URING
+			// Probudit vlakna cekajici v acceptConnection()
+			accept_cond_.notify_all();
+#endif
 			//LOG_DBG("TCP server deactivated");
 
 			return true;
@@ -159,7 +272,17 @@ bool TcpServer::stop()
 
 			run_ = false;
 
-			for (std::shared_ptr<TcpServer::Connection>& conn : connections_)
+			// io_uring event loop ceka na CQE sends obsluhy az do zastaveni vlaken (data sends patri obsluze)
+			if (event_thread_.joinable() && backend_ == NetworkBackend::EPOLL) {
+				event_thread_.join();
+			}
+			if (epoll_fd_ != -1) 
+			{
+				close(epoll_fd_);
+				epoll_fd_ = -1;
+			}
+
+			connections_.forEach([&ret](std::shared_ptr<TcpServer::Connection>& conn)
 			{
 				if (shutdown(conn->socket_, SHUT_RDWR) == -1) 
 				{
@@ -172,7 +295,7 @@ bool TcpServer::stop()
 					//LOG_DBG("Failed to close client socket");
 					ret = false;
 				}
-			}
+			});
 			
 			//LOG_DBG("Stopping threads...");
 			if (!thread_pool_.stop(true))
@@ -180,6 +303,44 @@ bool TcpServer::stop()
 				LOG_ERR("Failed to stop TCP server (failed to stop threads)");
 				ret = false;
 			}
+			if (!disk_pool_.stop(true))
+			{
+				LOG_ERR("Failed to stop TCP server (failed to stop disk I/O threads)");
+				ret = false;
+			}
+
+#ifdef WEBSERVER_IO_URING
+			if (backend_ == NetworkBackend::IO_URING)
+			{
+				uring_draining_ = false;
+				if (event_thread_.joinable()) {
+					event_thread_.join();
+				}
+				stopUring();
+			}
+#endif
+
+			// Obsluha spojeni drzi odkaz na spojeni -> zruseni cyklickych odkazu
+			connections_.forEach([](std::shared_ptr<TcpServer::Connection>& conn) {
+				conn->task_.reset();
+			});
+			timers_.clear();
+
+			LOG_INFO("Connections closed on timeout (keep-alive: %lu, header: %lu, body: %lu)", 
+				static_cast<unsigned long>(timeout_stats_.keepalive), static_cast<unsigned long>(timeout_stats_.header), 
+				static_cast<unsigned long>(timeout_stats_.body));
+			static const char* const priority_names[ThreadPool::PRIORITIES] = { "interactive", "bulk", "background" };
+			for (size_t i = 0; i < ThreadPool::PRIORITIES; ++i)
+			{
+				const ThreadPool::LaneStats lane = thread_pool_.laneStats(static_cast<ThreadPool::TaskPriority>(i));
+				LOG_INFO("Tasks %s (count: %lu, max queued: %lu, avg wait: %lu us, max wait: %lu us)", priority_names[i], 
+					static_cast<unsigned long>(lane.tasks), static_cast<unsigned long>(lane.max_queued), 
+					static_cast<unsigned long>(lane.tasks ? lane.wait_us / lane.tasks : 0), static_cast<unsigned long>(lane.max_wait_us));
+			}
+			const ThreadPool::LaneStats disk = disk_pool_.laneStats(ThreadPool::TaskPriority::INTERACTIVE);
+			LOG_INFO("Disk I/O tasks (count: %lu, max queued: %lu, avg wait: %lu us, max wait: %lu us)", 
+				static_cast<unsigned long>(disk.tasks), static_cast<unsigned long>(disk.max_queued), 
+				static_cast<unsigned long>(disk.tasks ? disk.wait_us / disk.tasks : 0), static_cast<unsigned long>(disk.max_wait_us));
 			
 			//LOG_DBG("TCP server stopped");
 			return ret;
@@ -201,12 +362,23 @@ bool TcpServer::reset()
 		deactivated_ = false;
 		socket_ = -1;
 		socket_ssl_ = -1;
+		epoll_fd_ = -1;
 		memset(&server_, 0, sizeof(server_));
 		memset(&server_ssl_, 0, sizeof(server_ssl_));
 		max_connections_ = 0;
+		max_header_size_ = 0;
+		body_buffer_size_ = 0;
+		reuse_port_ = false;
+		keepalive_timeout_ = 0;
+		header_timeout_ = 0;
+		body_timeout_ = 0;
+		timers_.clear();
+		timeout_stats_.keepalive = 0;
+		timeout_stats_.header = 0;
+		timeout_stats_.body = 0;
 		connections_.clear();
 
-		if (!thread_pool_.reset()) {
+		if (!thread_pool_.reset() || !disk_pool_.reset()) {
 			return false;
 		}
 
@@ -217,14 +389,41 @@ bool TcpServer::reset()
 }
 
 
-bool TcpServer::set()
+bool TcpServer::set(const size_t shards)
 {
-	if (!run_)
+	if (!run_ && shards > 0)
 	{
 		const Config::Params& params = Config::params();
 
-		max_connections_ = params.client_threads;
-		thread_pool_.resize(params.client_threads);
+		// Spojeni a vlakna se rozdeli mezi shardy
+		reuse_port_ = (shards > 1);
+		max_connections_ = std::max<uint32_t>(1, params.max_connections / shards);
+		max_header_size_ = params.max_header_size;
+		body_buffer_size_ = params.client_body_buffer_size;
+		keepalive_timeout_ = std::max<int>(MIN_TIMEOUT, std::min<uint32_t>(params.keepalive_timeout, INT_MAX / 1000) * 1000);
+		header_timeout_ = std::max<int>(MIN_TIMEOUT, std::min<uint32_t>(params.client_header_timeout, INT_MAX / 1000) * 1000);
+		body_timeout_ = std::max<int>(MIN_TIMEOUT, std::min<uint32_t>(params.client_body_timeout, INT_MAX / 1000) * 1000);
+
+		backend_ = NetworkBackend::EPOLL;
+		if (params.network_backend == NETWORK_BACKEND_IO_URING)
+		{
+#ifdef WEBSERVER_IO_URING
+			backend_ = NetworkBackend::IO_URING;
+#else
+			LOG_ERR("Network backend io_uring is not compiled in, using epoll");
+#endif
+		}
+		else if (params.network_backend != NETWORK_BACKEND_EPOLL) {
+			LOG_ERR("Unknown network backend %s, using epoll", params.network_backend.c_str());
+		}
+
+		// Minimum vlaken bezi stale, do maxima se pridavaji pri zatizeni
+		const size_t threads = std::max<size_t>(1, (params.client_threads + shards - 1) / shards);
+		const size_t threads_max = std::max<size_t>(threads, (params.client_threads_max + shards - 1) / shards);
+		thread_pool_.resize(threads, threads_max);
+		thread_pool_.setScaling(params.client_threads_spawn_delay, 
+			std::min<uint32_t>(params.client_threads_idle_timeout, UINT32_MAX / 1000) * 1000);
+		disk_pool_.resize(std::max<size_t>(1, (params.disk_io_threads + shards - 1) / shards));
 		server_.sin_family = AF_INET;
 		server_.sin_port = htons(params.port);
 		server_ssl_.sin_family = AF_INET;
@@ -244,7 +443,13 @@ std::shared_ptr<TcpServer::Connection> TcpServer::acceptConnection()
 	std::shared_ptr<TcpServer::Connection> connection(new TcpServer::Connection());
 	if (run_ && !deactivated_)
 	{
-		connection->socket_ = accept(socket_, nullptr, 0);
+#ifdef WEBSERVER_IO_URING
+		if (backend_ == NetworkBackend::IO_URING) {
+			connection->socket_ = acceptUring(accepted_);
+		}
+		else
+#endif
+		connection->socket_ = accept4(socket_, nullptr, 0, SOCK_NONBLOCK | SOCK_CLOEXEC);
 		if (connection->socket_ == -1) {
 			//LOG_DBG("Failed to accept client connection (error: %s)", strerror(errno));
 		}
@@ -259,16 +464,125 @@ std::shared_ptr<TcpServer::Connection> TcpServer::acceptConnectionSsl()
 	std::shared_ptr<TcpServer::Connection> connection(new TcpServer::Connection());
 	if (run_ && !deactivated_)
 	{
-		connection->socket_ = accept(socket_ssl_, nullptr, 0);
+#ifdef WEBSERVER_IO_URING
+		if (backend_ == NetworkBackend::IO_URING) {
+			connection->socket_ = acceptUring(accepted_ssl_);
+		}
+		else
+#endif
+		connection->socket_ = accept4(socket_ssl_, nullptr, 0, SOCK_NONBLOCK | SOCK_CLOEXEC);
 		if (connection->socket_ == -1) {
 			//LOG_DBG("Failed to accept client connection (error: %s)", strerror(errno));
 		}
+		connection->secure_ = true;
 	}
 
 	return connection;
 }
 
-bool TcpServer::handleConnection(std::shared_ptr<TcpServer::Connection>& connection, const Task& task)
+
+bool TcpServer::initSsl(std::shared_ptr<TcpServer::Connection>& connection, SSL_CTX* ctx)
+{
+	SSL* ssl = SSL_new(ctx);
+	if (!ssl) {
+		return false;
+	}
+	SSL_set_fd(ssl, connection->socket_);
+	SSL_set_accept_state(ssl);
+	// Zapis odlozeny pri plnem socketu se opakuje z kopie dat (jina adresa nez pri prvnim pokusu)
+	SSL_set_mode(ssl, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+	connection->handshake_ = ssl;
+	return true;
+}
+
+
+int TcpServer::acceptSsl(const std::shared_ptr<TcpServer::Connection>& connection, short& wait_events)
+{
+	// Vraci: 1 -> handshake dokoncen, 0 -> pokracovat az bude socket pripraven na wait_events, -1 -> chyba
+	// Socket je neblokujici -> kazde volani zpracuje jen zpravy klienta, ktere uz prisly
+	wait_events = 0;
+	SSL* ssl = connection->handshake_;
+	const int ret = SSL_accept(ssl);
+	if (ret != 1)
+	{
+		switch (SSL_get_error(ssl, ret))
+		{
+			case SSL_ERROR_WANT_READ:
+				wait_events = POLLIN;
+				return 0;
+			case SSL_ERROR_WANT_WRITE:
+				wait_events = POLLOUT;
+				return 0;
+			default:
+				return -1;
+		}
+	}
+
+	connection->ssl_ = ssl;
+	connection->handshake_ = nullptr;
+	connection->tls_mode_ = TlsMode::USERSPACE;
+#ifndef OPENSSL_NO_KTLS
+	// kTLS se zapina behem handshake, pokud to kernel a zvolena cipher suite umoznuji
+	if (BIO_get_ktls_send(SSL_get_wbio(ssl)))
+	{
+		connection->tls_mode_ = (BIO_get_ktls_recv(SSL_get_rbio(ssl))) ? 
+			TlsMode::KERNEL : TlsMode::KERNEL_SEND;
+	}
+#endif
+	//LOG_DBG("TLS mode: %d", static_cast<int>(connection->tls_mode_));
+	return 1;
+}
+
+
+bool TcpServer::handshakeSsl(std::shared_ptr<TcpServer::Connection>& connection)
+{
+	if (connection->ssl_) {
+		return true;
+	}
+	else if (!connection->handshake_) {
+		return false;
+	}
+
+	// Event loop predal spojeni pred dokoncenim handshake (cekani na zapis, ukonceni spojeni) -> dokoncit s cekanim
+	// Handshake se pocita do casu na hlavicku, ktery bezi uz od prijeti spojeni (nezacina znovu v obsluze)
+	const std::chrono::steady_clock::time_point deadline = takeHeaderDeadline(connection);
+	short wait_events = 0;
+	int ret;
+	while ((ret = acceptSsl(connection, wait_events)) == 0)
+	{
+		const int timeout = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+			deadline - std::chrono::steady_clock::now()).count());
+		if (timeout <= 0)
+		{
+			countTimeout(TimeoutKind::HEADER);
+			return false;
+		}
+		const int wait = waitForSocket(connection, wait_events, timeout);
+		if (wait != 1)
+		{
+			if (wait == 0) {
+				countTimeout(TimeoutKind::HEADER);
+			}
+			return false;
+		}
+	}
+
+	// Zbytek casu plati i pro hlavicku prvniho requestu
+	std::lock_guard<std::mutex> lock(timer_mutex_);
+	connection->header_deadline_ = deadline;
+	return (ret == 1);
+}
+
+
+size_t TcpServer::connectionsCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return connections_.size();
+}
+
+
+bool TcpServer::handleConnection(std::shared_ptr<TcpServer::Connection>& connection, Task&& task)
 {
 	try
 	{
@@ -276,14 +590,34 @@ bool TcpServer::handleConnection(std::shared_ptr<TcpServer::Connection>& connect
 		if (run_)
 		{
 			// Kontrola zda jiz nepresahuji max. pocet povolenych pripojeni
-			if (connections_.size() == max_connections_) {
+			if (connections_.size() >= max_connections_) {
 				return false;
 			}
 
-			//LOG_DBG("concection_count checked\n");
-
-			connections_.push_back(connection);
-			thread_pool_.queueTask(task);
+			// Predani socketu event loopu -> obsluha se spusti az bude v socketu cely request
+			connection->task_ = std::move(task);
+			connection->slot_ = connections_.insert(connection);
+			// Klient musi poslat request do vyprseni casu na hlavicku
+			armTimer(connection, TimeoutKind::HEADER);
+#ifdef WEBSERVER_IO_URING
+			if (backend_ == NetworkBackend::IO_URING)
+			{
+				armUringConnection(connection);
+				return true;
+			}
+#endif
+			// Udalost nese handle spojeni -> event loop spojeni najde bez prohledavani
+			epoll_event event = {0};
+			event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+			event.data.u64 = connection->slot_;
+			if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, connection->socket_, &event) == -1) 
+			{
+				cancelTimer(connection);
+				connections_.erase(connection->slot_);
+				connection->slot_ = SlotMap<std::shared_ptr<TcpServer::Connection>>::INVALID_HANDLE;
+				connection->task_.reset();
+				return false;
+			}
 
 			//LOG_DBG("Handling client connection");
 			return true;
@@ -299,6 +633,19 @@ bool TcpServer::handleConnection(std::shared_ptr<TcpServer::Connection>& connect
 
 
 bool TcpServer::endConnection(std::shared_ptr<TcpServer::Connection>& connection)
+{
+	// Odpoved se jeste odesila (socket byl plny) -> spojeni se ukonci az po jejim odeslani
+	if (run_ && !connection->pending_output_.empty())
+	{
+		connection->close_pending_ = true;
+		return true;
+	}
+
+	return closeConnection(connection);
+}
+
+
+bool TcpServer::closeConnection(std::shared_ptr<TcpServer::Connection>& connection)
 {
 	try
 	{
@@ -307,12 +654,21 @@ bool TcpServer::endConnection(std::shared_ptr<TcpServer::Connection>& connection
 		if (run_)
 		{	
 			//LOG_DBG("TcpServer::endConnection() jede");
-			if (connection->socket_ == -1 || connections_.empty()) {
+			if (connection->socket_ == -1) {
 				return false;
 			}
 			
 			//LOG_DBG("Closing socket...");
 			
+			// Odebrani z event loopu (spojeni, ktere nebylo predano event loopu, v nem neni)
+#ifdef WEBSERVER_IO_URING
+			if (backend_ == NetworkBackend::IO_URING) {
+				cancelUringConnection(connection);
+			}
+			else
+#endif
+			epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, connection->socket_, nullptr);
+
 			// Zavreni socketu
 			bool ret = true;
 			if (shutdown(connection->socket_, SHUT_RDWR) == -1) 
@@ -329,16 +685,9 @@ bool TcpServer::endConnection(std::shared_ptr<TcpServer::Connection>& connection
 			//LOG_DBG("TcpServer::endConnection() mazani");
 
 			// Odstraneni z ulozenych pripojeni
-			auto connection_it = std::find_if(connections_.begin(), connections_.end(),
-			[&connection](const std::shared_ptr<TcpServer::Connection>& conn)
-			{
-				return (connection->socket_ == conn->socket_);
-			});
-			
-			if (connection_it != connections_.end()) {
-				connections_.erase(connection_it);
-			}
-			
+			cancelTimer(connection);
+			connections_.erase(connection->slot_);
+			connection->slot_ = SlotMap<std::shared_ptr<TcpServer::Connection>>::INVALID_HANDLE;
 			connection->socket_ = -1;
 				
 			//LOG_DBG("Client disconnected");
@@ -354,331 +703,2287 @@ bool TcpServer::endConnection(std::shared_ptr<TcpServer::Connection>& connection
 }
 
 
-int TcpServer::sendAll(const std::shared_ptr<TcpServer::Connection>& connection, const char* data, const size_t size)
+static void blockLoopSignals()
 {
-    size_t total = 0;
-    size_t bytesleft = size;
-    int n;
-	int ret;
+	// Signaly obsluhuje hlavni vlakno (obsluha signalu zastavuje server a ceka na toto vlakno)
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGTERM);
+	sigaddset(&signals, SIGHUP);
+	pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+}
+
+void TcpServer::eventLoop()
+{
+	blockLoopSignals();
 
-    while (total < size)
+	epoll_event events[EVENT_LOOP_MAX_EVENTS];
+	while (run_)
 	{
-		errno = 0;
-		if (connection->ssl_)	
+		const int count = epoll_wait(epoll_fd_, events, EVENT_LOOP_MAX_EVENTS, EVENT_LOOP_TIMEOUT);
+		if (count == -1)
 		{
-			size_t nn = 0;
-			ret = SSL_write_ex(connection->ssl_, data + total, bytesleft, &nn);
-			n = static_cast<int>(nn);
+			if (errno == EINTR) {
+				continue;
+			}
+			LOG_ERR("Event loop failed (error: %s)", strerror(errno));
+			break;
 		}
-		else 
+
+		expireTimers();
+
+		for (int i = 0; i < count; ++i)
 		{
-        	ret = send(connection->socket_, data + total, bytesleft, MSG_NOSIGNAL);
-			n = ret;
-		}
+			std::shared_ptr<TcpServer::Connection> connection;
+			{
+				// Spojeni uz mohlo byt ukonceno (slot pak ma jinou generaci)
+				std::lock_guard<std::mutex> lock(mutex_);
+				const std::shared_ptr<TcpServer::Connection>* found = connections_.find(events[i].data.u64);
+				if (!found) {
+					continue;
+				}
+				connection = *found;
+			}
 
-        total += n;
-        bytesleft -= n;
-    }
+			// Odpoved ceka na misto v socketu -> pokracovat v odesilani (dalsi request az po jejim odeslani)
+			if (connection->parked_)
+			{
+				bool parked = true;
+				if ((events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) && 
+					connection->parked_.compare_exchange_strong(parked, false)) 
+				{
+					resumeOutput(connection);
+				}
+				continue;
+			}
 
-	return 1;
-}
+			// Obsluha ceka na dalsi cast tela requestu -> spustit ji znovu, az bude v bufferu
+			if (connection->awaiting_input_)
+			{
+				checkInput(connection);
+				continue;
+			}
 
-int TcpServer::sendText(const std::shared_ptr<TcpServer::Connection>& connection, const std::string& data)
-{
-	return sendText(connection, data.c_str(), data.size());
-}
+			// Spojeni uz zpracovava nektere vlakno -> po dokonceni si samo zkontroluje dalsi data
+			if (connection->dispatched_) {
+				continue;
+			}
 
-int TcpServer::sendText(const std::shared_ptr<TcpServer::Connection>& connection, const char* data, const size_t size)
-{
-	if (run_ && data != nullptr && size > 0)
-	{
-		int ret = sendAll(connection, data, size);
-		if (ret == -1) {
-			//LOG_DBG("Failed to send data");
+			// Ukonceni spojeni nebo chybu na socketu musi take zpracovat obsluha spojeni
+			const bool hangup = ((events[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0);
+			if (hangup || isRequestReady(connection)) {
+				dispatchConnection(connection);
+			}
 		}
-		
-		return ret;
 	}
-	
-	return -1;
 }
 
 
-int TcpServer::waitForData(const std::shared_ptr<TcpServer::Connection>& connection) {
-    //LOG_DBG("TcpServer::waitForData()...");
-
-	int ret;
-    if (connection->ssl_) 
-	{
-        ret = SSL_pending(connection->ssl_);
-        if (ret > 0) {
-            //LOG_DBG("SSL data pending: %d bytes", ret);
-            return 1;
-        }
+bool TcpServer::isRequestReady(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+#ifdef WEBSERVER_IO_URING
+	if (usesUring(connection)) {
+		return isRequestReadyUring(connection);
 	}
+#endif
 
-	fd_set read_fds;
-	FD_ZERO(&read_fds);
-	FD_SET(connection->socket_, &read_fds);
-	struct timeval timeout = {0, 0};
-	ret = select(connection->socket_ + 1, &read_fds, nullptr, nullptr, &timeout);
-	if (ret == -1) {
-		//LOG_DBG("select error: %s", strerror(errno));
-		return -1;
-	} 
-	else if (ret == 0) {
-		//LOG_DBG("No data on socket");
-		return 0;
-	}
+	// Request je pripraven az je v bufferu spojeni cela jeho hlavicka (u HTTPS desifrovana)
+	// -> pomaly klient drzi jen misto v event loopu, ne vlakno obsluhy
+	std::lock_guard<std::mutex> lock(connection->recv_mutex_);
 
-	uint8_t buffer;
-	if (connection->ssl_) {
-		ret = SSL_peek(connection->ssl_, &buffer, sizeof(buffer));
+	// Spojeni mezitim prevzalo vlakno obsluhy -> data si nacte samo
+	if (connection->dispatched_) {
+		return false;
 	}
-	else {
-		ret = recv(connection->socket_, &buffer, sizeof(buffer), MSG_PEEK);
+
+	// TLS handshake probiha take zde (bez cekani), cas na nej hlida casovac hlavicky z handleConnection()
+	if (connection->secure_ && !connection->ssl_)
+	{
+		short wait_events = 0;
+		const int ret = (connection->handshake_) ? acceptSsl(connection, wait_events) : -1;
+		// Chyba, nebo handshake ceka na misto v socketu (event loop ceka jen na data) -> zpracuje obsluha spojeni
+		if (ret == -1 || wait_events == POLLOUT) {
+			return true;
+		}
+		else if (ret == 0) {
+			return false;
+		}
 	}
 
-	if (ret > 0) {
-		return 1;
-	} 
-	else {
-		//LOG_DBG("SSL_peek error: %d", SSL_get_error(connection->ssl_, ret));
-		return -1;
+	// Edge-triggered epoll -> nacist vse co je v socketu (hlavicku a male telo)
+	std::string& buffer = connection->recv_buffer_;
+	bool header = false;
+	while (!isRequestBuffered(connection, header))
+	{
+		// Hlavicka presahuje maximalni velikost -> obsluha spojeni odpovi
+		if (!header && buffer.size() >= max_header_size_) {
+			return true;
+		}
+
+		size_t received = 0;
+		const int ret = recvToBuffer(connection, received);
+		// Klient ukoncil spojeni nebo chyba -> zpracuje obsluha spojeni
+		if (ret != 1) {
+			return true;
+		}
+		else if (received == 0) 
+		{
+			// Cast hlavicky uz prisla -> cela musi prijit do vyprseni casu na hlavicku, telo pak do vyprseni casu na telo
+			if (header) {
+				armTimer(connection, TimeoutKind::BODY);
+			}
+			else if (!buffer.empty()) {
+				armTimer(connection, TimeoutKind::HEADER);
+			}
+			return false;
+		}
 	}
+
+	return true;
 }
 
-int TcpServer::receiveText(const std::shared_ptr<TcpServer::Connection>& connection, std::string& data, const uint64_t max_size_to_recv, const std::string& terminator, const bool peek_data)
+
+// Velikost tela requestu, ktere se ma prijmout jeste pred predanim spojeni obsluze (0 -> predat hned)
+static size_t prebufferedBodySize(const HttpRequestParser::Request& request, const size_t limit)
 {
-	//LOG_DBG("receiveText(term) called...");
+	// Klient ceka na 100 Continue, nebo neznama delka -> telo prijima obsluha
+	if (request.header(HttpHeaderField::EXPECT) || request.header(HttpHeaderField::TRANSFER_ENCODING)) {
+		return 0;
+	}
 
-	uint64_t total = 0;
-	int data_available;
-	int n;
-	int ret;
+	// Velke telo se uklada do docasneho souboru po castech -> prijima ho obsluha
+	return (request.content_length <= limit) ? static_cast<size_t>(request.content_length) : 0;
+}
 
-	// Pockat az budou nejaka data dostupna
-	ret = waitForData(connection);
-	if (ret != 1) {
-		//LOG_DBG("Returning...");
-		return ret; }
 
-	//LOG_DBG("Wait for data done");
+bool TcpServer::isRequestBuffered(const std::shared_ptr<TcpServer::Connection>& connection, bool& header) const
+{
+	// Request je pripraven az je v bufferu cela jeho hlavicka a telo (pokud se vejde do bufferu tela)
+	// -> vlakno obsluhy pak na data z klienta neceka
+	// Parser pokracuje jen s nove prijatymi daty a jeho stav prevezme obsluha (hlavicka se parsuje jen jednou)
+	const std::string& buffer = connection->recv_buffer_;
+	HttpRequestParser& parser = connection->parser_;
+	const HttpRequestParser::Result result = 
+		parser.parse(std::string_view(buffer.data(), std::min<size_t>(buffer.size(), max_header_size_)));
+	header = (result != HttpRequestParser::Result::INCOMPLETE);
+	// Nevalidni hlavicka -> obsluha odpovi hned
+	if (result != HttpRequestParser::Result::COMPLETED) {
+		return header;
+	}
 
-	// Nacteni samotnych dat
-	data.reserve(max_size_to_recv);
+	const size_t body_size = prebufferedBodySize(parser.request(), body_buffer_size_);
+	return (buffer.size() >= parser.headerSize() + body_size);
+}
 
-	while (isConnected(connection))
-	{
-		bool ssl_read_attempted = false;
 
-        if (connection->ssl_) 
-		{
-            // Attempt to read at least 1 byte to trigger SSL processing
-			size_t nn = 0;
-            uint8_t buffer;
-            ret = SSL_peek_ex(connection->ssl_, &buffer, sizeof(buffer), &nn);
-            if (ret == 1) 
-			{
-                data_available = SSL_pending(connection->ssl_) + nn;
-                ssl_read_attempted = true;
-            } 
-			else 
-			{
-                int ssl_err = SSL_get_error(connection->ssl_, ret);
-                if (ssl_err == SSL_ERROR_WANT_READ || ssl_err == SSL_ERROR_WANT_WRITE) 
-				{
-                    usleep(RTT_2);
-                    continue;
-                }
-				else {
-                    return -1;
-                }
-            }
-        } 
+bool TcpServer::dispatchConnection(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	bool dispatched = false;
+	if (!connection->dispatched_.compare_exchange_strong(dispatched, true)) {
+		return false;
+	}
 
-		else 
-		{
-            if (ioctl(connection->socket_, FIONREAD, &data_available) == -1) 
-			{
-                //LOG_DBG("Failed to get socket buffer data amount");
-                return -1;
-            }
-        }
+	// Spojeni prevzala obsluha -> casy pri prijmu a odesilani hlida sama
+	cancelTimer(connection);
 
-        if (!ssl_read_attempted && data_available == 0) {
-            usleep(RTT_2);
-            continue;
-        }
-		
-		// Nactu vsechna data ktera jsou aktualne dostupna v socketu
-		data.resize(data_available);
-		while (total != data.size())
-		{
-			errno = 0;
+	const bool ret = thread_pool_.queueTask([this, connection]() {
+		runConnection(connection);
+	}, connection->priority_);
 
-			if (connection->ssl_)
-			{
-				size_t nn = 0;
-				ret = SSL_peek_ex(connection->ssl_, const_cast<char*>(data.data()) + total, data.size() - total, &nn);
-				n = static_cast<int>(nn);
-			}
-			else 
-			{
-				ret = recv(connection->socket_, const_cast<char*>(data.data()) + total, data.size() - total, MSG_PEEK);
-				n = ret;
-			}
+	if (!ret) {
+		connection->dispatched_ = false;
+	}
+	return ret;
+}
 
-			// Kontrola chyby
-			if (ret == -1){
-				return -1;
-			}
-			// Kontrola zda nebylo preruseno spojeni
-			else if (ret == 0) {
-				return 0;
-			}
 
-			total += n;
-		}
+void TcpServer::runConnection(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	connection->task_();
 
-		const size_t end_header_index = data.rfind(terminator);
-		if (end_header_index == std::string::npos)  // Zatim terminator nenalezen
-		{
-			if (total >= data.capacity()) { return -2; }
-			else { continue; }
-		}
-		else 
+	// Obsluha ceka na dalsi cast tela requestu -> vlakno se uvolni, obsluhu spusti znovu event loop
+	if (connection->input_wanted_ != 0)
+	{
+		suspendForInput(connection);
+		return;
+	}
+
+	// Obsluha ceka na diskove operace requestu -> po jejich dokonceni se spusti znovu a odesle odpoved
+	// (zaradi se az tady, aby obsluhu nespustilo jine vlakno drive, nez se z ni vrati toto)
+	if (offload_task_)
+	{
+		Task disk_task = [this, connection, task = std::move(offload_task_)]() mutable
 		{
-			// Odstranit nacetla data, ktera se nacetla navic
-			if (data.size() > (end_header_index + terminator.size())) {
-				data.erase(end_header_index + terminator.size());
+			task();
+			if (!thread_pool_.queueTask([this, connection]() { runConnection(connection); }, connection->priority_)) {
+				runConnection(connection);
 			}
+		};
+		offload_task_.reset();
 
-			// Terminator nalezen, ale prekrocil maximalni limit
-			if (total > data.capacity()) { return -2; }
-			else { break; }
+		// Nezarazeny task zustava v disk_task (queueTask ho presouva az pri zarazeni) -> probehne primo zde
+		if (!disk_pool_.queueTask(std::move(disk_task))) {
+			disk_task();
 		}
+		return;
 	}
 
-	//LOG_DBG("\nTcpServer::receiveText(term) -> %s\n", data.c_str());
-
-	// Vyndat data ze socketu
-	if (!peek_data)
-	{
-		total = 0;
-		while (total != data.size())
+	// Odpoved se cela nevesla do socketu -> zbytek se odesle az bude socket zapisovatelny (vlakno se uvolni)
+	if (connection->hasSocket() && !connection->pending_output_.empty()) {
+		parkConnection(connection);
+	}
+	// Po zpracovani requestu se spojeni vraci event loopu (keep-alive), nebo uz bylo ukonceno
+	else if (connection->hasSocket()) {
+		resumeConnection(connection);
+	}
+	else {
+		connection->task_.reset();
+	}
+}
+
+
+bool TcpServer::offloadConnection(const std::shared_ptr<TcpServer::Connection>& connection, Task&& task)
+{
+	// Jen z obsluhy spustene runConnection(), volajici se musi hned vratit (odpoved odesle az pri dalsim spusteni)
+	if (!thread_pool_.isWorkerThread() || !connection->hasSocket()) {
+		return false;
+	}
+
+	offload_task_ = std::move(task);
+	return true;
+}
+
+
+int TcpServer::awaitInput(const std::shared_ptr<TcpServer::Connection>& connection, const size_t size)
+{
+	// Jen z obsluhy spustene runConnection(), pri navratu 2 se volajici musi hned vratit (data vyzvedne az pri dalsim spusteni)
+	// -> pomaly klient posilajici velke telo drzi jen misto v event loopu, ne vlakno obsluhy
+	if (connection->input_expired_)
+	{
+		connection->input_expired_ = false;
+		return -1;
+	}
+	if (!thread_pool_.isWorkerThread() || !connection->hasSocket()) {
+		return 1;
+	}
+
+	std::lock_guard<std::mutex> lock(connection->recv_mutex_);
+	std::string& buffer = connection->recv_buffer_;
+#ifdef WEBSERVER_IO_URING
+	if (usesUring(connection))
+	{
+		// Pozastaveny prijem by na dalsi data cekal zbytecne
+		if (connection->recv_paused_)
+		{
+			connection->recv_paused_ = false;
+			if (!connection->recv_request_ && !connection->recv_eof_) {
+				armUringConnection(connection);
+			}
+		}
+		if (connection->recv_eof_ || buffer.size() >= size) {
+			return 1;
+		}
+	}
+	else
+#endif
+	{
+		// Nacist, co uz je v socketu (klient ukoncil spojeni nebo chyba -> zjisti prijem obsluhy)
+		size_t received = 1;
+		while (buffer.size() < size && received > 0)
+		{
+			if (recvToBuffer(connection, received) != 1) {
+				return 1;
+			}
+		}
+	}
+
+	if (buffer.size() >= size) {
+		return 1;
+	}
+	connection->input_wanted_ = size;
+	return 2;
+}
+
+
+void TcpServer::resumeConnection(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	// Dalsi request se zaradi jako interactive, dokud ho obsluha neprerazi
+	connection->priority_ = ThreadPool::TaskPriority::INTERACTIVE;
+	connection->dispatched_ = false;
+
+	// Data, ktera prisla behem zpracovani (edge-triggered epoll je uz znovu neohlasi)
+	if (run_ && isRequestReady(connection)) {
+		dispatchConnection(connection);
+	}
+	// Necinne spojeni (pokud uz neprisla cast dalsiho requestu, pak zustava casovac hlavicky)
+	else if (run_ && !connection->dispatched_) {
+		armTimer(connection, TimeoutKind::KEEPALIVE);
+	}
+}
+
+
+void TcpServer::suspendForInput(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	// Spojeni zustava dispatched_ -> event loop ho nepreda obsluze jako novy request, jen ji spusti az prijdou data
+	armTimer(connection, TimeoutKind::BODY);
+	connection->awaiting_input_ = true;
+
+	// Data mohla prijit pred nastavenim priznaku (edge-triggered epoll ani multishot recv je uz znovu neohlasi)
+	checkInput(connection);
+}
+
+
+bool TcpServer::isInputReady(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	std::lock_guard<std::mutex> lock(connection->recv_mutex_);
+	const std::string& buffer = connection->recv_buffer_;
+#ifdef WEBSERVER_IO_URING
+	if (usesUring(connection)) {
+		return (connection->recv_eof_ || buffer.size() >= connection->input_wanted_);
+	}
+#endif
+
+	// Edge-triggered epoll -> nacist vse co je v socketu
+	while (buffer.size() < connection->input_wanted_)
+	{
+		size_t received = 0;
+		// Klient ukoncil spojeni nebo chyba -> zpracuje obsluha spojeni
+		if (recvToBuffer(connection, received) != 1) {
+			return true;
+		}
+		else if (received == 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+void TcpServer::checkInput(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	bool awaiting = true;
+	if (isInputReady(connection) && connection->awaiting_input_.compare_exchange_strong(awaiting, false)) {
+		resumeInput(connection);
+	}
+}
+
+
+void TcpServer::resumeInput(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	cancelTimer(connection);
+	connection->input_wanted_ = 0;
+
+	// Server se zastavuje -> spojeni ukonci stop()
+	if (!thread_pool_.queueTask([this, connection]() { runConnection(connection); }, connection->priority_)) {
+		//LOG_DBG("Failed to queue connection waiting for request body");
+	}
+}
+
+
+void TcpServer::parkConnection(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	// Spojeni zustava dispatched_ -> event loop ho do odeslani odpovedi nepreda obsluze requestu
+	armTimer(connection, TimeoutKind::BODY);
+	connection->parked_ = true;
+
+#ifdef WEBSERVER_IO_URING
+	if (backend_ == NetworkBackend::IO_URING)
+	{
+		parkUringConnection(connection);
+		return;
+	}
+#endif
+
+	// Edge-triggered -> pokud uz je v socketu misto, udalost prijde hned
+	epoll_event event = {0};
+	event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	event.data.u64 = connection->slot_;
+	if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection->socket_, &event) == -1)
+	{
+		bool parked = true;
+		if (connection->parked_.compare_exchange_strong(parked, false)) {
+			resumeOutput(connection);
+		}
+	}
+}
+
+
+void TcpServer::resumeOutput(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	// Odesilani zbytku odpovedi ma tridu requestu (velky soubor -> bulk)
+	const bool ret = thread_pool_.queueTask([this, connection]() {
+		continueOutput(connection);
+	}, connection->priority_);
+
+	// Server se zastavuje -> spojeni ukonci stop()
+	if (!ret) {
+		//LOG_DBG("Failed to queue output of parked connection");
+	}
+}
+
+
+void TcpServer::continueOutput(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	cancelTimer(connection);
+
+	const int ret = drainOutput(connection);
+	if (ret == 1 && !connection->pending_output_.empty())
+	{
+		parkConnection(connection);
+		return;
+	}
+
+	std::shared_ptr<TcpServer::Connection> conn = connection;
+	if (ret != 1 || connection->close_pending_)
+	{
+		discardOutput(connection);
+		closeConnection(conn);
+		connection->task_.reset();
+		return;
+	}
+
+#ifdef WEBSERVER_IO_URING
+	if (backend_ != NetworkBackend::IO_URING)
+#endif
+	{
+		// Uz se neceka na zapis (jinak by kazde uvolneni mista v socketu budilo event loop)
+		epoll_event event = {0};
+		event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+		event.data.u64 = connection->slot_;
+		epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection->socket_, &event);
+	}
+
+	resumeConnection(connection);
+}
+
+
+void TcpServer::armTimer(const std::shared_ptr<TcpServer::Connection>& connection, const TimeoutKind kind)
+{
+	std::lock_guard<std::mutex> lock(timer_mutex_);
+
+	// Bezici casovac stejneho nebo dulezitejsiho druhu zustava (cas na hlavicku se neprodluzuje dalsimi daty)
+	if (connection->timer_ != 0)
+	{
+		if (connection->timer_kind_ >= kind) {
+			return;
+		}
+		timers_.cancel(connection->timer_);
+	}
+
+	int timeout = body_timeout_;
+	if (kind == TimeoutKind::KEEPALIVE) {
+		timeout = keepalive_timeout_;
+	}
+	else if (kind == TimeoutKind::HEADER) {
+		timeout = header_timeout_;
+	}
+	connection->timer_ = timers_.schedule(connection->slot_, static_cast<uint8_t>(kind), timeout);
+	connection->timer_kind_ = kind;
+
+	// Cas na hlavicku bezi od jejiho zacatku -> obsluha spojeni ho po predani neprodluzuje
+	if (kind == TimeoutKind::HEADER) {
+		connection->header_deadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+	}
+	else if (kind == TimeoutKind::KEEPALIVE) {
+		connection->header_deadline_ = std::chrono::steady_clock::time_point();
+	}
+}
+
+
+std::chrono::steady_clock::time_point TcpServer::takeHeaderDeadline(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	// Hlavicka zacala prichazet uz v event loopu -> zbyva jen zbytek casu, jinak cas bezi od ted
+	std::lock_guard<std::mutex> lock(timer_mutex_);
+	std::chrono::steady_clock::time_point deadline = connection->header_deadline_;
+	connection->header_deadline_ = std::chrono::steady_clock::time_point();
+	if (deadline == std::chrono::steady_clock::time_point()) {
+		deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(header_timeout_);
+	}
+	return deadline;
+}
+
+
+void TcpServer::cancelTimer(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	std::lock_guard<std::mutex> lock(timer_mutex_);
+	if (connection->timer_ != 0)
+	{
+		timers_.cancel(connection->timer_);
+		connection->timer_ = 0;
+	}
+}
+
+
+void TcpServer::expireTimers()
+{
+	std::vector<TimerWheel::Expired> expired;
+	{
+		std::lock_guard<std::mutex> lock(timer_mutex_);
+		timers_.advance(steadyTimeMs(), expired);
+	}
+
+	for (const TimerWheel::Expired& timer : expired)
+	{
+		std::shared_ptr<TcpServer::Connection> connection;
+		{
+			// Spojeni uz mohlo byt ukonceno (slot pak ma jinou generaci)
+			std::lock_guard<std::mutex> lock(mutex_);
+			const std::shared_ptr<TcpServer::Connection>* found = connections_.find(timer.key);
+			if (!found) {
+				continue;
+			}
+			connection = *found;
+		}
+
+		{
+			// Casovac byl mezitim nahrazen novym (spojeni mezitim zpracovala obsluha)
+			std::lock_guard<std::mutex> lock(timer_mutex_);
+			if (connection->timer_ != timer.timer) {
+				continue;
+			}
+			connection->timer_ = 0;
+		}
+
+		// Klient neprebira odpoved -> ukoncit, pokud spojeni mezitim neprevzalo vlakno pro dalsi odesilani
+		bool parked = true;
+		bool awaiting = true;
+		if (static_cast<TimeoutKind>(timer.kind) == TimeoutKind::BODY &&
+			connection->parked_.compare_exchange_strong(parked, false))
+		{
+			discardOutput(connection);
+		}
+		// Telo requestu neprislo vcas -> prijem obsluhy skonci chybou (obsluha odpovi a uklidi docasny soubor a zamek resource)
+		else if (static_cast<TimeoutKind>(timer.kind) == TimeoutKind::BODY &&
+			connection->awaiting_input_.compare_exchange_strong(awaiting, false))
+		{
+			countTimeout(TimeoutKind::BODY);
+			connection->input_expired_ = true;
+			resumeInput(connection);
+			continue;
+		}
+		// Spojeni ceka v event loopu (i na telo requestu), pokud ho prave neprevzala obsluha -> neukoncovat
+		else
+		{
+			bool dispatched = false;
+			if (!connection->dispatched_.compare_exchange_strong(dispatched, true)) {
+				continue;
+			}
+		}
+
+		//LOG_DBG("Connection timed out (kind: %d)", static_cast<int>(timer.kind));
+		countTimeout(static_cast<TimeoutKind>(timer.kind));
+		closeConnection(connection);
+		connection->task_.reset();
+	}
+}
+
+
+void TcpServer::countTimeout(const TimeoutKind kind)
+{
+	switch (kind)
+	{
+		case TimeoutKind::KEEPALIVE:
+			++timeout_stats_.keepalive;
+			break;
+		case TimeoutKind::HEADER:
+			++timeout_stats_.header;
+			break;
+		case TimeoutKind::BODY:
+			++timeout_stats_.body;
+			break;
+	}
+}
+
+
+int TcpServer::waitForSocket(const std::shared_ptr<TcpServer::Connection>& connection, const short events, const int timeout_ms) const
+{
+	pollfd pfd = { connection->socket_, events, 0 };
+	int ret;
+	do {
+		ret = poll(&pfd, 1, timeout_ms);
+	} while (ret == -1 && errno == EINTR);
+
+	if (ret == -1) {
+		return -1;
+	}
+	// Vyprsel cas
+	else if (ret == 0) {
+		return 0;
+	}
+
+	if ((pfd.revents & (POLLERR | POLLNVAL)) && !(pfd.revents & events)) {
+		return -1;
+	}
+	return 1;
+}
+
+
+int TcpServer::checkIo(const std::shared_ptr<TcpServer::Connection>& connection, const int ret, const short events, short& wait_events) const
+{
+	// Vraci: 1 -> operaci opakovat (az bude socket pripraven na wait_events, 0 -> hned), 0 -> klient ukoncil spojeni, -1 -> chyba
+	wait_events = 0;
+	if (connection->ssl_)
+	{
+		switch (SSL_get_error(connection->ssl_, ret))
+		{
+			case SSL_ERROR_WANT_READ:
+				wait_events = POLLIN;
+				return 1;
+			case SSL_ERROR_WANT_WRITE:
+				wait_events = POLLOUT;
+				return 1;
+			case SSL_ERROR_ZERO_RETURN:
+				return 0;
+			default:
+				return -1;
+		}
+	}
+
+	if (ret == 0) {
+		return 0;
+	}
+	else if (errno == EINTR) {
+		return 1;
+	}
+	else if (errno == EAGAIN || errno == EWOULDBLOCK) 
+	{
+		wait_events = events;
+		return 1;
+	}
+	else if (errno == EPIPE || errno == ECONNRESET) {
+		return 0;
+	}
+
+	return -1;
+}
+
+
+int TcpServer::waitForIo(const std::shared_ptr<TcpServer::Connection>& connection, const int ret, const short events) const
+{
+	// Vraci: 1 -> operaci opakovat, 0 -> klient ukoncil spojeni, -1 -> chyba
+	short wait_events;
+	const int status = checkIo(connection, ret, events, wait_events);
+	if (status != 1 || wait_events == 0) {
+		return status;
+	}
+
+	return ((waitForSocket(connection, wait_events, body_timeout_) == 1) ? 1 : -1);
+}
+
+
+int TcpServer::sendAll(const std::shared_ptr<TcpServer::Connection>& connection, const char* data, const size_t size)
+{
+#ifdef WEBSERVER_IO_URING
+	if (usesUring(connection)) 
+	{
+		const iovec iov = { const_cast<char*>(data), size };
+		return sendAllUring(connection, &iov, 1);
+	}
+#endif
+
+	size_t total = 0;
+	size_t bytesleft = size;
+	int ret;
+
+	while (total < size)
+	{
+		errno = 0;
+		size_t n = 0;
+		if (connection->ssl_)	
+		{
+			ret = SSL_write_ex(connection->ssl_, data + total, bytesleft, &n);
+			if (ret != 1) { ret = -1; }
+		}
+		else 
+		{
+			const ssize_t nn = send(connection->socket_, data + total, bytesleft, MSG_NOSIGNAL);
+			ret = ((nn > 0) ? 1 : -1);
+			n = ((nn > 0) ? nn : 0);
+		}
+
+		if (ret == -1)
+		{
+			short wait_events;
+			ret = checkIo(connection, ret, POLLOUT, wait_events);
+			if (ret != 1) {
+				return ret;
+			}
+
+			// Socket je plny -> zbytek se odesle pozdeji (TLS zapis se opakuje se stejnymi daty)
+			if (wait_events == POLLOUT)
+			{
+				const iovec iov = { const_cast<char*>(data + total), bytesleft };
+				return deferOutput(connection, &iov, 1);
+			}
+			if (wait_events != 0 && waitForSocket(connection, wait_events, body_timeout_) != 1) {
+				return -1;
+			}
+			continue;
+		}
+
+		total += n;
+		bytesleft -= n;
+	}
+
+	return 1;
+}
+
+int TcpServer::sendVector(const std::shared_ptr<TcpServer::Connection>& connection, iovec* iov, const size_t count, const bool more)
+{
+#ifdef WEBSERVER_IO_URING
+	if (usesUring(connection)) {
+		return sendAllUring(connection, iov, count);
+	}
+#endif
+
+	if (connection->ssl_) {
+		return sendVectorSsl(connection, iov, count);
+	}
+
+	// Vsechny casti jednim sendmsg (pri castecnem zapisu se pokracuje od prvni neodeslane)
+	const int flags = MSG_NOSIGNAL | ((more) ? MSG_MORE : 0);
+	size_t index = 0;
+	while (index < count)
+	{
+		if (iov[index].iov_len == 0)
+		{
+			++index;
+			continue;
+		}
+
+		msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov + index;
+		msg.msg_iovlen = std::min(count - index, static_cast<size_t>(IOV_MAX));
+
+		errno = 0;
+		const ssize_t nn = sendmsg(connection->socket_, &msg, flags);
+		if (nn <= 0)
+		{
+			short wait_events;
+			const int ret = checkIo(connection, -1, POLLOUT, wait_events);
+			if (ret != 1) {
+				return ret;
+			}
+
+			// Socket je plny -> zbytek se odesle az ho klient precte (obsluha na nej neceka)
+			if (wait_events == POLLOUT) {
+				return deferOutput(connection, iov + index, count - index);
+			}
+			continue;
+		}
+
+		size_t n = nn;
+		while (n > 0)
+		{
+			if (n >= iov[index].iov_len)
+			{
+				n -= iov[index].iov_len;
+				++index;
+			}
+			else
+			{
+				iov[index].iov_base = static_cast<char*>(iov[index].iov_base) + n;
+				iov[index].iov_len -= n;
+				n = 0;
+			}
+		}
+	}
+
+	return 1;
+}
+
+int TcpServer::sendVectorSsl(const std::shared_ptr<TcpServer::Connection>& connection, const iovec* iov, const size_t count)
+{
+	// Po odlozeni zapisu (plny socket) musi dalsi data za odlozena
+	auto sendRecords = [this, &connection](const char* data, const size_t size)
+	{
+		if (!connection->pending_output_.empty())
+		{
+			const iovec part = { const_cast<char*>(data), size };
+			return deferOutput(connection, &part, 1);
+		}
+		return sendAll(connection, data, size);
+	};
+
+	// Male casti se spojuji do plnych TLS zaznamu, velke se sifruji primo (bez kopirovani)
+	char record[TLS_RECORD_SIZE];
+	size_t record_size = 0;
+	int ret;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const char* data = static_cast<const char*>(iov[i].iov_base);
+		size_t left = iov[i].iov_len;
+		while (left > 0)
+		{
+			if (record_size == 0 && left >= TLS_RECORD_SIZE)
+			{
+				const size_t n = left - (left % TLS_RECORD_SIZE);
+				if ((ret = sendRecords(data, n)) != 1) {
+					return ret;
+				}
+				data += n;
+				left -= n;
+				continue;
+			}
+
+			const size_t n = std::min(TLS_RECORD_SIZE - record_size, left);
+			memcpy(record + record_size, data, n);
+			record_size += n;
+			data += n;
+			left -= n;
+
+			if (record_size == TLS_RECORD_SIZE)
+			{
+				if ((ret = sendRecords(record, record_size)) != 1) {
+					return ret;
+				}
+				record_size = 0;
+			}
+		}
+	}
+
+	return ((record_size > 0) ? sendRecords(record, record_size) : 1);
+}
+
+
+int TcpServer::sendText(const std::shared_ptr<TcpServer::Connection>& connection, const std::string& data)
+{
+	return sendText(connection, data.c_str(), data.size());
+}
+
+int TcpServer::sendText(const std::shared_ptr<TcpServer::Connection>& connection, const char* data, const size_t size)
+{
+	if (run_ && data != nullptr && size > 0)
+	{
+		// Odeslat spolu s tim, co uz je ve vystupni fronte
+		queueText(connection, data, size, false);
+		int ret = flushText(connection);
+		if (ret == -1) {
+			//LOG_DBG("Failed to send data");
+		}
+		
+		return ret;
+	}
+	
+	return -1;
+}
+
+void TcpServer::queueText(const std::shared_ptr<TcpServer::Connection>& connection, const std::string& data, const bool copy)
+{
+	queueText(connection, data.c_str(), data.size(), copy);
+}
+
+void TcpServer::queueText(const std::shared_ptr<TcpServer::Connection>& connection, const char* data, const size_t size, const bool copy)
+{
+	// Bez kopie musi data zustat platna az do flushText()
+	if (data == nullptr || size == 0) {
+		return;
+	}
+
+	if (copy)
+	{
+		connection->output_buffer_.append(data, size);
+		connection->output_queue_.push_back({ nullptr, size });
+	}
+	else {
+		connection->output_queue_.push_back({ const_cast<char*>(data), size });
+	}
+}
+
+int TcpServer::flushText(const std::shared_ptr<TcpServer::Connection>& connection, const bool more)
+{
+	std::vector<iovec>& queue = connection->output_queue_;
+	if (queue.empty()) {
+		return 1;
+	}
+	if (!run_)
+	{
+		discardText(connection);
+		return -1;
+	}
+
+	// Doplnit adresy zkopirovanych dat (buffer uz se nebude menit)
+	size_t buffer_offset = 0;
+	for (iovec& iov : queue)
+	{
+		if (iov.iov_base == nullptr)
+		{
+			iov.iov_base = const_cast<char*>(connection->output_buffer_.data()) + buffer_offset;
+			buffer_offset += iov.iov_len;
+		}
+	}
+
+	// Predchozi cast odpovedi jeste ceka na misto v socketu -> nova data az za ni
+	int ret = drainOutput(connection);
+	if (ret == 1)
+	{
+		if (connection->pending_output_.empty()) {
+			ret = sendVector(connection, queue.data(), queue.size(), more);
+		}
+		else {
+			ret = deferOutput(connection, queue.data(), queue.size());
+		}
+	}
+
+	discardText(connection);
+	if (ret != 1) {
+		discardOutput(connection);
+	}
+	return ret;
+}
+
+void TcpServer::discardText(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	connection->output_queue_.clear();
+	connection->output_buffer_.clear();
+}
+
+
+bool TcpServer::supportsSendFile(const std::shared_ptr<TcpServer::Connection>& connection) const
+{
+	// TLS sifrovane v userspace -> soubor nelze poslat primo z page cache
+	return (connection->ssl_ == nullptr || 
+			connection->tls_mode_ == TlsMode::KERNEL_SEND || connection->tls_mode_ == TlsMode::KERNEL);
+}
+
+int TcpServer::sendFile(const std::shared_ptr<TcpServer::Connection>& connection, const int file_fd, const uint64_t offset, const uint64_t size)
+{
+	if (!run_ || file_fd == -1 || !supportsSendFile(connection)) {
+		return -1;
+	}
+
+	// Hlavicka z vystupni fronty (MSG_MORE -> spoji se s prvnimi daty souboru do stejneho TCP segmentu)
+	int ret = flushText(connection, (connection->ssl_ == nullptr && size > 0));
+	if (ret != 1) {
+		return ret;
+	}
+	if (!connection->pending_output_.empty()) {
+		return deferFile(connection, file_fd, offset, size);
+	}
+
+	// Zero-copy odeslani souboru (offset souboru se nemeni, deskriptor muze sdilet vice spojeni)
+	off_t file_offset = static_cast<off_t>(offset);
+	uint64_t total = 0;
+	while (total < size)
+	{
+		errno = 0;
+		const size_t window = static_cast<size_t>(std::min(size - total, static_cast<uint64_t>(SENDFILE_WINDOW)));
+		ssize_t n;
+#ifndef OPENSSL_NO_KTLS
+		// kTLS -> zaznamy sifruje kernel, data se stale nekopiruji do userspace
+		if (connection->ssl_) {
+			n = SSL_sendfile(connection->ssl_, file_fd, file_offset, window, 0);
+		}
+		else
+#endif
+		n = sendfile(connection->socket_, file_fd, &file_offset, window);
+		if (n > 0)
+		{
+			if (connection->ssl_) {
+				file_offset += n;
+			}
+			total += n;
+			continue;
+		}
+		// Soubor je kratsi nez se cekalo (byl zmenen behem odesilani)
+		else if (n == 0 && !connection->ssl_) {
+			return -1;
+		}
+
+		short wait_events;
+		ret = checkIo(connection, static_cast<int>(n), POLLOUT, wait_events);
+		if (ret != 1) {
+			return ret;
+		}
+
+		// Socket je plny -> zbytek souboru se odesle az ho klient precte (pomaly klient nedrzi vlakno obsluhy)
+		if (wait_events == POLLOUT) {
+			return deferFile(connection, file_fd, static_cast<uint64_t>(file_offset), size - total);
+		}
+		if (wait_events != 0 && waitForSocket(connection, wait_events, body_timeout_) != 1) {
+			return -1;
+		}
+	}
+
+	return 1;
+}
+
+
+int TcpServer::deferOutput(const std::shared_ptr<TcpServer::Connection>& connection, const iovec* iov, const size_t count)
+{
+	size_t size = 0;
+	for (size_t i = 0; i < count; ++i) {
+		size += iov[i].iov_len;
+	}
+
+	// Prilis mnoho dat v pameti (napr. komprimovany soubor pro pomaleho klienta) -> do docasneho souboru
+	// Obsluha na odeslani neceka, usek souboru se odesila stejne jako odlozeny usek resource
+	std::deque<TcpServer::Connection::OutputSegment>& pending = connection->pending_output_;
+	if (connection->pending_memory_ + size > OUTPUT_PENDING_LIMIT && spillOutput(connection, iov, count, size)) {
+		return 1;
+	}
+
+	// Data volajiciho nemusi zustat platna -> kopie (bez TLS se pripojuji k predchozimu useku v pameti)
+	if (pending.empty() || pending.back().file_fd != -1 || connection->ssl_) {
+		pending.emplace_back();
+	}
+
+	std::string& data = pending.back().data;
+	for (size_t i = 0; i < count; ++i) {
+		data.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+	}
+	connection->pending_memory_ += size;
+
+	return 1;
+}
+
+
+bool TcpServer::spillOutput(const std::shared_ptr<TcpServer::Connection>& connection, const iovec* iov, const size_t count, const size_t size)
+{
+	// Soubor bez jmena (zmizi se zavrenim), jeden pro vsechna data nad limit, dokud se vse neodesle
+	if (connection->spill_fd_ == -1)
+	{
+		connection->spill_fd_ = open(TEMPORARY_FILES_DIR, O_TMPFILE | O_RDWR | O_CLOEXEC, S_IRUSR | S_IWUSR);
+		if (connection->spill_fd_ == -1) 
+		{
+			// Bez docasneho souboru zustanou data v pameti (obsluha stale neceka)
+			LOG_ERR("Failed to create temporary file for pending output (error: %s)", strerror(errno));
+			return false;
+		}
+		connection->spill_size_ = 0;
+	}
+
+	// Zapis celych dat na konec souboru
+	const uint64_t start = connection->spill_size_;
+	std::vector<iovec> rest(iov, iov + count);
+	size_t index = 0;
+	uint64_t written = 0;
+	while (written < size)
+	{
+		const ssize_t n = pwritev(connection->spill_fd_, rest.data() + index, static_cast<int>(std::min<size_t>(rest.size() - index, IOV_MAX)), 
+			static_cast<off_t>(start + written));
+		if (n <= 0)
+		{
+			if (n == -1 && errno == EINTR) {
+				continue;
+			}
+			LOG_ERR("Failed to write pending output to temporary file (error: %s)", strerror(errno));
+			return false;
+		}
+		written += n;
+		for (size_t left = static_cast<size_t>(n); left > 0 && index < rest.size(); )
+		{
+			const size_t len = std::min(left, rest[index].iov_len);
+			rest[index].iov_base = static_cast<char*>(rest[index].iov_base) + len;
+			rest[index].iov_len -= len;
+			left -= len;
+			if (rest[index].iov_len == 0) {
+				++index;
+			}
+		}
+	}
+	connection->spill_size_ += size;
+
+	// Navazuje na posledni odlozeny usek souboru -> jen se prodlouzi
+	std::deque<TcpServer::Connection::OutputSegment>& pending = connection->pending_output_;
+	if (!pending.empty() && pending.back().spilled && pending.back().offset + pending.back().size == start)
+	{
+		pending.back().size += size;
+		return true;
+	}
+
+	TcpServer::Connection::OutputSegment segment;
+	segment.file_fd = fcntl(connection->spill_fd_, F_DUPFD_CLOEXEC, 0);
+	if (segment.file_fd == -1) 
+	{
+		connection->spill_size_ = start;
+		return false;
+	}
+	segment.offset = start;
+	segment.size = size;
+	segment.spilled = true;
+	pending.push_back(std::move(segment));
+	return true;
+}
+
+
+void TcpServer::releaseSpill(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	// Vse odeslano -> docasny soubor uz nikdo necte (dalsi data nad limit zacnou v novem)
+	if (connection->spill_fd_ != -1)
+	{
+		close(connection->spill_fd_);
+		connection->spill_fd_ = -1;
+		connection->spill_size_ = 0;
+	}
+}
+
+
+int TcpServer::deferFile(const std::shared_ptr<TcpServer::Connection>& connection, const int file_fd, const uint64_t offset, const uint64_t size)
+{
+	if (size == 0) {
+		return 1;
+	}
+
+	// Volajici soubor po navratu zavira
+	TcpServer::Connection::OutputSegment segment;
+	segment.file_fd = fcntl(file_fd, F_DUPFD_CLOEXEC, 0);
+	if (segment.file_fd == -1) {
+		return -1;
+	}
+	segment.offset = offset;
+	segment.size = size;
+	connection->pending_output_.push_back(std::move(segment));
+
+	return 1;
+}
+
+
+int TcpServer::drainOutput(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	// Vraci: 1 -> OK (vse odeslano, nebo je socket plny a zbytek dal ceka), 0 -> klient ukoncil spojeni, -1 -> chyba
+	std::deque<TcpServer::Connection::OutputSegment>& pending = connection->pending_output_;
+	while (!pending.empty())
+	{
+		TcpServer::Connection::OutputSegment& segment = pending.front();
+		errno = 0;
+		ssize_t n;
+		if (segment.file_fd == -1)
 		{
-			errno = 0;
-
+			const char* data = segment.data.data() + segment.offset;
+			const size_t left = segment.data.size() - segment.offset;
 			if (connection->ssl_)
 			{
-				size_t nn = 0;
-				ret = SSL_read_ex(connection->ssl_, const_cast<char*>(data.data()) + total, data.size() - total, &nn);
-				n = static_cast<int>(nn);
+				size_t written = 0;
+				n = ((SSL_write_ex(connection->ssl_, data, left, &written) == 1) ? static_cast<ssize_t>(written) : -1);
+			}
+			else {
+				n = send(connection->socket_, data, left, MSG_NOSIGNAL | ((pending.size() > 1) ? MSG_MORE : 0));
+			}
+
+			if (n > 0)
+			{
+				segment.offset += n;
+				if (segment.offset == segment.data.size())
+				{
+					connection->pending_memory_ -= segment.data.size();
+					pending.pop_front();
+				}
+				continue;
+			}
+		}
+		else
+		{
+			const size_t window = static_cast<size_t>(std::min(segment.size, static_cast<uint64_t>(SENDFILE_WINDOW)));
+			off_t file_offset = static_cast<off_t>(segment.offset);
+			if (connection->ssl_ && !supportsSendFile(connection))
+			{
+				// TLS v userspace (jen docasny soubor spojeni) -> precist a zasifrovat
+				// SSL_write_ex po neuspechu opakuje stejny buffer -> cte se vzdy od prvniho neodeslaneho bytu
+				char buffer[SPILL_READ_CHUNK];
+				const ssize_t length = pread(segment.file_fd, buffer, std::min(window, sizeof(buffer)), file_offset);
+				if (length <= 0) {
+					return -1;
+				}
+				size_t written = 0;
+				n = ((SSL_write_ex(connection->ssl_, buffer, static_cast<size_t>(length), &written) == 1) ? static_cast<ssize_t>(written) : -1);
+			}
+#ifndef OPENSSL_NO_KTLS
+			else if (connection->ssl_) {
+				n = SSL_sendfile(connection->ssl_, segment.file_fd, file_offset, window, 0);
+			}
+#endif
+			else {
+				n = sendfile(connection->socket_, segment.file_fd, &file_offset, window);
+			}
+
+			if (n > 0)
+			{
+				segment.offset += n;
+				segment.size -= n;
+				if (segment.size == 0)
+				{
+					close(segment.file_fd);
+					pending.pop_front();
+				}
+				continue;
+			}
+			else if (n == 0 && !connection->ssl_) {
+				return -1;
+			}
+		}
+
+		short wait_events;
+		const int ret = checkIo(connection, static_cast<int>(n), POLLOUT, wait_events);
+		if (ret != 1) {
+			return ret;
+		}
+		// Socket je plny
+		else if (wait_events == POLLOUT) {
+			return 1;
+		}
+		// TLS potrebuje nejdriv data od klienta
+		else if (wait_events != 0 && waitForSocket(connection, wait_events, body_timeout_) != 1) {
+			return -1;
+		}
+	}
+
+	releaseSpill(connection);
+	return 1;
+}
+
+
+void TcpServer::discardOutput(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	for (const TcpServer::Connection::OutputSegment& segment : connection->pending_output_)
+	{
+		if (segment.file_fd != -1) {
+			close(segment.file_fd);
+		}
+	}
+	connection->pending_output_.clear();
+	connection->pending_memory_ = 0;
+	releaseSpill(connection);
+}
+
+
+bool TcpServer::usesUring(const std::shared_ptr<TcpServer::Connection>& connection) const
+{
+#ifdef WEBSERVER_IO_URING
+	return (backend_ == NetworkBackend::IO_URING && !connection->secure_);
+#else
+	return false;
+#endif
+}
+
+int TcpServer::recvData(const std::shared_ptr<TcpServer::Connection>& connection, char* data, const size_t size, size_t& received)
+{
+	// Vraci: 1 -> OK (received == 0 -> zatim nejsou data), 0 -> klient ukoncil spojeni, -1 -> chyba
+	received = 0;
+	errno = 0;
+
+	if (connection->ssl_)
+	{
+		const int ret = SSL_read_ex(connection->ssl_, data, size, &received);
+		if (ret != 1) 
+		{
+			const int ssl_err = SSL_get_error(connection->ssl_, ret);
+			if (ssl_err == SSL_ERROR_WANT_READ || ssl_err == SSL_ERROR_WANT_WRITE) {
+				return 1;
+			}
+			return ((ssl_err == SSL_ERROR_ZERO_RETURN) ? 0 : -1);
+		}
+		return 1;
+	}
+
+	const ssize_t ret = recv(connection->socket_, data, size, MSG_DONTWAIT);
+	if (ret == -1) {
+		return ((errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 1 : -1);
+	}
+	// Kontrola zda nebylo preruseno spojeni
+	else if (ret == 0) {
+		return 0;
+	}
+
+	received = ret;
+	return 1;
+}
+
+int TcpServer::recvToBuffer(const std::shared_ptr<TcpServer::Connection>& connection, size_t& received)
+{
+	// Volat jen se zamcenym recv_mutex_
+	std::string& buffer = connection->recv_buffer_;
+	const size_t size = buffer.size();
+
+	buffer.resize(size + RECV_CHUNK_SIZE);
+	const int ret = recvData(connection, const_cast<char*>(buffer.data()) + size, RECV_CHUNK_SIZE, received);
+	buffer.resize(size + received);
+
+	return ret;
+}
+
+int TcpServer::waitForBufferData(const std::shared_ptr<TcpServer::Connection>& connection, std::unique_lock<std::mutex>& lock, const size_t available,
+								 const int timeout_ms, const TimeoutKind kind)
+{
+	// Vraci: 1 -> v bufferu je vic nez available dat, 0 -> klient ukoncil spojeni, -1 -> chyba nebo vyprsel cas
+#ifdef WEBSERVER_IO_URING
+	if (usesUring(connection)) 
+	{
+		const int ret = waitForUringData(connection, lock, available, timeout_ms);
+		if (ret == -1 && run_) {
+			countTimeout(kind);
+		}
+		return ret;
+	}
+#endif
+
+	while (connection->recv_buffer_.size() <= available)
+	{
+		size_t received = 0;
+		int ret = recvToBuffer(connection, received);
+		if (ret != 1) {
+			return ret;
+		}
+		else if (received > 0) {
+			continue;
+		}
+
+		// Socket je prazdny -> cekat bez zamku (event loop mezitim muze kontrolovat jina spojeni)
+		lock.unlock();
+		ret = waitForSocket(connection, POLLIN, timeout_ms);
+		lock.lock();
+		if (ret != 1) 
+		{
+			if (ret == 0) {
+				countTimeout(kind);
+			}
+			return -1;
+		}
+	}
+
+	return 1;
+}
+
+void TcpServer::consumeBufferData(const std::shared_ptr<TcpServer::Connection>& connection, const size_t size)
+{
+	// Stav parseru event loopu se vztahuje k zacatku bufferu
+	if (size != 0) {
+		connection->parser_.reset();
+	}
+
+#ifdef WEBSERVER_IO_URING
+	if (usesUring(connection)) 
+	{
+		consumeUringData(connection, size);
+		return;
+	}
+#endif
+
+	connection->recv_buffer_.erase(0, size);
+}
+
+int TcpServer::receiveText(const std::shared_ptr<TcpServer::Connection>& connection, std::string& data, const uint64_t max_size_to_recv, const std::string& terminator, const bool peek_data)
+{
+	//LOG_DBG("receiveText(term) called...");
+
+	// Data se ze socketu ctou jen jednou do bufferu spojeni, co zbyde za terminatorem zustava v bufferu
+	std::unique_lock<std::mutex> lock(connection->recv_mutex_);
+	const std::string& buffer = connection->recv_buffer_;
+	size_t searched = 0;
+
+	// Hlavicka musi prijit cela do vyprseni casu (ne jen mezi jednotlivymi cteni), jinak se hlida cas mezi cteni
+	const bool header = (terminator == HEADERS_END);
+	const std::chrono::steady_clock::time_point deadline = (header) ? takeHeaderDeadline(connection) : 
+		std::chrono::steady_clock::time_point();
+
+	while (true)
+	{
+		// Prohledava se jen nove prijata data (terminator muze zacinat na konci uz prohledanych)
+		const size_t from = ((searched >= terminator.size()) ? (searched - terminator.size() + 1) : 0);
+		const size_t end_index = TextScan::find(buffer, terminator, from);
+		if (end_index != std::string::npos && (end_index + terminator.size()) <= max_size_to_recv)
+		{
+			data.assign(buffer, 0, end_index + terminator.size());
+			if (!peek_data) {
+				consumeBufferData(connection, data.size());
+			}
+			//LOG_DBG("\nTcpServer::receiveText(term) -> %s\n", data.c_str());
+			return 1;
+		}
+
+		if (buffer.size() >= max_size_to_recv) { return -2; }
+		searched = buffer.size();
+
+		// Pockat na dalsi data
+		int timeout = body_timeout_;
+		if (header)
+		{
+			timeout = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+				deadline - std::chrono::steady_clock::now()).count());
+			if (timeout <= 0) 
+			{
+				countTimeout(TimeoutKind::HEADER);
+				return ((searched == 0) ? 0 : -1);
+			}
+		}
+		const int ret = waitForBufferData(connection, lock, buffer.size(), timeout, 
+			((header) ? TimeoutKind::HEADER : TimeoutKind::BODY));
+		if (ret != 1) {
+			// Zadna data jeste neprisla -> stejne jako ukonceni spojeni
+			return ((ret == 0 || searched == 0) ? 0 : -1);
+		}
+	}
+}
+
+int TcpServer::receiveText(const std::shared_ptr<TcpServer::Connection>& connection, std::string& data, const uint64_t bytes_to_recv, const bool peek_data)
+{
+	//LOG_DBG("receiveText(size) called...");
+
+	std::unique_lock<std::mutex> lock(connection->recv_mutex_);
+	const std::string& buffer = connection->recv_buffer_;
+	uint64_t total = 0;
+
+	while (total != bytes_to_recv)
+	{
+		if (peek_data)
+		{
+			// Nahled musi mit vsechna data najednou
+			if (buffer.size() >= bytes_to_recv)
+			{
+				memcpy(const_cast<char*>(data.data()), buffer.data(), bytes_to_recv);
+				total = bytes_to_recv;
+				break;
+			}
+		}
+		else if (!buffer.empty())
+		{
+			const size_t n = std::min(static_cast<uint64_t>(buffer.size()), bytes_to_recv - total);
+			memcpy(const_cast<char*>(data.data()) + total, buffer.data(), n);
+			consumeBufferData(connection, n);
+			total += n;
+			continue;
+		}
+		else if (!usesUring(connection))
+		{
+			// Prazdny buffer -> telo requestu cist rovnou do dat volajiciho (bez kopie pres buffer)
+			size_t n = 0;
+			const int ret = recvData(connection, const_cast<char*>(data.data()) + total, bytes_to_recv - total, n);
+			if (ret != 1) {
+				return ((ret == 0 && total != 0) ? -1 : ret);
+			}
+			else if (n > 0)
+			{
+				total += n;
+				continue;
+			}
+		}
+
+		const int ret = waitForBufferData(connection, lock, ((peek_data) ? buffer.size() : 0), body_timeout_, TimeoutKind::BODY);
+		if (ret != 1) {
+			return ((ret == 0 || total == 0) ? 0 : -1);
+		}
+	}
+
+	return 1;
+}
+
+
+int TcpServer::receiveHeader(const std::shared_ptr<TcpServer::Connection>& connection, std::string& data, const uint64_t max_size_to_recv, HttpRequestParser& parser)
+{
+	// Vraci: 1 -> OK, 0 -> klient ukoncil spojeni, -1 -> chyba nebo vyprsel cas, -2 -> prilis velka hlavicka, -3 -> nevalidni request
+	// Hlavicka se parsuje primo v bufferu spojeni, po kazdem cteni parser pokracuje jen s nove prijatymi daty
+	std::unique_lock<std::mutex> lock(connection->recv_mutex_);
+	std::string& buffer = connection->recv_buffer_;
+
+	// Hlavicku uz zacal parsovat event loop -> pokracuje se v jeho stavu (prijata data se neparsuji znovu)
+	if (connection->parser_.isStarted())
+	{
+		std::swap(parser, connection->parser_);
+		connection->parser_.reset();
+	}
+
+	// Hlavicka musi prijit cela do vyprseni casu (ne jen mezi jednotlivymi cteni), cas bezi uz od jejiho zacatku v event loopu
+	const std::chrono::steady_clock::time_point deadline = takeHeaderDeadline(connection);
+
+	while (true)
+	{
+		const HttpRequestParser::Result result = 
+			parser.parse(std::string_view(buffer.data(), std::min<uint64_t>(buffer.size(), max_size_to_recv)));
+		if (result == HttpRequestParser::Result::COMPLETED)
+		{
+			// Buffer obsahuje jen hlavicku -> vymeni se (bez kopie), jinak zbytek (telo, dalsi request) zustava v bufferu
+			const size_t size = parser.headerSize();
+			if (buffer.size() == size)
+			{
+				data.clear();
+				data.swap(buffer);
+				consumeBufferData(connection, 0);
 			}
 			else
 			{
-				ret = recv(connection->socket_, const_cast<char*>(data.data()) + total, data.size() - total, MSG_WAITALL);
-				n = ret;
-			}
+				data.assign(buffer, 0, size);
+				consumeBufferData(connection, size);
+			}
+			parser.bind(data);
+			return 1;
+		}
+		else if (result == HttpRequestParser::Result::ERROR) {
+			return -3;
+		}
+
+		if (buffer.size() >= max_size_to_recv) { return -2; }
+		const size_t received = buffer.size();
+
+		// Pockat na dalsi data
+		const int timeout = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+			deadline - std::chrono::steady_clock::now()).count());
+		if (timeout <= 0) 
+		{
+			countTimeout(TimeoutKind::HEADER);
+			return ((received == 0) ? 0 : -1);
+		}
+		const int ret = waitForBufferData(connection, lock, buffer.size(), timeout, TimeoutKind::HEADER);
+		if (ret != 1) {
+			// Zadna data jeste neprisla -> stejne jako ukonceni spojeni
+			return ((ret == 0 || received == 0) ? 0 : -1);
+		}
+	}
+}
+
+
+void TcpServer::setPriority(const std::shared_ptr<TcpServer::Connection>& connection, const ThreadPool::TaskPriority priority)
+{
+	// Vola obsluha spojeni z vlakna poolu -> preradi i prave bezici task
+	connection->priority_ = priority;
+	thread_pool_.setTaskPriority(priority);
+}
+
+bool TcpServer::queueBackgroundTask(Task&& task)
+{
+	return (run_ && thread_pool_.queueTask(std::move(task), ThreadPool::TaskPriority::BACKGROUND));
+}
+
+
+bool TcpServer::isConnected(const std::shared_ptr<TcpServer::Connection>& connection) const
+{
+    if (run_)
+    {
+#ifdef WEBSERVER_IO_URING
+		if (usesUring(connection)) {
+			return isConnectedUring(connection);
+		}
+#endif
+
+		// Neprectena data v bufferu spojeni (peer mohl uz ukoncit spojeni, ale data jsou stale ke zpracovani)
+		{
+			std::lock_guard<std::mutex> lock(connection->recv_mutex_);
+			if (!connection->recv_buffer_.empty()) {
+				return true;
+			}
+		}
+
+		errno = 0;
+		uint8_t buffer;
+		const int ret = recv(connection->socket_, &buffer, sizeof(buffer), MSG_PEEK | MSG_DONTWAIT);
+
+		// Vraci 0 kdyz peer ukoncil spojeni, ale jen pokud uz v kernel bufferu socketu nejsou zadna data k precteni, tedy az po precteni vsech dat.
+		if (ret == 0) { 
+			return false; 
+		}
+		else if (ret == -1)
+		{ 
+			if (errno == EAGAIN || errno == EWOULDBLOCK) { 
+				return true; 
+			}
+			else { 
+				return false;
+			}
+		}
+		else { 
+			return true;
+		}
+	}
+
+    return false;
+}
+
+
+
+#ifdef WEBSERVER_IO_URING
+// io_uring backend: multishot accept, multishot recv do provided bufferu, vektorovy send (sendmsg)
+// HTTPS spojeni cte a zapisuje OpenSSL primo ze socketu, io_uring pro ne jen hlida pripravenost (multishot poll)
+
+struct TcpServer::UringSendBatch
+{
+	std::vector<TcpServer::UringRequest> requests;
+	std::vector<int> results;
+	std::vector<iovec> iov;  // Odesilane casti (kernel je cte az pri zpracovani SQE)
+	msghdr msg = {};
+	size_t pending = 0;
+	std::atomic<uint32_t> refs{0};  // Davku uvolnuje posledni z event loopu (CQE) a odesilajiciho vlakna
+	std::mutex mutex;
+	std::condition_variable cond;
+};
+
+
+bool TcpServer::startUring()
+{
+	if (!ring_.init(URING_ENTRIES)) {
+		return false;
+	}
+	if (!ring_.initBuffers(URING_BUFFER_GROUP, URING_BUFFER_COUNT, URING_BUFFER_SIZE))
+	{
+		ring_.release();
+		return false;
+	}
+
+	uring_accept_.type = UringRequest::Type::ACCEPT;
+	uring_accept_ssl_.type = UringRequest::Type::ACCEPT_SSL;
+	if (!submitUringAccept(uring_accept_, socket_) || 
+		(socket_ssl_ != -1 && !submitUringAccept(uring_accept_ssl_, socket_ssl_)))
+	{
+		ring_.release();
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(ring_.submitMutex());
+	uring_draining_ = true;
+	return (ring_.submit() >= 0);
+}
+
+
+void TcpServer::stopUring()
+{
+	// Zruseni io_uring instance zrusi i vsechny zadane operace
+	ring_.release();
+
+	for (UringRequest* request : uring_requests_) {
+		delete request;
+	}
+	uring_requests_.clear();
+
+	{
+		std::lock_guard<std::mutex> lock(uring_arm_mutex_);
+		uring_arm_queue_.clear();
+		uring_park_queue_.clear();
+	}
+
+	// Prijata spojeni, ktera uz nikdo nevyzvedne
+	std::lock_guard<std::mutex> lock(accept_mutex_);
+	for (const int sock : accepted_) {
+		close(sock);
+	}
+	for (const int sock : accepted_ssl_) {
+		close(sock);
+	}
+	accepted_.clear();
+	accepted_ssl_.clear();
+}
+
+
+void TcpServer::uringLoop()
+{
+	blockLoopSignals();
+
+	while (run_)
+	{
+		// Spojeni predana event loopu -> zadat recv/poll (operace zadava jen toto vlakno, aby nezanikly s vlaknem workeru)
+		std::vector<std::shared_ptr<TcpServer::Connection>> arm_queue;
+		std::vector<std::shared_ptr<TcpServer::Connection>> park_queue;
+		{
+			std::lock_guard<std::mutex> lock(uring_arm_mutex_);
+			arm_queue.swap(uring_arm_queue_);
+			park_queue.swap(uring_park_queue_);
+		}
+
+		// Odpovedi cekajici na misto v socketu -> jednorazovy poll na zapis
+		for (const std::shared_ptr<TcpServer::Connection>& connection : park_queue)
+		{
+			UringRequest* request = new UringRequest();
+			request->type = UringRequest::Type::WRITABLE;
+			request->connection = connection;
+			if (submitUringRequest(request)) {
+				uring_requests_.insert(request);
+			}
+			else 
+			{
+				delete request;
+				// Nelze hlidat -> obsluha zkusi odeslat hned (pripadne spojeni ukonci)
+				bool parked = true;
+				if (connection->parked_.compare_exchange_strong(parked, false)) {
+					resumeOutput(connection);
+				}
+			}
+		}
+
+		for (const std::shared_ptr<TcpServer::Connection>& connection : arm_queue)
+		{
+			bool hangup = false;
+			{
+				std::lock_guard<std::mutex> lock(connection->recv_mutex_);
+				if (connection->recv_eof_ || connection->recv_paused_ || connection->recv_request_) {
+					continue;
+				}
 
-			// Kontrola chyby
-			if (ret == -1){
-				return -1; 
+				UringRequest* request = new UringRequest();
+				request->type = ((connection->secure_) ? UringRequest::Type::POLL : UringRequest::Type::RECV);
+				request->connection = connection;
+				if (submitUringRequest(request))
+				{
+					uring_requests_.insert(request);
+					connection->recv_request_ = request;
+				}
+				else 
+				{
+					delete request;
+					connection->recv_eof_ = true;
+					hangup = true;
+				}
 			}
-			// Kontrola zda nebylo preruseno spojeni
-			else if (ret == 0) {
-				return 0;
+
+			// Spojeni nelze hlidat -> obsluha ho ukonci
+			if (hangup && !connection->dispatched_) {
+				dispatchConnection(connection);
 			}
+		}
 
-			total += n;
+		{
+			std::lock_guard<std::mutex> lock(ring_.submitMutex());
+			ring_.submit();
+		}
+
+		const int ret = ring_.waitCqe(EVENT_LOOP_TIMEOUT);
+		if (ret == -1)
+		{
+			LOG_ERR("Event loop failed (error: %s)", strerror(errno));
+			break;
+		}
+
+		expireTimers();
+
+		io_uring_cqe* cqe;
+		while ((cqe = ring_.peekCqe()) != nullptr)
+		{
+			const io_uring_cqe completion = *cqe;
+			ring_.seenCqe();
+			handleUringCompletion(completion);
 		}
 	}
 
-	return 1;
+	// Server se zastavuje -> obsluha muze jeste cekat na CQE svych sends (zrusenych), ostatni CQE se zahazuji
+	while (uring_draining_)
+	{
+		{
+			std::lock_guard<std::mutex> lock(ring_.submitMutex());
+			ring_.submit();
+		}
+		if (ring_.waitCqe(EVENT_LOOP_TIMEOUT) == -1) {
+			break;
+		}
+
+		io_uring_cqe* cqe;
+		while ((cqe = ring_.peekCqe()) != nullptr)
+		{
+			const io_uring_cqe completion = *cqe;
+			ring_.seenCqe();
+			if (completion.user_data != 0 &&
+				reinterpret_cast<UringRequest*>(completion.user_data)->type == UringRequest::Type::SEND)
+			{
+				handleUringSend(reinterpret_cast<UringRequest*>(completion.user_data), completion);
+			}
+		}
+	}
 }
 
-int TcpServer::receiveText(const std::shared_ptr<TcpServer::Connection>& connection, std::string& data, const uint64_t bytes_to_recv, const bool peek_data)
+
+void TcpServer::handleUringCompletion(const io_uring_cqe& cqe)
 {
-	//LOG_DBG("receiveText(size) called...");
+	// user_data == 0 -> NOP (probuzeni event loopu) nebo zruseni operace
+	if (cqe.user_data == 0) {
+		return;
+	}
 
-	const int recv_flag = ((peek_data) ? MSG_PEEK : MSG_WAITALL);
-	uint64_t total = 0;
-	int n;
-	int ret;
+	UringRequest* request = reinterpret_cast<UringRequest*>(cqe.user_data);
+	switch (request->type)
+	{
+		case UringRequest::Type::ACCEPT:
+		case UringRequest::Type::ACCEPT_SSL:
+		{
+			if (cqe.res >= 0)
+			{
+				std::lock_guard<std::mutex> lock(accept_mutex_);
+				if (request->type == UringRequest::Type::ACCEPT) {
+					accepted_.push_back(cqe.res);
+				}
+				else {
+					accepted_ssl_.push_back(cqe.res);
+				}
+				// HTTP i HTTPS acceptor cekaji na stejne podmince -> probudit oba
+				accept_cond_.notify_all();
+			}
+
+			// Multishot accept skoncil (napr. chyba) -> zadat znovu
+			if (!(cqe.flags & IORING_CQE_F_MORE) && run_ && !deactivated_) {
+				submitUringAccept(*request, ((request->type == UringRequest::Type::ACCEPT) ? socket_ : socket_ssl_));
+			}
+			break;
+		}
 
-	// Pockat az budou nejaka data dostupna
-	ret = waitForData(connection);
-	if (ret != 1) { return ret; }
+		case UringRequest::Type::RECV:
+			handleUringReceive(request, cqe);
+			break;
 
-	//LOG_DBG("Wait for data done");
+		case UringRequest::Type::POLL:
+			handleUringPoll(request, cqe);
+			break;
 
-	// Nacteni samotnych dat
-	while (total != bytes_to_recv)
+		case UringRequest::Type::SEND:
+			handleUringSend(request, cqe);
+			break;
+
+		case UringRequest::Type::WRITABLE:
+			handleUringWritable(request);
+			break;
+	}
+}
+
+
+void TcpServer::handleUringReceive(UringRequest* request, const io_uring_cqe& cqe)
+{
+	const std::shared_ptr<TcpServer::Connection> connection = request->connection;
 	{
-		//LOG_DBG("Data receiving...");
+		std::lock_guard<std::mutex> lock(connection->recv_mutex_);
 
-		errno = 0;
+		if (cqe.flags & IORING_CQE_F_BUFFER)
+		{
+			const uint16_t id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+			if (cqe.res > 0 && !connection->recv_eof_) {
+				connection->recv_buffer_.append(ring_.buffer(id), cqe.res);
+			}
+			ring_.recycleBuffer(id);
+		}
+
+		// Klient ukoncil spojeni nebo chyba (ENOBUFS -> dosly buffery, ECANCELED -> pozastaveni prijmu)
+		if (cqe.res == 0 || (cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECANCELED)) {
+			connection->recv_eof_ = true;
+		}
+
+		const bool more = ((cqe.flags & IORING_CQE_F_MORE) != 0);
 
-		if (connection->ssl_)
+		// Obsluha nestiha data vyzvedavat -> pozastavit prijem (klienta pribrzdi TCP flow control)
+		if (more && !connection->recv_eof_ && !connection->recv_paused_ && 
+			connection->recv_buffer_.size() >= URING_RECV_BUFFER_LIMIT)
 		{
-			size_t nn = 0;
-			if (peek_data) {
-				ret = SSL_peek_ex(connection->ssl_, const_cast<char*>(data.data()) + total, bytes_to_recv - total, &nn);
+			connection->recv_paused_ = true;
+			submitUringCancel(request);
+		}
+
+		// Multishot recv skoncil -> zadat znovu, pokud spojeni dal bezi
+		if (!more)
+		{
+			connection->recv_request_ = nullptr;
+			if (!connection->recv_eof_ && !connection->recv_paused_ && submitUringRequest(request)) {
+				connection->recv_request_ = request;
 			}
-			else {
-				ret = SSL_read_ex(connection->ssl_, const_cast<char*>(data.data()) + total, bytes_to_recv - total, &nn);
+			else 
+			{
+				if (!connection->recv_paused_) {
+					connection->recv_eof_ = true;
+				}
+				uring_requests_.erase(request);
+				delete request;
 			}
-			n = static_cast<int>(nn);
 		}
-		else
+
+		connection->recv_cond_.notify_all();
+	}
+
+	// Obsluha ceka na dalsi cast tela requestu -> spustit ji znovu, az bude v bufferu
+	if (connection->awaiting_input_) {
+		checkInput(connection);
+	}
+	// Spojeni uz zpracovava nektere vlakno -> po dokonceni si samo zkontroluje dalsi data
+	else if (!connection->dispatched_ && isRequestReady(connection)) {
+		dispatchConnection(connection);
+	}
+}
+
+
+void TcpServer::handleUringPoll(UringRequest* request, const io_uring_cqe& cqe)
+{
+	const std::shared_ptr<TcpServer::Connection> connection = request->connection;
+
+	if (cqe.res > 0 && connection->awaiting_input_) {
+		checkInput(connection);
+	}
+	else if (cqe.res > 0 && !connection->dispatched_)
+	{
+		// Ukonceni spojeni nebo chybu na socketu musi take zpracovat obsluha spojeni
+		const bool hangup = ((cqe.res & (POLLRDHUP | POLLHUP | POLLERR)) != 0);
+		if (hangup || isRequestReady(connection)) {
+			dispatchConnection(connection);
+		}
+	}
+
+	if (!(cqe.flags & IORING_CQE_F_MORE))
+	{
+		std::lock_guard<std::mutex> lock(connection->recv_mutex_);
+		connection->recv_request_ = nullptr;
+		if (cqe.res >= 0 && !connection->recv_eof_ && submitUringRequest(request)) {
+			connection->recv_request_ = request;
+		}
+		else 
 		{
-			ret = recv(connection->socket_, const_cast<char*>(data.data()) + total, bytes_to_recv - total, recv_flag);
-			n = ret;
+			uring_requests_.erase(request);
+			delete request;
 		}
+	}
+}
 
-		// Kontrola chyby
-		if (ret == -1) {
+
+void TcpServer::handleUringWritable(UringRequest* request)
+{
+	const std::shared_ptr<TcpServer::Connection> connection = request->connection;
+	uring_requests_.erase(request);
+	delete request;
+
+	// Spojeni mohlo byt mezitim ukonceno (vyprsel cas) -> poll skoncil s POLLHUP
+	bool parked = true;
+	if (connection->parked_.compare_exchange_strong(parked, false)) {
+		resumeOutput(connection);
+	}
+}
+
+
+void TcpServer::handleUringSend(UringRequest* request, const io_uring_cqe& cqe)
+{
+	UringSendBatch* batch = request->batch;
+	{
+		std::lock_guard<std::mutex> lock(batch->mutex);
+		batch->results[request->index] = cqe.res;
+		--batch->pending;
+		batch->cond.notify_all();
+	}
+
+	if (--batch->refs == 0) {
+		delete batch;
+	}
+}
+
+
+bool TcpServer::submitUringAccept(UringRequest& request, const int sock)
+{
+	std::lock_guard<std::mutex> lock(ring_.submitMutex());
+	io_uring_sqe* sqe = ring_.getSqe();
+	if (!sqe) {
+		return false;
+	}
+
+	sqe->opcode = IORING_OP_ACCEPT;
+	sqe->fd = sock;
+	sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+	sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+	sqe->user_data = reinterpret_cast<uint64_t>(&request);
+	
+	return true;
+}
+
+
+bool TcpServer::submitUringRequest(UringRequest* request)
+{
+	std::lock_guard<std::mutex> lock(ring_.submitMutex());
+	io_uring_sqe* sqe = ring_.getSqe();
+	if (!sqe) {
+		return false;
+	}
+
+	sqe->fd = request->connection->socket_;
+	sqe->user_data = reinterpret_cast<uint64_t>(request);
+	if (request->type == UringRequest::Type::RECV)
+	{
+		// Kernel sam vybere volny buffer ze skupiny, dokud neni multishot recv ukoncen
+		sqe->opcode = IORING_OP_RECV;
+		sqe->ioprio = IORING_RECV_MULTISHOT;
+		sqe->flags = IOSQE_BUFFER_SELECT;
+		sqe->buf_group = URING_BUFFER_GROUP;
+	}
+	else if (request->type == UringRequest::Type::WRITABLE)
+	{
+		sqe->opcode = IORING_OP_POLL_ADD;
+		sqe->poll32_events = POLLOUT;
+	}
+	else
+	{
+		sqe->opcode = IORING_OP_POLL_ADD;
+		sqe->poll32_events = POLLIN | POLLRDHUP;
+		sqe->len = IORING_POLL_ADD_MULTI;
+	}
+
+	return true;
+}
+
+
+void TcpServer::submitUringCancel(void* request)
+{
+	std::lock_guard<std::mutex> lock(ring_.submitMutex());
+	io_uring_sqe* sqe = ring_.getSqe();
+	if (sqe)
+	{
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->addr = reinterpret_cast<uint64_t>(request);
+		sqe->user_data = 0;
+		ring_.submit();
+	}
+}
+
+
+void TcpServer::armUringConnection(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	{
+		std::lock_guard<std::mutex> lock(uring_arm_mutex_);
+		uring_arm_queue_.push_back(connection);
+	}
+	wakeUringLoop();
+}
+
+
+void TcpServer::parkUringConnection(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	{
+		std::lock_guard<std::mutex> lock(uring_arm_mutex_);
+		uring_park_queue_.push_back(connection);
+	}
+	wakeUringLoop();
+}
+
+
+void TcpServer::wakeUringLoop()
+{
+	std::lock_guard<std::mutex> lock(ring_.submitMutex());
+	io_uring_sqe* sqe = ring_.getSqe();
+	if (sqe)
+	{
+		sqe->opcode = IORING_OP_NOP;
+		sqe->user_data = 0;
+		ring_.submit();
+	}
+}
+
+
+void TcpServer::cancelUringConnection(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	std::lock_guard<std::mutex> lock(connection->recv_mutex_);
+	connection->recv_eof_ = true;
+	if (connection->recv_request_) {
+		submitUringCancel(connection->recv_request_);
+	}
+	connection->recv_cond_.notify_all();
+}
+
+
+int TcpServer::acceptUring(std::deque<int>& accepted)
+{
+	std::unique_lock<std::mutex> lock(accept_mutex_);
+	while (accepted.empty())
+	{
+		if (!run_ || deactivated_) {
 			return -1;
 		}
-		// Kontrola zda nebylo preruseno spojeni
-		else if (ret == 0) {
-			return 0;
+		accept_cond_.wait_for(lock, std::chrono::milliseconds(EVENT_LOOP_TIMEOUT));
+	}
+
+	const int sock = accepted.front();
+	accepted.pop_front();
+	return sock;
+}
+
+
+bool TcpServer::isRequestReadyUring(const std::shared_ptr<TcpServer::Connection>& connection)
+{
+	std::lock_guard<std::mutex> lock(connection->recv_mutex_);
+	const std::string& buffer = connection->recv_buffer_;
+
+	// Klient ukoncil spojeni -> obsluha spojeni odpovi
+	if (connection->recv_eof_) {
+		return true;
+	}
+	// Spojeni mezitim prevzalo vlakno obsluhy -> data si zpracuje samo
+	if (connection->dispatched_) {
+		return false;
+	}
+	bool header = false;
+	if (isRequestBuffered(connection, header)) {
+		return true;
+	}
+	// Hlavicka presahuje maximalni velikost -> obsluha spojeni odpovi
+	if (!header && buffer.size() >= max_header_size_) {
+		return true;
+	}
+
+	// Cast hlavicky uz prisla -> cela musi prijit do vyprseni casu na hlavicku, telo pak do vyprseni casu na telo
+	if (header) {
+		armTimer(connection, TimeoutKind::BODY);
+	}
+	else if (!buffer.empty()) {
+		armTimer(connection, TimeoutKind::HEADER);
+	}
+	return false;
+}
+
+
+int TcpServer::waitForUringData(const std::shared_ptr<TcpServer::Connection>& connection, std::unique_lock<std::mutex>& lock, const size_t available, const int timeout_ms)
+{
+	// Vraci: 1 -> jsou dalsi data, 0 -> klient ukoncil spojeni, -1 -> vyprsel cas
+	const std::chrono::steady_clock::time_point deadline = 
+		std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+	// Pozastaveny prijem by na dalsi data cekal zbytecne
+	if (connection->recv_paused_)
+	{
+		connection->recv_paused_ = false;
+		if (!connection->recv_request_ && !connection->recv_eof_) {
+			armUringConnection(connection);
 		}
+	}
 
-		total += n;
+	while (connection->recv_buffer_.size() <= available)
+	{
+		if (connection->recv_eof_) {
+			return 0;
+		}
+		if (!run_ || std::chrono::steady_clock::now() >= deadline) {
+			return -1;
+		}
+		connection->recv_cond_.wait_for(lock, std::chrono::milliseconds(EVENT_LOOP_TIMEOUT));
 	}
 
 	return 1;
 }
 
 
-bool TcpServer::isConnected(const std::shared_ptr<TcpServer::Connection>& connection) const
+void TcpServer::consumeUringData(const std::shared_ptr<TcpServer::Connection>& connection, const size_t size)
 {
-    if (run_)
-    {
-		errno = 0;
-		uint8_t buffer;
-		const int ret = recv(connection->socket_, &buffer, sizeof(buffer), MSG_PEEK | MSG_DONTWAIT);
+	connection->recv_buffer_.erase(0, size);
 
-		// Vraci 0 kdyz peer ukoncil spojeni, ale jen pokud uz v kernel bufferu socketu nejsou zadna data k precteni, tedy az po precteni vsech dat.
-		if (ret == 0) { 
-			return false; 
+	// Obsluha vyzvedla dost dat -> obnovit pozastaveny prijem
+	if (connection->recv_paused_ && connection->recv_buffer_.size() < (URING_RECV_BUFFER_LIMIT / 2))
+	{
+		connection->recv_paused_ = false;
+		if (!connection->recv_request_ && !connection->recv_eof_) {
+			armUringConnection(connection);
 		}
-		else if (ret == -1)
-		{ 
-			if (errno == EAGAIN || errno == EWOULDBLOCK) { 
-				return true; 
+	}
+}
+
+
+int TcpServer::sendAllUring(const std::shared_ptr<TcpServer::Connection>& connection, const iovec* iov, const size_t count)
+{
+	size_t index = 0;  // Prvni neodeslana cast
+	size_t offset = 0;  // Uz odeslano z casti index
+
+	while (index < count)
+	{
+		// Zbytek dat jednim vektorovym send (jedno SQE, jeden io_uring_enter)
+		UringSendBatch* batch = new UringSendBatch();
+		for (size_t i = index, o = offset; i < count && batch->iov.size() < static_cast<size_t>(URING_SEND_MAX_IOV); ++i, o = 0)
+		{
+			if (iov[i].iov_len > o) {
+				batch->iov.push_back({ static_cast<char*>(iov[i].iov_base) + o, iov[i].iov_len - o });
 			}
-			else { 
-				return false;
+		}
+		if (batch->iov.empty())
+		{
+			delete batch;
+			break;
+		}
+		batch->msg.msg_iov = batch->iov.data();
+		batch->msg.msg_iovlen = batch->iov.size();
+		batch->requests.resize(1);
+		batch->results.resize(1, 0);
+		batch->pending = 1;
+		batch->refs = 2;
+
+		UringRequest& request = batch->requests[0];
+		request.type = UringRequest::Type::SEND;
+		request.batch = batch;
+		request.index = 0;
+		{
+			std::lock_guard<std::mutex> lock(ring_.submitMutex());
+			io_uring_sqe* sqe = ring_.getSqe();
+			if (!sqe)
+			{
+				delete batch;
+				return -1;
 			}
+			IoUring::prepareSendMsg(sqe, connection->socket_, &batch->msg);
+			sqe->user_data = reinterpret_cast<uint64_t>(&request);
+
+			// Pri chybe zustava SQE ve fronte a kernel ho prevezme pri dalsim odeslani (event loop) -> CQE dorazi
+			ring_.submit();
 		}
-		else { 
-			return true;
+
+		// Pockat na dokonceni (send necekajici na misto v socketu konci hned, cas hlida jen zastaveni serveru)
+		// SQE odkazuje na data volajiciho -> i po vyprseni casu se musi pockat na CQE (zruseneho) send
+		int res = 0;
+		bool timeout = false;
+		{
+			const std::chrono::steady_clock::time_point deadline =
+				std::chrono::steady_clock::now() + std::chrono::milliseconds(body_timeout_);
+
+			std::unique_lock<std::mutex> lock(batch->mutex);
+			while (batch->pending > 0)
+			{
+				// Zrusit send (opakovane, zruseni se nemuselo vejit do submission queue)
+				if (timeout || !run_ || std::chrono::steady_clock::now() >= deadline)
+				{
+					timeout = true;
+					lock.unlock();
+					submitUringCancel(&request);
+					lock.lock();
+					if (batch->pending == 0) {
+						break;
+					}
+				}
+				batch->cond.wait_for(lock, std::chrono::milliseconds(EVENT_LOOP_TIMEOUT));
+			}
+			res = batch->results[0];
+		}
+
+		if (--batch->refs == 0) {
+			delete batch;
+		}
+		if (timeout) {
+			return -1;
+		}
+
+		// Odeslano (i castecne) -> posunout se za odeslana data a zbytek znovu odeslat
+		if (res > 0)
+		{
+			for (size_t n = static_cast<size_t>(res); n > 0 && index < count; )
+			{
+				const size_t len = std::min(n, iov[index].iov_len - offset);
+				n -= len;
+				offset += len;
+				if (offset == iov[index].iov_len)
+				{
+					++index;
+					offset = 0;
+				}
+			}
+			continue;
+		}
+
+		// Socket je plny -> zbytek se odesle az ho klient precte (obsluha na nej neceka)
+		const int error = -res;
+		if (error == EAGAIN || error == EWOULDBLOCK || error == ECANCELED)
+		{
+			std::vector<iovec> rest(iov + index, iov + count);
+			rest[0].iov_base = static_cast<char*>(rest[0].iov_base) + offset;
+			rest[0].iov_len -= offset;
+			return deferOutput(connection, rest.data(), rest.size());
+		}
+		else if (error == EINTR) {
+			continue;
+		}
+		else if (error == EPIPE || error == ECONNRESET || error == 0) {
+			return 0;
+		}
+		else {
+			return -1;
 		}
 	}
 
-    return false;
+	return 1;
 }
 
+
+bool TcpServer::isConnectedUring(const std::shared_ptr<TcpServer::Connection>& connection) const
+{
+	// Klient ukoncil spojeni, ale jen pokud uz byla vyzvednuta vsechna prijata data
+	std::lock_guard<std::mutex> lock(connection->recv_mutex_);
+	return (!connection->recv_eof_ || !connection->recv_buffer_.empty());
+}
+#endif
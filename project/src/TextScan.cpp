@@ -0,0 +1,233 @@
+#include "TextScan.hpp"
+#include <string.h>
+#include <array>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TEXT_SCAN_X86
+#endif
+
+
+// Skalarni implementace (zaroven dokoncuje zbytek dat kratsi nez jeden blok SIMD)
+static size_t findScalar(const char* text, const size_t size, const char* pattern, const size_t pattern_size, const size_t from)
+{
+	return std::string_view(text, size).find(std::string_view(pattern, pattern_size), from);
+}
+
+// Bit 0 -> viditelny znak (URI), bit 1 -> viditelny znak, mezera nebo HTAB (hodnota header fieldu)
+static constexpr std::array<uint8_t, 256> visible_chars = []()
+{
+	std::array<uint8_t, 256> table{};
+	for (int c = 0x21; c < 0x100; ++c) {
+		table[c] = ((c != 0x7f) ? 0x3 : 0x0);
+	}
+	table[' '] = 0x2;
+	table['\t'] = 0x2;
+	return table;
+}();
+
+static size_t skipVisibleScalar(const char* data, size_t pos, const size_t size, const bool allow_space)
+{
+	const uint8_t char_class = (allow_space ? 0x2 : 0x1);
+	while (pos < size && (visible_chars[static_cast<unsigned char>(data[pos])] & char_class)) {
+		++pos;
+	}
+	return pos;
+}
+
+
+#ifdef TEXT_SCAN_X86
+// Vyhledani podretezce: kandidati jsou pozice, kde sedi prvni i posledni znak vzoru (64 pozic najednou),
+// az ti se porovnavaji cele -> hranice multipart i "\r\n\r\n" se najdou bez prochazeni po znacich
+// (SSE4.2 varianta s 16 bytovymi bloky byla pomalejsi nez memchr z libc -> tam se pouziva skalarni)
+__attribute__((target("avx2")))
+static uint32_t candidatesAvx2(const char* text, const size_t pos, const size_t last_offset, const __m256i first, const __m256i last)
+{
+	const __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + pos));
+	const __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + pos + last_offset));
+	return _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last)));
+}
+
+__attribute__((target("avx2")))
+static size_t findAvx2(const char* text, const size_t size, const char* pattern, const size_t pattern_size, size_t pos)
+{
+	const size_t last_offset = pattern_size - 1;
+	const __m256i first = _mm256_set1_epi8(pattern[0]);
+	const __m256i last = _mm256_set1_epi8(pattern[last_offset]);
+	for (; pos + last_offset + 2 * sizeof(__m256i) <= size; pos += 2 * sizeof(__m256i))
+	{
+		uint64_t mask = candidatesAvx2(text, pos, last_offset, first, last) | 
+			(static_cast<uint64_t>(candidatesAvx2(text, pos + sizeof(__m256i), last_offset, first, last)) << 32);
+		while (mask != 0)
+		{
+			const size_t candidate = pos + __builtin_ctzll(mask);
+			if (memcmp(text + candidate + 1, pattern + 1, pattern_size - 2) == 0) {
+				return candidate;
+			}
+			mask &= (mask - 1);
+		}
+	}
+	return findScalar(text, size, pattern, pattern_size, pos);
+}
+
+// Povolene rozsahy znaku pro PCMPESTRI (dvojice od-do), prvni znak mimo rozsahy konci beh
+__attribute__((target("sse4.2")))
+static size_t skipVisibleSse42(const char* data, size_t pos, const size_t size, const bool allow_space)
+{
+	static const char value_ranges[16] = "\x09\x09\x20\x7e\x80\xff";
+	static const char uri_ranges[16] = "\x21\x7e\x80\xff";
+	const __m128i ranges = _mm_loadu_si128(reinterpret_cast<const __m128i*>(allow_space ? value_ranges : uri_ranges));
+	const int ranges_size = (allow_space ? 6 : 4);
+
+	for (; pos + sizeof(__m128i) <= size; pos += sizeof(__m128i))
+	{
+		const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+		const int index = _mm_cmpestri(ranges, ranges_size, block, sizeof(__m128i),
+			_SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT);
+		if (index != sizeof(__m128i)) {
+			return pos + index;
+		}
+	}
+	return skipVisibleScalar(data, pos, size, allow_space);
+}
+
+// Neviditelny znak: c <= 0x1f (c <= 0x20 bez povolene mezery) krome povoleneho HTAB, nebo DEL
+__attribute__((target("avx2")))
+static size_t skipVisibleAvx2(const char* data, size_t pos, const size_t size, const bool allow_space)
+{
+	const __m256i control_max = _mm256_set1_epi8(allow_space ? 0x1f : 0x20);
+	const __m256i del = _mm256_set1_epi8(0x7f);
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i tab_allowed = _mm256_set1_epi8(allow_space ? -1 : 0);
+
+	for (; pos + sizeof(__m256i) <= size; pos += sizeof(__m256i))
+	{
+		const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+		const __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(block, control_max), block);
+		const __m256i invalid = _mm256_andnot_si256(_mm256_and_si256(_mm256_cmpeq_epi8(block, tab), tab_allowed),
+			_mm256_or_si256(control, _mm256_cmpeq_epi8(block, del)));
+		const uint32_t mask = _mm256_movemask_epi8(invalid);
+		if (mask != 0) {
+			return pos + __builtin_ctz(mask);
+		}
+	}
+	return skipVisibleScalar(data, pos, size, allow_space);
+}
+#endif
+
+
+namespace
+{
+	struct Kernels
+	{
+		TextScan::Kernel kernel = TextScan::Kernel::SCALAR;
+		size_t (*find)(const char*, const size_t, const char*, const size_t, size_t) = findScalar;
+		size_t (*skip_visible)(const char*, size_t, const size_t, const bool) = skipVisibleScalar;
+	};
+
+	bool cpuSupports(const TextScan::Kernel kernel)
+	{
+#ifdef TEXT_SCAN_X86
+		__builtin_cpu_init();
+		switch (kernel)
+		{
+			case TextScan::Kernel::AVX2: return __builtin_cpu_supports("avx2");
+			case TextScan::Kernel::SSE42: return __builtin_cpu_supports("sse4.2");
+			default: return true;
+		}
+#else
+		return (kernel == TextScan::Kernel::SCALAR);
+#endif
+	}
+
+	Kernels kernelsFor(const TextScan::Kernel kernel)
+	{
+		Kernels kernels;
+		kernels.kernel = kernel;
+#ifdef TEXT_SCAN_X86
+		if (kernel == TextScan::Kernel::AVX2)
+		{
+			kernels.find = findAvx2;
+			kernels.skip_visible = skipVisibleAvx2;
+		}
+		else if (kernel == TextScan::Kernel::SSE42) {
+			kernels.skip_visible = skipVisibleSse42;
+		}
+#endif
+		return kernels;
+	}
+
+	Kernels selectKernels()
+	{
+		if (cpuSupports(TextScan::Kernel::AVX2)) {
+			return kernelsFor(TextScan::Kernel::AVX2);
+		}
+		if (cpuSupports(TextScan::Kernel::SSE42)) {
+			return kernelsFor(TextScan::Kernel::SSE42);
+		}
+		return kernelsFor(TextScan::Kernel::SCALAR);
+	}
+
+	const Kernels& kernels()
+	{
+		static const Kernels selected = selectKernels();
+		return selected;
+	}
+
+	const Kernels& kernels(const TextScan::Kernel kernel)
+	{
+		static const Kernels all[] = { 
+			kernelsFor(TextScan::Kernel::SCALAR), kernelsFor(TextScan::Kernel::SSE42), kernelsFor(TextScan::Kernel::AVX2) 
+		};
+		return all[static_cast<size_t>(kernel)];
+	}
+}
+
+
+TextScan::Kernel TextScan::kernel()
+{
+	return kernels().kernel;
+}
+
+const char* TextScan::kernelName(const Kernel kernel)
+{
+	switch (kernel)
+	{
+		case Kernel::AVX2: return "AVX2";
+		case Kernel::SSE42: return "SSE4.2";
+		default: return "scalar";
+	}
+}
+
+bool TextScan::kernelSupported(const Kernel kernel)
+{
+	return cpuSupports(kernel);
+}
+
+size_t TextScan::find(const std::string_view text, const std::string_view pattern, const size_t from)
+{
+	// Jednoznakovy vzor -> memchr (uz vektorizovany v libc)
+	if (pattern.size() < 2 || from >= text.size()) {
+		return text.find(pattern, from);
+	}
+	return kernels().find(text.data(), text.size(), pattern.data(), pattern.size(), from);
+}
+
+size_t TextScan::skipVisible(const char* data, const size_t pos, const size_t size, const bool allow_space)
+{
+	return kernels().skip_visible(data, pos, size, allow_space);
+}
+
+size_t TextScan::find(const Kernel kernel, const std::string_view text, const std::string_view pattern, const size_t from)
+{
+	if (pattern.size() < 2 || from >= text.size()) {
+		return text.find(pattern, from);
+	}
+	return kernels(kernel).find(text.data(), text.size(), pattern.data(), pattern.size(), from);
+}
+
+size_t TextScan::skipVisible(const Kernel kernel, const char* data, const size_t pos, const size_t size, const bool allow_space)
+{
+	return kernels(kernel).skip_visible(data, pos, size, allow_space);
+}
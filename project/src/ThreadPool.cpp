@@ -1,92 +1,182 @@
 #include "ThreadPool.hpp"
 #include "Logger.hpp"
 #include <string.h>
+#include <climits>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <time.h>
+
+#define TASK_NODES (1024)	// Pocet predalokovanych uzlu pro tasky (pri vycerpani se alokuje na heapu)
+#define NODE_INDEX_MASK (0xFFFFFFFFULL)
+#define MANAGER_MAX_TICK (100)	// Max. interval kontroly zatizeni poolu [ms]
+#define DEFAULT_SPAWN_DELAY (100)	// [ms]
+#define DEFAULT_IDLE_TIMEOUT (60000)	// [ms]
+// Vahy trid pri vyberu dalsiho tasku (z 11 vyberu 8x interactive, 2x bulk, 1x background)
+#define WEIGHT_INTERACTIVE (8)
+#define WEIGHT_BULK (2)
+#define WEIGHT_BACKGROUND (1)
+#define DRAIN_CHECK_INTERVAL (10)	// Max. interval kontroly dokonceni tasku ve waitForTasks() [ms]
+#define TIMED_PUSH_PERIOD (8)	// Z tasku zadanych z vlaken poolu se doba cekani meri u kazdeho n-teho
+
+
+thread_local ThreadPool::Worker* ThreadPool::current_worker_ = nullptr;
+
+
+static void futexWait(std::atomic<uint32_t>& word, const uint32_t value, const int64_t timeout_ms = -1)
+{
+	// Spi jen pokud ma word stale hodnotu value (jinak se hned vrati)
+	timespec timeout = {0};
+	if (timeout_ms >= 0)
+	{
+		timeout.tv_sec = timeout_ms / 1000;
+		timeout.tv_nsec = (timeout_ms % 1000) * 1000000;
+	}
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, value, (timeout_ms >= 0) ? &timeout : nullptr, nullptr, 0);
+}
+
+static void futexWake(std::atomic<uint32_t>& word, const int count)
+{
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
 
 
 ThreadPool::ThreadPool() :
-	run_(false),
-	running_threads_ (0),
-	busy_threads_(0),
-	semaphore_({0})
+	ThreadPool(0)
 {
 
 }
 
 ThreadPool::ThreadPool(const size_t size) :
 	run_(false),
-	running_threads_ (0),
-	busy_threads_(0),
-	threads_(size),
-	semaphore_({0})
+	running_threads_(0),
+	threads_(0),
+	used_slots_(0),
+	min_threads_(0),
+	spawn_delay_(DEFAULT_SPAWN_DELAY),
+	idle_timeout_(DEFAULT_IDLE_TIMEOUT),
+	limited_running_(0),
+	draining_(false),
+	drain_seq_(0),
+	wake_seq_(0),
+	sleepers_(0),
+	next_worker_(0),
+	nodes_(new TaskNode[TASK_NODES]),
+	free_nodes_(0)
 {
+	resize(size);
 
+	// Vsechny uzly do zasobniku volnych
+	for (uint32_t i = 0; i < TASK_NODES; ++i) {
+		pushFreeNode(&nodes_[i]);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	stop(true);
+	clearTasks();
 }
 
 
-bool ThreadPool::resize(const size_t size)
+bool ThreadPool::resize(const size_t size, const size_t max_size)
 {
-	if (!run_) 
+	if (!run_)
 	{
-		threads_ = std::vector<std::thread>(size);
+		// Mista pro vsechna vlakna se vytvori predem -> za behu se workers_ nemeni a lze z nej cist bez zamku
+		// Promenlivy pool ma vzdy alespon jedno vlakno (tasky odjinud se zadavaji jen aktivnim vlaknum)
+		min_threads_ = (max_size > size) ? std::max<size_t>(1, size) : size;
+		workers_.clear();
+		for (size_t i = 0; i < std::max(size, max_size); ++i)
+		{
+			workers_.emplace_back(new Worker());
+			workers_.back()->pool = this;
+			workers_.back()->index = i;
+		}
 		return true;
 	}
-	
+
 	return false;
 }
 
 
+void ThreadPool::setScaling(const uint32_t spawn_delay_ms, const uint32_t idle_timeout_ms)
+{
+	spawn_delay_ = std::chrono::milliseconds(std::max<uint32_t>(1, spawn_delay_ms));
+	idle_timeout_ = std::chrono::milliseconds(std::max<uint32_t>(1, idle_timeout_ms));
+}
+
+
 bool ThreadPool::start()
-{	
+{
 	try
 	{
 		if (!run_)
-		{	
-			if (sem_init(&semaphore_, 0, 0) == -1) 
+		{
+			run_ = true;
+			threads_ = min_threads_;
+			used_slots_ = min_threads_;
+			for (size_t i = 0; i < min_threads_; ++i)
 			{
-				LOG_ERR("Failed to init thread pool");
-				return false;
+				workers_[i]->active = true;
+				workers_[i]->thread = std::thread(&ThreadPool::worker, this, workers_[i].get());
 			}
 
-			run_ = true;
-			for (auto& thread : threads_) {
-				thread = std::thread(&ThreadPool::worker, this);
+			// Vlakna nad minimum spousti manager podle zatizeni
+			if (isElastic()) {
+				manager_thread_ = std::thread(&ThreadPool::manager, this);
 			}
 
 			waitForRun();
 			return true;
 		}
 	}
-	
+
 	catch (const std::exception& e)
 	{
 		LOG_ERR("Failed to spawn threads");
 		stop();
 	}
-	
+
 	return false;
 }
 
 
-void ThreadPool::waitForRun() const
+void ThreadPool::waitForRun()
+{
+	const uint32_t threads_size = static_cast<uint32_t>(min_threads_);
+	uint32_t running;
+	while ((running = running_threads_) < threads_size) {
+		futexWait(running_threads_, running);
+	}
+}
+
+
+void ThreadPool::waitForTasks()
 {
-	const size_t threads_size = threads_.size();
-	while (running_threads_ != threads_size);
+	// Vlakna budi waitForTasks() po kazdem tasku jen behem cekani (jinak by kazdy task menil spolecny citac)
+	draining_ = true;
+	uint32_t seq;
+	while (seq = drain_seq_, !isIdle()) {
+		futexWait(drain_seq_, seq, DRAIN_CHECK_INTERVAL);
+	}
+	draining_ = false;
 }
 
 
-void ThreadPool::waitForTasks() const
+bool ThreadPool::isIdle() const
 {
-	while (!task_queue_.empty());
+	// Vlakno nastavi busy pred odebranim tasku z citace fronty -> task je videt vzdy alespon v jednom z nich
+	// Task zadany z bezici obsluhy se do fronty zapocita pred koncem obsluhy -> druha kontrola fronty
+	return (queuedTasks() == 0 && busyThreads() == 0 && queuedTasks() == 0);
 }
 
 
 bool ThreadPool::stop(const bool force)
-{		
+{
 	try
 	{
-		bool ret = true;
-		std::lock_guard<std::mutex> lock(mutex_);
-		
 		if (run_)
 		{
 			if (!force) {
@@ -94,70 +184,151 @@ bool ThreadPool::stop(const bool force)
 			}
 
 			run_ = false;
-			
-			for (size_t i = 0; i < threads_.size(); ++i) 
+
+			// Probudit vsechna spici vlakna
+			++wake_seq_;
+			futexWake(wake_seq_, INT_MAX);
+
 			{
-				if (sem_post(&semaphore_) == -1) 
-				{
-					//LOG_DBG("Failed to stop thread pool thread");
-					ret = false;
-				}
+				std::lock_guard<std::mutex> lock(manager_mutex_);
+				manager_cond_.notify_all();
+			}
+			if (manager_thread_.joinable()) {
+				manager_thread_.join();
 			}
 
-			for (auto& thread : threads_) 
+			for (auto& worker : workers_)
 			{
-				if (thread.joinable()) 
+				if (worker->thread.joinable())
 				{
-					thread.join();
+					worker->thread.join();
 				}
+				worker->active = false;
 			}
+			threads_ = 0;
 
-			sem_destroy(&semaphore_);
-			return ret;
+			// Nezpracovane tasky (force)
+			clearTasks();
+			return true;
 		}
 	}
-	
+
 	catch (const std::exception& e) {
 		LOG_ERR("Failed to stop thread pool (error: %s)", e.what());
 	}
-	
+
 	return false;
 }
 
 
 bool ThreadPool::reset()
 {
-	if (!run_) 
+	if (!run_)
 	{
+		clearTasks();
 		running_threads_ = 0;
-		busy_threads_ = 0;
-		threads_.clear();
-		task_queue_.clear();
-		memset(&semaphore_, 0, sizeof(semaphore_));
+		threads_ = 0;
+		used_slots_ = 0;
+		min_threads_ = 0;
+		spawn_delay_ = std::chrono::milliseconds(DEFAULT_SPAWN_DELAY);
+		idle_timeout_ = std::chrono::milliseconds(DEFAULT_IDLE_TIMEOUT);
+		limited_running_ = 0;
+		for (LaneCounters& counters : lanes_) {
+			counters.max_queued = 0;
+		}
+		workers_.clear();
 		return true;
 	}
-	
+
 	return false;
 }
 
 
-bool ThreadPool::queueTask(const Task& task)
+void ThreadPool::clearTasks()
+{
+	// Volat jen kdyz vlakna nebezi
+	TaskNode* node;
+	for (auto& worker : workers_)
+	{
+		for (Lane& lane : worker->lanes)
+		{
+			while (lane.deque.pop(node)) {
+				freeNode(nullptr, node);
+			}
+			for (TaskNode* inbox_node : lane.inbox) {
+				freeNode(nullptr, inbox_node);
+			}
+			lane.inbox.clear();
+		}
+
+		// Volne uzly vlakna zpet do spolecneho zasobniku
+		while (worker->cached_nodes > 0) {
+			pushFreeNode(worker->node_cache[--worker->cached_nodes]);
+		}
+	}
+	for (LaneCounters& counters : lanes_) {
+		counters.queued = 0;
+	}
+}
+
+
+bool ThreadPool::queueTask(Task&& task, const TaskPriority priority)
 {
 	try
 	{
-		std::lock_guard<std::mutex> lock(mutex_);
-		if (run_)
+		if (run_ && !workers_.empty())
 		{
 			//LOG_DBG("Task queuing...");
 
-			task_queue_.push_back(task);
-			if (sem_post(&semaphore_) == -1)
+			const size_t lane = static_cast<size_t>(priority);
+			Worker* worker = current_worker_;
+			const bool local = (worker && worker->pool == this);
+			TaskNode* node = allocNode((local) ? worker : nullptr);
+			node->task = std::move(task);
+			node->priority = priority;
+
+			// Tasky od event loopu se meri vsechny (doba od pripravenosti requestu), z vlaken poolu jen vzorkovane
+			node->timed = (!local || (worker->pushes++ % TIMED_PUSH_PERIOD) == 0);
+			if (node->timed) {
+				node->queued = std::chrono::steady_clock::now();
+			}
+
+			LaneCounters& counters = lanes_[lane];
+			const uint64_t queued = ++counters.queued;
+			uint64_t max_queued = counters.max_queued;
+			while (queued > max_queued && !counters.max_queued.compare_exchange_weak(max_queued, queued)) {
+			}
+
+			// Z vlakna poolu -> do vlastni deque (bez zamku, ostatni si ho pripadne ukradnou)
+			if (local) {
+				worker->lanes[lane].deque.push(node);
+			}
+			else
 			{
-				//LOG_DBG("Failed to wake up thread (sem_post())");
-				task_queue_.pop_back();
-				return false;
+				// Jen do aktivniho vlakna (konci vlakno -> nic uz mu neprijde, viz retireWorker())
+				// Dokud pool bezi, je aktivni vzdy alespon jedno vlakno (viz resize())
+				for (size_t i = 1; ; ++i)
+				{
+					worker = workers_[next_worker_++ % std::max<size_t>(1, used_slots_)].get();
+					std::unique_lock<std::mutex> lock(worker->inbox_mutex);
+					if (worker->active)
+					{
+						worker->lanes[lane].inbox.push_back(node);
+						break;
+					}
+
+					// Pool se mezitim zastavil
+					if (!run_ && i >= workers_.size())
+					{
+						lock.unlock();
+						--counters.queued;
+						freeNode(nullptr, node);
+						return false;
+					}
+				}
 			}
-			
+
+			notify();
 			//LOG_DBG("Task queued");
 			return true;
 		}
@@ -166,81 +337,458 @@ bool ThreadPool::queueTask(const Task& task)
 	catch (const std::exception& e) {
 		//LOG_DBG("Failed to queue task (error: %s)", e.what());
 	}
-	
+
 	return false;
 }
 
 
-bool ThreadPool::queueTask(Task&& task)
+void ThreadPool::notify()
 {
-	try
+	// Task je uz ve fronte -> spici vlakno ho po probuzeni urcite najde (viz park())
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (sleepers_.load(std::memory_order_seq_cst) > 0)
 	{
-		//LOG_DBG("Calling queueTask()...");
+		wake_seq_.fetch_add(1, std::memory_order_seq_cst);
+		futexWake(wake_seq_, 1);
+	}
+}
 
-		std::lock_guard<std::mutex> lock(mutex_);
-		if (run_)
+
+void ThreadPool::park(const int64_t timeout_ms)
+{
+	// Nejdriv se prihlasit jako spici, pak znovu zkontrolovat fronty -> zadny task nezustane bez probuzeni
+	const uint32_t seq = wake_seq_.load(std::memory_order_seq_cst);
+	sleepers_.fetch_add(1, std::memory_order_seq_cst);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if (run_ && !hasRunnableTasks()) {
+		futexWait(wake_seq_, seq, timeout_ms);
+	}
+
+	sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+
+ThreadPool::TaskNode* ThreadPool::nextTask(Worker* self)
+{
+	// Vazeny vyber tridy, pri prazdne fronte se zkusi ostatni (podle priority)
+	const uint32_t pick = self->picks % (WEIGHT_INTERACTIVE + WEIGHT_BULK + WEIGHT_BACKGROUND);
+	const size_t first = (pick < WEIGHT_INTERACTIVE) ? 0 : ((pick < WEIGHT_INTERACTIVE + WEIGHT_BULK) ? 1 : 2);
+
+	for (size_t i = 0; i <= PRIORITIES; ++i)
+	{
+		const size_t lane = (i == 0) ? first : i - 1;
+		if (i != 0 && lane == first) {
+			continue;
+		}
+
+		if (lanes_[lane].queued == 0) {
+			continue;
+		}
+
+		// Bulk a background tasky nesmi obsadit vsechna vlakna
+		const bool limited = (lane != static_cast<size_t>(TaskPriority::INTERACTIVE));
+		if (limited && !reserveLimited()) {
+			continue;
+		}
+
+		TaskNode* node = takeTask(self, lane);
+		if (node)
 		{
-			//LOG_DBG("Task queuing...");
+			++self->picks;
+			return node;
+		}
+		if (limited) {
+			releaseLimited();
+		}
+	}
 
-			task_queue_.emplace_back(std::move(task));
-			if (sem_post(&semaphore_) == -1)
-			{
-				//LOG_DBG("Failed to wake up thread (sem_post())");
-				task_queue_.pop_back();
-				return false;
-			}
-			
-			//LOG_DBG("Task queued");
-			return true;
+	return nullptr;
+}
+
+
+ThreadPool::TaskNode* ThreadPool::takeTask(Worker* self, const size_t lane)
+{
+	TaskNode* node;
+
+	// Vlastni deque (naposledy zadany task -> data jeste v cache)
+	if (self->lanes[lane].deque.pop(node)) {
+		return node;
+	}
+
+	// Tasky zadane odjinud -> presunout do vlastni deque (ostatni vlakna z ni mohou krast)
+	{
+		std::lock_guard<std::mutex> lock(self->inbox_mutex);
+		for (TaskNode* inbox_node : self->lanes[lane].inbox) {
+			self->lanes[lane].deque.push(inbox_node);
 		}
+		self->lanes[lane].inbox.clear();
+	}
+	if (self->lanes[lane].deque.pop(node)) {
+		return node;
 	}
 
-	catch (const std::exception& e) {
-		//LOG_DBG("Failed to queue task (error: %s)", e.what());
+	// Krast od ostatnich (nejdriv z deque, pak z jeste nepresunutych tasku)
+	const size_t count = used_slots_;
+	const size_t index = self->index;
+	for (size_t i = 1; i < count; ++i)
+	{
+		Worker* victim = workers_[(index + i) % count].get();
+		if (victim->lanes[lane].deque.steal(node)) {
+			return node;
+		}
 	}
-	
-	return false;
+	for (size_t i = 1; i < count; ++i)
+	{
+		Worker* victim = workers_[(index + i) % count].get();
+		std::unique_lock<std::mutex> lock(victim->inbox_mutex, std::try_to_lock);
+		std::vector<TaskNode*>& inbox = victim->lanes[lane].inbox;
+		if (lock.owns_lock() && !inbox.empty())
+		{
+			node = inbox.front();
+			inbox.erase(inbox.begin());
+			return node;
+		}
+	}
+
+	return nullptr;
+}
+
+
+bool ThreadPool::reserveLimited()
+{
+	// Jedno vlakno vzdy zustava pro interactive tasky (pokud jich pool ma vic)
+	size_t running = limited_running_;
+	do
+	{
+		const size_t threads = threads_;
+		if (threads > 1 && running + 1 >= threads) {
+			return false;
+		}
+	} while (!limited_running_.compare_exchange_weak(running, running + 1));
+
+	return true;
 }
 
 
-void ThreadPool::worker()
+void ThreadPool::releaseLimited()
 {
-	Task task;
+	--limited_running_;
+
+	// Uvolnilo se misto pro cekajici bulk/background task
+	if (lanes_[static_cast<size_t>(TaskPriority::BULK)].queued > 0 || 
+		lanes_[static_cast<size_t>(TaskPriority::BACKGROUND)].queued > 0) 
+	{
+		notify();
+	}
+}
+
+
+bool ThreadPool::hasRunnableTasks() const
+{
+	if (lanes_[static_cast<size_t>(TaskPriority::INTERACTIVE)].queued > 0) {
+		return true;
+	}
+	if (lanes_[static_cast<size_t>(TaskPriority::BULK)].queued == 0 && 
+		lanes_[static_cast<size_t>(TaskPriority::BACKGROUND)].queued == 0)
+	{
+		return false;
+	}
+
+	// Bulk/background tasky cekaji -> vlakno je muze vzit jen pokud neni dosazen limit
+	const size_t threads = threads_;
+	return (threads <= 1 || limited_running_ + 1 < threads);
+}
+
+
+uint64_t ThreadPool::queuedTasks() const
+{
+	uint64_t queued = 0;
+	for (const LaneCounters& counters : lanes_) {
+		queued += counters.queued;
+	}
+	return queued;
+}
+
+
+void ThreadPool::setTaskPriority(const TaskPriority priority)
+{
+	Worker* worker = current_worker_;
+	if (!worker || worker->pool != this || worker->priority == priority) {
+		return;
+	}
+
+	// Uz bezici task nelze odmitnout -> jen se zapocita do limitu bulk/background vlaken
+	const bool was_limited = (worker->priority != TaskPriority::INTERACTIVE);
+	const bool limited = (priority != TaskPriority::INTERACTIVE);
+	worker->priority = priority;
+	if (!was_limited && limited) {
+		++limited_running_;
+	}
+	else if (was_limited && !limited) {
+		releaseLimited();
+	}
+}
+
+
+void ThreadPool::worker(Worker* self)
+{
+	current_worker_ = self;
 	running_threads_ += 1;
-	
+	futexWake(running_threads_, INT_MAX);
+
+	const bool elastic = isElastic();
+	bool idle = false;
+	std::chrono::steady_clock::time_point idle_since;
 	while (run_)
 	{
-		if (sem_wait(&semaphore_) == -1) 
+		TaskNode* node = nextTask(self);
+		// Pred uspanim jeste jednou (tasky casto chodi tesne za sebou -> usetri se futex wait/wake)
+		if (!node)
+		{
+			std::this_thread::yield();
+			node = nextTask(self);
+		}
+		if (!node)
 		{
-			//LOG_DBG("Thread synchronization failed");
+			if (!elastic)
+			{
+				park();
+				continue;
+			}
+
+			// Vlakno necinne dele nez idle_timeout_ skonci (pokud je jich vic nez minimum)
+			const auto now = std::chrono::steady_clock::now();
+			if (!idle)
+			{
+				idle = true;
+				idle_since = now;
+			}
+			const auto idle_time = std::chrono::duration_cast<std::chrono::milliseconds>(now - idle_since);
+			if (idle_time >= idle_timeout_)
+			{
+				if (retireWorker(self)) {
+					break;
+				}
+				idle_since = now;
+				park(idle_timeout_.count());
+			}
+			else {
+				park((idle_timeout_ - idle_time).count());
+			}
 			continue;
 		}
+		idle = false;
+		self->busy.store(true, std::memory_order_relaxed);
+
+		// Doba cekani ve fronte (citace vlakna meni jen ono samo -> staci load + store)
+		const size_t lane = static_cast<size_t>(node->priority);
+		--lanes_[lane].queued;
+		WorkerCounters& counters = self->counters[lane];
+		counters.tasks.store(counters.tasks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		if (node->timed)
+		{
+			const uint64_t wait_us = std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - node->queued).count();
+			counters.timed.store(counters.timed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			counters.wait_us.store(counters.wait_us.load(std::memory_order_relaxed) + wait_us, std::memory_order_relaxed);
+			if (wait_us > counters.max_wait_us.load(std::memory_order_relaxed)) {
+				counters.max_wait_us.store(wait_us, std::memory_order_relaxed);
+			}
+		}
+
+		self->priority = node->priority;
+		if (node->task) {
+			node->task();
+		}
+		freeNode(self, node);
+
+		// Task mohl byt behem zpracovani preradeny (setTaskPriority())
+		if (self->priority != TaskPriority::INTERACTIVE) {
+			releaseLimited();
+		}
+		self->priority = TaskPriority::INTERACTIVE;
+		self->busy.store(false, std::memory_order_release);
 
-		// Kontrola po probuzeni vlakna
+		if (draining_.load(std::memory_order_relaxed))
+		{
+			++drain_seq_;
+			futexWake(drain_seq_, INT_MAX);
+		}
+	}
+
+	current_worker_ = nullptr;
+	running_threads_ -= 1;
+}
+
+
+void ThreadPool::manager()
+{
+	// Kontrola zatizeni v ctvrtinach spawn_delay_ (nejvyse po MANAGER_MAX_TICK)
+	const auto tick = std::max(std::chrono::milliseconds(1), 
+		std::min(std::chrono::milliseconds(MANAGER_MAX_TICK), spawn_delay_ / 4));
+	bool saturated = false;
+	std::chrono::steady_clock::time_point saturated_since;
+
+	std::unique_lock<std::mutex> lock(manager_mutex_);
+	while (run_)
+	{
+		manager_cond_.wait_for(lock, tick, [this]() { return !run_; });
 		if (!run_) {
 			break;
 		}
-		
-		mutex_.lock();
-		if (!task_queue_.empty())
+
+		// Vsechna vlakna obsazena (nebo cekajici bulk/background tasky nemuze zadne vzit) -> po spawn_delay_ spustit dalsi
+		const size_t threads = threads_;
+		const bool blocked = (queuedTasks() > 0 && !hasRunnableTasks());
+		if ((busyThreads() >= threads || blocked) && threads < workers_.size())
 		{
-			task = std::move(task_queue_.front());
-			task_queue_.pop_front();
-			mutex_.unlock();
-		
-			if (task) 
+			const auto now = std::chrono::steady_clock::now();
+			if (!saturated)
+			{
+				saturated = true;
+				saturated_since = now;
+			}
+			else if (now - saturated_since >= spawn_delay_)
 			{
-				busy_threads_ += 1;
-				task();
-				busy_threads_ -= 1;
+				spawnWorker();
+				saturated_since = now;
 			}
 		}
-		
 		else {
-			mutex_.unlock();
+			saturated = false;
 		}
 	}
-	
-	running_threads_ -= 1;
 }
 
+
+bool ThreadPool::spawnWorker()
+{
+	// Vola jen manager -> mista nespousti nikdo jiny
+	for (auto& worker : workers_)
+	{
+		if (!worker->active)
+		{
+			// Predchozi vlakno na tomto miste uz skoncilo (nebo prave konci)
+			if (worker->thread.joinable()) {
+				worker->thread.join();
+			}
+
+			try
+			{
+				{
+					std::lock_guard<std::mutex> lock(worker->inbox_mutex);
+					worker->active = true;
+				}
+				threads_ += 1;
+				if (worker->index + 1 > used_slots_) {
+					used_slots_ = worker->index + 1;
+				}
+				worker->thread = std::thread(&ThreadPool::worker, this, worker.get());
+				//LOG_DBG("Thread spawned (threads: %lu)", threads_.load());
+				return true;
+			}
+
+			catch (const std::exception& e)
+			{
+				LOG_ERR("Failed to spawn thread (error: %s)", e.what());
+				std::lock_guard<std::mutex> lock(worker->inbox_mutex);
+				worker->active = false;
+				threads_ -= 1;
+				return false;
+			}
+		}
+	}
+
+	return false;
+}
+
+
+bool ThreadPool::retireWorker(Worker* self)
+{
+	// Vlastni deque je prazdna (jinak by nextTask() task nasel), inbox se kontroluje pod zamkem
+	std::lock_guard<std::mutex> lock(self->inbox_mutex);
+	for (const Lane& lane : self->lanes)
+	{
+		if (!lane.inbox.empty()) {
+			return false;
+		}
+	}
+	if (queuedTasks() > 0) {
+		return false;
+	}
+
+	size_t threads = threads_;
+	do
+	{
+		if (threads <= min_threads_) {
+			return false;
+		}
+	} while (!threads_.compare_exchange_weak(threads, threads - 1));
+
+	self->active = false;
+	//LOG_DBG("Thread retired (threads: %lu)", threads - 1);
+	return true;
+}
+
+
+ThreadPool::TaskNode* ThreadPool::allocNode(Worker* self)
+{
+	// Nejdriv z volnych uzlu vlakna (bez soupereni s ostatnimi)
+	if (self && self->cached_nodes > 0) {
+		return self->node_cache[--self->cached_nodes];
+	}
+
+	TaskNode* node = popFreeNode();
+	// Vsechny predalokovane uzly jsou pouzite
+	return (node) ? node : new TaskNode();
+}
+
+
+void ThreadPool::freeNode(Worker* self, TaskNode* node)
+{
+	node->task.reset();
+
+	const TaskNode* first = nodes_.get();
+	if (node < first || node >= first + TASK_NODES)
+	{
+		delete node;
+		return;
+	}
+
+	if (self && self->cached_nodes < NODE_CACHE) {
+		self->node_cache[self->cached_nodes++] = node;
+	}
+	else {
+		pushFreeNode(node);
+	}
+}
+
+
+ThreadPool::TaskNode* ThreadPool::popFreeNode()
+{
+	uint64_t head = free_nodes_.load(std::memory_order_acquire);
+	while ((head & NODE_INDEX_MASK) != 0)
+	{
+		TaskNode* node = &nodes_[(head & NODE_INDEX_MASK) - 1];
+		const uint64_t next = (((head >> 32) + 1) << 32) | node->next.load(std::memory_order_relaxed);
+		if (free_nodes_.compare_exchange_weak(head, next, std::memory_order_acq_rel, std::memory_order_acquire)) {
+			return node;
+		}
+	}
+
+	return nullptr;
+}
+
+
+void ThreadPool::pushFreeNode(TaskNode* node)
+{
+	const uint64_t index = static_cast<uint64_t>(node - nodes_.get()) + 1;
+	uint64_t head = free_nodes_.load(std::memory_order_relaxed);
+	uint64_t next;
+	do
+	{
+		node->next.store(static_cast<uint32_t>(head & NODE_INDEX_MASK), std::memory_order_relaxed);
+		next = (((head >> 32) + 1) << 32) | index;
+	} while (!free_nodes_.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+}
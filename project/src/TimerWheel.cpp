@@ -0,0 +1,147 @@
+#include "TimerWheel.hpp"
+#include <algorithm>
+
+
+#define WHEEL_LEVELS (4)
+#define WHEEL_BITS (6)
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_MAX_TICKS ((1ULL << (WHEEL_LEVELS * WHEEL_BITS)) - 1)
+
+
+TimerWheel::TimerWheel(const uint32_t tick_ms) :
+	buckets_(WHEEL_LEVELS * WHEEL_SLOTS, SlotMap<Timer>::INVALID_HANDLE),
+	tick_ms_((tick_ms > 0) ? tick_ms : 1),
+	current_(0)
+{
+
+}
+
+void TimerWheel::start(const uint64_t now_ms)
+{
+	clear();
+	current_ = now_ms / tick_ms_;
+}
+
+TimerWheel::Handle TimerWheel::schedule(const uint64_t key, const uint8_t kind, const uint64_t timeout_ms)
+{
+	// Vyprseni se zaokrouhluje nahoru na cely tick (casovac nikdy nevyprsi driv)
+	uint64_t ticks = (timeout_ms + tick_ms_ - 1) / tick_ms_;
+	if (ticks == 0) {
+		ticks = 1;
+	}
+	else if (ticks > WHEEL_MAX_TICKS) {
+		ticks = WHEEL_MAX_TICKS;
+	}
+
+	Timer timer;
+	timer.key = key;
+	timer.kind = kind;
+	timer.expires = current_ + ticks;
+
+	const Handle handle = timers_.insert(timer);
+	link(handle, *timers_.find(handle));
+	return handle;
+}
+
+bool TimerWheel::cancel(const Handle timer)
+{
+	Timer* t = timers_.find(timer);
+	if (!t) {
+		return false;
+	}
+
+	unlink(*t);
+	timers_.erase(timer);
+	return true;
+}
+
+void TimerWheel::advance(const uint64_t now_ms, std::vector<Expired>& expired)
+{
+	const uint64_t target = now_ms / tick_ms_;
+	while (current_ < target)
+	{
+		++current_;
+
+		// Pri pretoceni nizsi urovne se casovace z vyssi urovne rozdeli dolu
+		for (uint32_t level = 1; level < WHEEL_LEVELS; ++level)
+		{
+			if (((current_ >> ((level - 1) * WHEEL_BITS)) & WHEEL_MASK) != 0) {
+				break;
+			}
+			cascade(level);
+		}
+
+		// Vsechny casovace v aktualnim slotu nejnizsi urovne vyprsely
+		Handle& head = buckets_[current_ & WHEEL_MASK];
+		while (head != SlotMap<Timer>::INVALID_HANDLE)
+		{
+			const Handle handle = head;
+			Timer* timer = timers_.find(handle);
+			unlink(*timer);
+			expired.push_back({ handle, timer->key, timer->kind });
+			timers_.erase(handle);
+		}
+	}
+}
+
+void TimerWheel::clear()
+{
+	timers_.clear();
+	std::fill(buckets_.begin(), buckets_.end(), SlotMap<Timer>::INVALID_HANDLE);
+}
+
+
+void TimerWheel::link(const Handle handle, Timer& timer)
+{
+	// Uroven podle toho, jak daleko v budoucnu casovac vyprsi
+	const uint64_t delta = ((timer.expires > current_) ? (timer.expires - current_) : 0);
+	uint32_t level = 0;
+	while (level < (WHEEL_LEVELS - 1) && delta >= (1ULL << ((level + 1) * WHEEL_BITS))) {
+		++level;
+	}
+
+	// Uz vyprsely casovac (pri cascade) -> do slotu, ktery se prave zpracovava
+	const uint64_t expires = ((delta == 0) ? current_ : timer.expires);
+	timer.bucket = (level * WHEEL_SLOTS) + static_cast<uint32_t>((expires >> (level * WHEEL_BITS)) & WHEEL_MASK);
+
+	Handle& head = buckets_[timer.bucket];
+	timer.prev = SlotMap<Timer>::INVALID_HANDLE;
+	timer.next = head;
+	if (head != SlotMap<Timer>::INVALID_HANDLE) {
+		timers_.find(head)->prev = handle;
+	}
+	head = handle;
+}
+
+void TimerWheel::unlink(Timer& timer)
+{
+	if (timer.prev != SlotMap<Timer>::INVALID_HANDLE) {
+		timers_.find(timer.prev)->next = timer.next;
+	}
+	else {
+		buckets_[timer.bucket] = timer.next;
+	}
+
+	if (timer.next != SlotMap<Timer>::INVALID_HANDLE) {
+		timers_.find(timer.next)->prev = timer.prev;
+	}
+
+	timer.prev = timer.next = SlotMap<Timer>::INVALID_HANDLE;
+}
+
+void TimerWheel::cascade(const uint32_t level)
+{
+	const uint32_t bucket = (level * WHEEL_SLOTS) + static_cast<uint32_t>((current_ >> (level * WHEEL_BITS)) & WHEEL_MASK);
+
+	// Odpojit cely seznam a casovace znovu zaradit podle zbyvajiciho casu
+	Handle handle = buckets_[bucket];
+	buckets_[bucket] = SlotMap<Timer>::INVALID_HANDLE;
+	while (handle != SlotMap<Timer>::INVALID_HANDLE)
+	{
+		Timer* timer = timers_.find(handle);
+		const Handle next = timer->next;
+		link(handle, *timer);
+		handle = next;
+	}
+}
@@ -9,9 +9,12 @@
 #include "Http1_1.hpp"
 //#include "Http2_0.hpp"
 #include "HttpPacketBuilder.hpp"
-#include "request.h"
+#include "HttpRequestParser.hpp"
+#include "FileCache.hpp"
+#include "TextScan.hpp"
 #include "openssl/err.h"
 #include <string>
+#include <algorithm>
 #include <unistd.h>
 
 
@@ -27,19 +30,21 @@ void sendToClient(std::shared_ptr<TcpServer::Connection>& connection, HttpPacket
 }
 
 
-WebServer::WebServer()
-{
-	tcp_server_ = std::make_shared<TcpServer>();
-}
-
 bool WebServer::start()
 {		
 	if (!server_.loadConfigFiles()) {
 		return false;
 	}
 
-	if (!server_.tcp_server_->start()) {
-		return false;
+	for (const std::shared_ptr<TcpServer>& tcp_server : server_.tcp_servers_)
+	{
+		if (!tcp_server->start()) 
+		{
+			for (const std::shared_ptr<TcpServer>& started : server_.tcp_servers_) {
+				started->stop();
+			}
+			return false;
+		}
 	}
 		
 	LOG_INFO("Web server started");	
@@ -51,12 +56,22 @@ bool WebServer::stop()
 {
 	if (server_.isRunning())
 	{
-		server_.tcp_server_->stop();
-		if (Config::params().https_enabled &&
-			server_.https_thread_.joinable()) 
+		for (const std::shared_ptr<TcpServer>& tcp_server : server_.tcp_servers_) {
+			tcp_server->stop();
+		}
+		for (std::thread& accept_thread : server_.accept_threads_) 
 		{
-			server_.https_thread_.join();
+			if (accept_thread.joinable()) {
+				accept_thread.join();
+			}
 		}
+		server_.accept_threads_.clear();
+
+		const FileCache::Stats cache = FileCache::stats();
+		LOG_INFO("File cache (hits: %lu, misses: %lu, evictions: %lu, compressions: %lu, entries: %lu, size: %lu B)", 
+			static_cast<unsigned long>(cache.hits), static_cast<unsigned long>(cache.misses), 
+			static_cast<unsigned long>(cache.evictions), static_cast<unsigned long>(cache.compressions), 
+			static_cast<unsigned long>(cache.entries), static_cast<unsigned long>(cache.size));
 
 		return true;
 	}
@@ -70,8 +85,12 @@ bool WebServer::reset()
 	if (!server_.isRunning())
 	{
 		Config::reset();
+		FileCache::reset();
 		server_.ssl_config_.reset();
-		server_.tcp_server_->reset();
+		for (const std::shared_ptr<TcpServer>& tcp_server : server_.tcp_servers_) {
+			tcp_server->reset();
+		}
+		server_.tcp_servers_.clear();  // Pocet shardu se muze po nacteni konfigurace zmenit
 		return true;
 	}
 
@@ -79,116 +98,130 @@ bool WebServer::reset()
 }
 
 
-bool WebServer::getClientHttpVersion(std::shared_ptr<TcpServer::Connection>& connection, std::unique_ptr<Http>& http_client)
+bool WebServer::isRunning()
+{
+	return (!server_.tcp_servers_.empty() && server_.tcp_servers_.front()->isRunning());
+}
+
+
+bool WebServer::isDeactivated()
+{
+	return (server_.tcp_servers_.empty() || server_.tcp_servers_.front()->isDeactivated());
+}
+
+
+bool WebServer::getClientHttpVersion(const std::shared_ptr<TcpServer>& tcp_server, std::shared_ptr<TcpServer::Connection>& connection, std::shared_ptr<Http>& http_client)
 {
 	if (isRunning())
 	{			
-		std::string request_data;
+		std::string request_header;
+		HttpRequestParser parser;
 		HttpPacketBuilder hpb(HttpVersion::HTTP_1_0);
 
 		//LOG_DBG("getClientHttpVersion()...");
-		//LOG_DBG("getClientHttpVersion()::receiveText()...");
+		//LOG_DBG("getClientHttpVersion()::receiveHeader()...");
 
-		int ret = tcp_server_->receiveText(connection, request_data, Config::params().max_header_size, HEADERS_END, true);
+		// Hlavicka se prijme a rozparsuje jen jednou, verze HTTP se urci z request line a request dostane vytvorena obsluha
+		int ret = tcp_server->receiveHeader(connection, request_header, Config::params().max_header_size, parser);
 		// Klient se odpojil
 		if (ret == 0) 
 		{
-			tcp_server_->endConnection(connection);
+			tcp_server->endConnection(connection);
 			return false;
 		}
 		// Chyba
 		else if (ret == -1)
 		{
 			hpb.buildInternalServerError();
-			sendToClient(connection, hpb, tcp_server_);
+			sendToClient(connection, hpb, tcp_server);
 			return false;
 		}
-
-		//LOG_DBG("getClientHttpVersion()::receiveText()");
-		//LOG_DBG("\nRecvd data: %s\n", request_data.c_str());
-
-		httpparser::Request request;
-		if (!httpParseRequest(request_data, request))
+		// Nevalidni nebo prilis velka hlavicka
+		else if (ret < 0)
 		{
 			hpb.buildBadRequest();
-			sendToClient(connection, hpb, tcp_server_);
+			sendToClient(connection, hpb, tcp_server);
 			return false;
 		}
-		
-		const HttpVersion http_version = 
-			httpVersionStr(std::to_string(request.versionMajor) + "." + std::to_string(request.versionMinor));
+
+		//LOG_DBG("getClientHttpVersion()::receiveHeader()");
+
+		std::shared_ptr<Http1_0> http1_client;
+		const HttpRequestParser::Request& request = parser.request();
+		const HttpVersion http_version = httpVersionNum(request.version_major, request.version_minor);
 		switch (http_version)
 		{
 			case HttpVersion::HTTP_1_0:
 				//LOG_DBG("Creating Http1_0 object");
-				http_client = std::unique_ptr<Http1_0>(new Http1_0(tcp_server_, connection));
+				http1_client = std::make_shared<Http1_0>(tcp_server, connection);
 				break;
 			case HttpVersion::HTTP_1_1:
 			//LOG_DBG("Creating Http1_1 object");
-			http_client = std::unique_ptr<Http1_1>(new Http1_1(tcp_server_, connection));
+				http1_client = std::make_shared<Http1_1>(tcp_server, connection);
 				break;
 			/*case HttpVersion:HTTP_2_0:
 				//LOG_DBG("Creating Http2_0 object");
-				http_client = std::unique_ptr<Http2_0>(new Http2_0(tcp_server_, connection));
+				http_client = std::unique_ptr<Http2_0>(new Http2_0(tcp_server, connection));
 				break;*/
 			case HttpVersion::UNSUPPORTED:
 				hpb.buildHttpVersionNotSupported();
-				sendToClient(connection, hpb, tcp_server_);
+				sendToClient(connection, hpb, tcp_server);
 				return false;
 		}
 
+		http1_client->setRequest(std::move(request_header), std::move(parser));
+		http_client = std::move(http1_client);
 		return true;
 	}
 	
 	return false;
 }
 
-void WebServer::run()
+void WebServer::acceptConnections(const std::shared_ptr<TcpServer>& tcp_server, const bool ssl)
 {
 	try
 	{
-		if (Config::params().https_enabled)
+		while (tcp_server->isRunning() && !tcp_server->isDeactivated())
 		{
-			server_.https_thread_ = std::thread([]()
-			{
-				try
-				{
-					WebServer& server = WebServer::server_;
-					while (server.isRunning() && !server.isDeactivated())
-					{
-						std::shared_ptr<TcpServer::Connection> connection = 
-							server.tcp_server_->acceptConnectionSsl();
-						if (!connection->hasSocket()) {
-							continue;
-						}
-		
-						//LOG_DBG("Client connected");
-						server.createSessionSsl(connection);
-					}
-				}
+			std::shared_ptr<TcpServer::Connection> connection = 
+				((ssl) ? tcp_server->acceptConnectionSsl() : tcp_server->acceptConnection());
+			if (!connection->hasSocket()) {
+				continue;
+			}
 
-				catch (const std::exception& e) {
-					LOG_ERR("Error: %s", e.what());
-				}
-			});
+			//LOG_DBG("Client connected");
+			if (ssl) {
+				createSessionSsl(tcp_server, connection);
+			}
+			else {
+				createSession(tcp_server, connection);
+			}
 		}
+	}
 
-		try
-		{
-			while (server_.isRunning() && !server_.isDeactivated())
-			{
-				std::shared_ptr<TcpServer::Connection> connection = 
-					server_.tcp_server_->acceptConnection();
-				if (!connection->hasSocket()) {
-					continue;
-				}
+	catch (const std::exception& e) {
+		LOG_ERR("Error: %s", e.what());
+	}
+}
 
-				//LOG_DBG("Client connected");
-				server_.createSession(connection);
+void WebServer::run()
+{
+	try
+	{
+		// Kazdy shard ma vlastni acceptor vlakna (HTTP spojeni prvniho shardu prijima hlavni vlakno)
+		for (size_t i = 0; i < server_.tcp_servers_.size(); ++i)
+		{
+			const std::shared_ptr<TcpServer> tcp_server = server_.tcp_servers_[i];
+			if (Config::params().https_enabled) {
+				server_.accept_threads_.emplace_back(&WebServer::acceptConnections, &server_, tcp_server, true);
+			}
+			if (i > 0) {
+				server_.accept_threads_.emplace_back(&WebServer::acceptConnections, &server_, tcp_server, false);
 			}
 		}
-		catch (const std::exception& e) {
-			//LOG_DBG("Error: %s", e.what());
+
+		if (!server_.tcp_servers_.empty()) {
+			server_.acceptConnections(server_.tcp_servers_.front(), false);
 		}
 	}
 
@@ -197,91 +230,103 @@ void WebServer::run()
 	}
 }
 
-void WebServer::createSession(std::shared_ptr<TcpServer::Connection> connection)
+void WebServer::createSession(const std::shared_ptr<TcpServer>& tcp_server, std::shared_ptr<TcpServer::Connection> connection)
 {
 	//LOG_DBG("\nCreating NORMAL session...\n");
 
+	// Obsluha se spousti pro kazdy prijaty request, HTTP klient si drzi stav spojeni mezi requesty
+	std::shared_ptr<Http> http_client;
 	const bool result = 
-		tcp_server_->handleConnection(connection, [this, connection]() mutable
+		tcp_server->handleConnection(connection, [this, tcp_server, connection, http_client]() mutable
 	{
 		try
 		{
-			if (tcp_server_->isConnected(connection))
+			if (tcp_server->isConnected(connection))
 			{
-				std::unique_ptr<Http> http_client;
-				if (!getClientHttpVersion(connection, http_client)) {
+				if (!http_client && !getClientHttpVersion(tcp_server, connection, http_client)) {
 					return;
 				}
 
 				http_client->handleConnection();
 			}
 
+			else if (http_client) {
+				http_client->endConnection();
+			}
+
 			else {
-				tcp_server_->endConnection(connection);
+				tcp_server->endConnection(connection);
 			}
 		}
 		
 		catch (const std::exception& e)
 		{
 			//LOG_DBG("Error: %s", e.what());
-			tcp_server_->endConnection(connection);
+			tcp_server->endConnection(connection);
 		}
-
-		usleep(150);
 	});
 	
 	if (!result)
 	{
 		HttpPacketBuilder hpb(HttpVersion::HTTP_1_0);
 		hpb.buildServiceUnavailable();
-		sendToClient(connection, hpb, tcp_server_);
+		sendToClient(connection, hpb, tcp_server);
 	}
 }
 
-void WebServer::createSessionSsl(std::shared_ptr<TcpServer::Connection> connection)
+void WebServer::createSessionSsl(const std::shared_ptr<TcpServer>& tcp_server, std::shared_ptr<TcpServer::Connection> connection)
 {
 	//LOG_DBG("\nCreating SSL session...\n");
 
+	// TLS handshake provadi event loop (obsluha se spusti az s desifrovanym requestem)
+	if (!tcp_server->initSsl(connection, ssl_config_.ctx()))
+	{
+		tcp_server->endConnection(connection);
+		return;
+	}
+
+	std::shared_ptr<Http> http_client;
 	const bool result = 
-		tcp_server_->handleConnection(connection, [this, connection]() mutable
+		tcp_server->handleConnection(connection, [this, tcp_server, connection, http_client]() mutable
 	{
 		try
 		{
-			if (tcp_server_->isConnected(connection))
+			if (tcp_server->isConnected(connection))
 			{
-				std::unique_ptr<Http> http_client;
-				SSL* ssl = SSL_new(ssl_config_.ctx());
-				SSL_set_fd(ssl, connection->getSocket());
-	
-				// TLS handshake
-				if (SSL_accept(ssl) != 1) 
+				// Handshake, ktery event loop nedokoncil (jen pri prvnim requestu spojeni)
+				if (!connection->hasSsl()) 
 				{
-					//LOG_DBG("SSL handshake failed");
-					#ifdef DBG
-					ERR_print_errors_fp(stderr);
-					#endif
-					if (ssl) { SSL_free(ssl); }
-					tcp_server_->endConnection(connection);
-					return;
+					if (!tcp_server->handshakeSsl(connection))
+					{
+						//LOG_DBG("SSL handshake failed");
+						#ifdef DBG
+						ERR_print_errors_fp(stderr);
+						#endif
+						tcp_server->endConnection(connection);
+						return;
+					}
 				}
-				connection->setSsl(ssl);
 
-				if (!getClientHttpVersion(connection, http_client)) {
+				if (!http_client && !getClientHttpVersion(tcp_server, connection, http_client)) {
 					return;
 				}
 
 				http_client->handleConnection();
 			}
 
+			else if (http_client) {
+				http_client->endConnection();
+			}
+
 			else {
-				tcp_server_->endConnection(connection);
+				tcp_server->endConnection(connection);
 			}
 		}
 		
 		catch (const std::exception& e)
 		{
 			//LOG_DBG("Error: %s", e.what());
-			tcp_server_->endConnection(connection);
+			tcp_server->endConnection(connection);
 		}
 	});
 	
@@ -289,7 +334,7 @@ void WebServer::createSessionSsl(std::shared_ptr<TcpServer::Connection> connecti
 	{
 		HttpPacketBuilder hpb(HttpVersion::HTTP_1_0);
 		hpb.buildServiceUnavailable();
-		sendToClient(connection, hpb, tcp_server_);
+		sendToClient(connection, hpb, tcp_server);
 	}
 }
 
@@ -301,6 +346,9 @@ bool WebServer::loadConfigFiles()
 		return false;
 	}
 
+	FileCache::init(Config::params().file_cache_size, Config::params().file_cache_max_file_size, 
+		Config::params().compressed_variant_max_file_size);
+
 	//LOG_DBG("Loading resources config...");
 	if (!Config::loadResourcesConfig()) {
 		return false;
@@ -312,5 +360,22 @@ bool WebServer::loadConfigFiles()
 	}
 	//LOG_DBG("SSL done");
 
-	return tcp_server_->set();
+	// Shardy -> vlastni listening sockety (SO_REUSEPORT), event loop, spojeni a vlakna
+	const size_t shards = std::max<size_t>(1, Config::params().listener_shards);
+	if (shards > 1) {
+		LOG_INFO("Using %zu listener shards", shards);
+	}
+	LOG_INFO("Text scanning: %s", TextScan::kernelName(TextScan::kernel()));
+
+	tcp_servers_.clear();
+	for (size_t i = 0; i < shards; ++i)
+	{
+		std::shared_ptr<TcpServer> tcp_server = std::make_shared<TcpServer>();
+		if (!tcp_server->set(shards)) {
+			return false;
+		}
+		tcp_servers_.push_back(tcp_server);
+	}
+
+	return true;
 }
@@ -0,0 +1,185 @@
+// Kontrola shody implementaci TextScan (skalarni, SSE4.2, AVX2) s referencni implementaci
+// Kazda podporovana implementace x delka dat x pozice hledaneho vzoru / neviditelneho znaku,
+// data konci tesne pred nepristupnou strankou -> cteni za konec dat skonci SIGSEGV
+// Spusteni: make check (nebo build/tests/TextScanCheck)
+#include "TextScan.hpp"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+static constexpr size_t MAX_LENGTH = 300;  // Pres nekolik bloku AVX2 (2x 32 B) i SSE4.2 (16 B)
+
+// Buffer, za jehoz koncem je nepristupna stranka
+class GuardedBuffer
+{
+	public:
+		GuardedBuffer()
+		{
+			page_size_ = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+			mapping_ = static_cast<char*>(mmap(nullptr, 2 * page_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+			if (mapping_ == MAP_FAILED) {
+				mapping_ = nullptr;
+			}
+			else {
+				mprotect(mapping_ + page_size_, page_size_, PROT_NONE);
+			}
+		}
+		~GuardedBuffer()
+		{
+			if (mapping_) {
+				munmap(mapping_, 2 * page_size_);
+			}
+		}
+
+		bool isValid() const { return (mapping_ != nullptr); }
+		// Data zkopirovana tak, aby posledni byte lezel tesne pred nepristupnou strankou
+		const char* place(const std::string& data)
+		{
+			char* begin = mapping_ + page_size_ - data.size();
+			memcpy(begin, data.data(), data.size());
+			return begin;
+		}
+
+	private:
+		size_t page_size_ = 0;
+		char* mapping_ = nullptr;
+};
+
+// Reference: viditelne znaky (VCHAR, obs-text), v hodnote header fieldu navic mezera a HTAB
+static size_t referenceSkipVisible(const char* data, size_t pos, const size_t size, const bool allow_space)
+{
+	for (; pos < size; ++pos)
+	{
+		const unsigned char c = static_cast<unsigned char>(data[pos]);
+		const bool visible = ((c >= 0x21 && c != 0x7f) || (allow_space && (c == ' ' || c == '\t')));
+		if (!visible) {
+			break;
+		}
+	}
+	return pos;
+}
+
+static size_t failures = 0;
+static size_t checks = 0;
+
+static void report(const char* what, const TextScan::Kernel kernel, const std::string& data, const size_t from,
+	const size_t expected, const size_t result)
+{
+	++checks;
+	if (expected == result) {
+		return;
+	}
+	if (++failures <= 20)
+	{
+		printf("FAIL %s [%s] length %zu from %zu: expected %zd, got %zd\n", what, TextScan::kernelName(kernel),
+			data.size(), from, static_cast<ssize_t>(expected), static_cast<ssize_t>(result));
+	}
+}
+
+// Vzor na kazde pozici (cely, na konci jen cast), nekolik vyskytu a castecne shody (prvni i posledni znak sedi)
+static void checkFind(const TextScan::Kernel kernel, GuardedBuffer& buffer, const std::string& pattern)
+{
+	std::string near_miss = pattern;
+	if (near_miss.size() > 2) {
+		near_miss[near_miss.size() / 2] ^= 0x20;
+	}
+
+	for (size_t length = 0; length <= MAX_LENGTH; ++length)
+	{
+		for (size_t position = 0; position <= length; ++position)
+		{
+			std::string data(length, 'a');
+			// Kandidati pred vzorem, ktere se musi odmitnout az pri celem porovnani (dvouznakovy vzor je nema)
+			for (size_t i = 0; pattern.size() > 2 && i + near_miss.size() <= position; i += 7) {
+				data.replace(i, near_miss.size(), near_miss);
+			}
+			data.replace(position, std::min(pattern.size(), length - position), pattern, 0, length - position);
+			if (position + 2 * pattern.size() + 3 <= length) {
+				data.replace(position + pattern.size() + 3, pattern.size(), pattern);
+			}
+
+			const char* placed = buffer.place(data);
+			const std::string_view text(placed, data.size());
+			for (const size_t from : { size_t(0), position / 2, position, position + 1, length })
+			{
+				report("find", kernel, data, from, std::string_view(data).find(pattern, from),
+					TextScan::find(kernel, text, pattern, from));
+			}
+		}
+	}
+}
+
+// Neviditelny znak (nebo znak hranice tridy) na kazde pozici
+static void checkSkipVisible(const TextScan::Kernel kernel, GuardedBuffer& buffer, const bool allow_space)
+{
+	static const unsigned char stops[] = { 0x00, 0x01, '\t', '\n', '\r', 0x1f, ' ', 0x21, 0x7e, 0x7f, 0x80, 0xff };
+
+	for (size_t length = 0; length <= MAX_LENGTH; ++length)
+	{
+		for (const unsigned char stop : stops)
+		{
+			for (size_t position = 0; position <= length; ++position)
+			{
+				std::string data(length, 'x');
+				for (size_t i = 0; i < length; i += 5) {
+					data[i] = static_cast<char>((i % 3 == 0) ? 0xc3 : '~');  // obs-text a VCHAR pred zastavenim
+				}
+				if (position < length) {
+					data[position] = static_cast<char>(stop);
+				}
+
+				const char* placed = buffer.place(data);
+				for (const size_t from : { size_t(0), position / 2, position, length })
+				{
+					report((allow_space ? "skipVisible(value)" : "skipVisible(uri)"), kernel, data, from,
+						referenceSkipVisible(placed, from, length, allow_space),
+						TextScan::skipVisible(kernel, placed, from, length, allow_space));
+				}
+			}
+		}
+	}
+}
+
+
+int main()
+{
+	GuardedBuffer buffer;
+	if (!buffer.isValid())
+	{
+		printf("Failed to map guarded buffer\n");
+		return 1;
+	}
+
+	const std::vector<std::string> patterns = {
+		"\r\n",
+		"\r\n\r\n",
+		"--",
+		"--------------------------d74496d66958873e",  // Hranice multipart (curl)
+		std::string(70, '-')  // Nejdelsi hranice podle RFC 2046, kazda pozice je kandidat
+	};
+
+	for (const TextScan::Kernel kernel : { TextScan::Kernel::SCALAR, TextScan::Kernel::SSE42, TextScan::Kernel::AVX2 })
+	{
+		if (!TextScan::kernelSupported(kernel))
+		{
+			printf("%s: not supported by CPU, skipped\n", TextScan::kernelName(kernel));
+			continue;
+		}
+
+		const size_t failures_before = failures;
+		const size_t checks_before = checks;
+		for (const std::string& pattern : patterns) {
+			checkFind(kernel, buffer, pattern);
+		}
+		checkSkipVisible(kernel, buffer, false);
+		checkSkipVisible(kernel, buffer, true);
+		printf("%s: %zu checks, %zu failures\n", TextScan::kernelName(kernel), checks - checks_before, failures - failures_before);
+	}
+
+	return ((failures == 0) ? 0 : 1);
+}
@@ -0,0 +1,204 @@
+// Kontrola castecnych zapisu vektoroveho send pres io_uring (IoUring::prepareSendMsg, stejne jako TcpServer::sendAllUring)
+// Odesilajici socket ma maly SO_SNDBUF -> send odesle jen cast dat, CQE musi nest presny pocet odeslanych bytu
+// a po znovuodeslani zbytku musi prijemce dostat data presne jednou a ve spravnem poradi
+// Spusteni: make check (nebo build/tests/UringSendCheck)
+#include "IoUring.hpp"
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifndef WEBSERVER_IO_URING
+int main()
+{
+	printf("UringSendCheck: io_uring backend not compiled in, skipped\n");
+	return 0;
+}
+#else
+
+static constexpr size_t DATA_SIZE = 2 * 1024 * 1024;
+static constexpr int SOCKET_BUFFER = 4096;
+
+
+// Spojeni pres loopback (odesilajici konec neblokujici, oba konce s malym bufferem)
+static bool connectPair(int& sender, int& receiver)
+{
+	sender = receiver = -1;
+	const int listener = socket(AF_INET, SOCK_STREAM, 0);
+	if (listener == -1) {
+		return false;
+	}
+
+	sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t len = sizeof(addr);
+	bool ok = (bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 && listen(listener, 1) == 0 &&
+			   getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len) == 0);
+
+	if (ok)
+	{
+		receiver = socket(AF_INET, SOCK_STREAM, 0);
+		setsockopt(receiver, SOL_SOCKET, SO_RCVBUF, &SOCKET_BUFFER, sizeof(SOCKET_BUFFER));
+		ok = (receiver != -1 && connect(receiver, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+	}
+	if (ok)
+	{
+		sender = accept(listener, nullptr, nullptr);
+		ok = (sender != -1);
+	}
+	if (ok)
+	{
+		setsockopt(sender, SOL_SOCKET, SO_SNDBUF, &SOCKET_BUFFER, sizeof(SOCKET_BUFFER));
+		ok = (fcntl(sender, F_SETFL, fcntl(sender, F_GETFL) | O_NONBLOCK) == 0);
+	}
+
+	close(listener);
+	return ok;
+}
+
+// Precte vse, co je v socketu, a porovna s ocekavanymi daty
+static bool drain(const int sock, const std::string& expected, size_t& received)
+{
+	char buffer[65536];
+	while (true)
+	{
+		const ssize_t ret = recv(sock, buffer, sizeof(buffer), MSG_DONTWAIT);
+		if (ret == -1) {
+			return (errno == EAGAIN || errno == EWOULDBLOCK);
+		}
+		if (ret == 0 || received + ret > expected.size() || memcmp(buffer, expected.data() + received, ret) != 0) {
+			return false;
+		}
+		received += ret;
+	}
+}
+
+static int waitResult(IoUring& ring)
+{
+	if (ring.waitCqe(5000) != 1) {
+		return INT32_MIN;
+	}
+	io_uring_cqe* cqe = ring.peekCqe();
+	const int res = cqe->res;
+	ring.seenCqe();
+	return res;
+}
+
+
+int main()
+{
+	IoUring ring;
+	if (!ring.init(8))
+	{
+		printf("UringSendCheck: io_uring not available, skipped\n");
+		return 0;
+	}
+
+	int sender, receiver;
+	if (!connectPair(sender, receiver))
+	{
+		printf("UringSendCheck: failed to create loopback connection\n");
+		return 1;
+	}
+
+	// Data ruznych delek rozdelena do vice casti (hranice zapisu nepadnou na hranice casti)
+	std::string data(DATA_SIZE, '\0');
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = static_cast<char>('a' + (i * 7 + i / 4093) % 26);
+	}
+	std::vector<iovec> parts;
+	for (size_t pos = 0, len = 1; pos < data.size(); pos += len, len = len * 3 + 5) {
+		parts.push_back({ &data[pos], std::min(len, data.size() - pos) });
+	}
+
+	size_t index = 0, offset = 0, sent = 0, received = 0;
+	size_t partial = 0, full = 0;
+	int failures = 0;
+	while (index < parts.size() && failures == 0)
+	{
+		std::vector<iovec> rest(parts.begin() + index, parts.end());
+		rest[0].iov_base = static_cast<char*>(rest[0].iov_base) + offset;
+		rest[0].iov_len -= offset;
+		const size_t remaining = data.size() - sent;
+
+		msghdr msg = {};
+		msg.msg_iov = rest.data();
+		msg.msg_iovlen = rest.size();
+		{
+			std::lock_guard<std::mutex> lock(ring.submitMutex());
+			IoUring::prepareSendMsg(ring.getSqe(), sender, &msg);
+			ring.submit();
+		}
+		const int res = waitResult(ring);
+
+		if (res == -EAGAIN)
+		{
+			// Plny socket -> prijemce precte, co uz prislo (odeslana data musi odpovidat vysledkum CQE)
+			++full;
+			if (!drain(receiver, data, received) || received > sent) {
+				++failures;
+			}
+			continue;
+		}
+		if (res <= 0 || static_cast<size_t>(res) > remaining)
+		{
+			printf("UringSendCheck: unexpected send result %d (remaining %zu)\n", res, remaining);
+			++failures;
+			break;
+		}
+		if (static_cast<size_t>(res) < remaining) {
+			++partial;
+		}
+
+		// Zbytek od prvniho neodeslaneho bytu
+		sent += res;
+		for (size_t n = res; n > 0; )
+		{
+			const size_t len = std::min(n, parts[index].iov_len - offset);
+			n -= len;
+			offset += len;
+			if (offset == parts[index].iov_len)
+			{
+				++index;
+				offset = 0;
+			}
+		}
+	}
+
+	// Dorazit zbytek dat
+	while (failures == 0 && received < sent)
+	{
+		if (!drain(receiver, data, received)) {
+			++failures;
+		}
+	}
+
+	close(sender);
+	close(receiver);
+
+	if (failures == 0 && received != data.size())
+	{
+		printf("UringSendCheck: received %zu of %zu bytes\n", received, data.size());
+		++failures;
+	}
+	if (failures == 0 && partial == 0)
+	{
+		printf("UringSendCheck: no partial send with SO_SNDBUF %d\n", SOCKET_BUFFER);
+		++failures;
+	}
+
+	printf("UringSendCheck: %zu bytes in %zu parts, %zu partial sends, %zu full socket, %s\n",
+		data.size(), parts.size(), partial, full, ((failures == 0) ? "OK" : "FAILED"));
+	return ((failures == 0) ? 0 : 1);
+}
+
+#endif